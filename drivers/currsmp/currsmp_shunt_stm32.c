@@ -14,10 +14,28 @@
 #include <stm32_ll_adc.h>
 
 #include <spinner/drivers/currsmp.h>
+#include <spinner/utils/shunt.h>
 #include <spinner/utils/stm32_adc.h>
 
 LOG_MODULE_REGISTER(currsmp_shunt_stm32, CONFIG_SPINNER_CURRSMP_LOG_LEVEL);
 
+/** Simultaneous sampling on a second (slave) ADC (any instance). */
+#define DUAL_ADC DT_ANY_INST_HAS_PROP_STATUS_OKAY(dual_adc)
+
+#if DUAL_ADC && !defined(ADC_MULTIMODE_SUPPORT)
+#error "Dual ADC mode not supported by this SoC"
+#endif
+
+/** Offset tracking on zero-vector windows (any instance). */
+#define OFFSET_TRACKING DT_ANY_INST_HAS_PROP_STATUS_OKAY(adc_reg_trigger)
+
+/** Offset calibration samples. */
+#define OFFSET_SAMPLES CONFIG_SPINNER_CURRSMP_SHUNT_STM32_OFFSET_SAMPLES
+
+/** Offset tracking filter shift. */
+#define OFFSET_TRK_SHIFT \
+	CONFIG_SPINNER_CURRSMP_SHUNT_STM32_OFFSET_TRACKING_SHIFT
+
 /*******************************************************************************
  * Private
  ******************************************************************************/
@@ -32,31 +50,127 @@ struct currsmp_shunt_stm32_config {
 	uint32_t adc_ch_b;
 	uint32_t adc_ch_c;
 	uint32_t adc_trigger;
+	void (*irq_config)(void);
+#if OFFSET_TRACKING
+	bool offset_tracking;
+	uint32_t adc_reg_trigger;
+#endif
+#if DUAL_ADC
+	/* NULL if not in dual ADC mode */
+	ADC_TypeDef *dual_adc;
+	struct stm32_pclken dual_pclken;
+	uint32_t dual_adc_ch_a;
+	uint32_t dual_adc_ch_b;
+	uint32_t dual_adc_ch_c;
+#endif
 	const struct pinctrl_dev_config *pcfg;
 };
 
 struct currsmp_shunt_stm32_data {
 	currsmp_regulation_cb_t regulation_cb;
 	void *regulation_ctx;
-	uint16_t i_a_offset;
-	uint16_t i_b_offset;
-	uint16_t i_c_offset;
+	struct shunt_offsets offsets;
 	uint8_t sector;
 	uint32_t jsqr[3];
+#if DUAL_ADC
+	struct shunt_offsets dual_offsets;
+	uint32_t dual_jsqr[3];
+#endif
+#if OFFSET_TRACKING
+	/* tracking filters (offset << shift), next phase (3: out of sync) */
+	uint32_t trk_acc[3];
+	uint8_t trk_phase;
+#endif
 };
 
-ISR_DIRECT_DECLARE(adc_irq)
+#if OFFSET_TRACKING
+/**
+ * @brief Update offsets with the last zero-vector sample (if any).
+ *
+ * Samples are low-pass filtered for each phase. As offsets are only updated
+ * here, before running the regulation callback, currents are always computed
+ * with a consistent set of offsets.
+ *
+ * @param[in] dev Current sampling device.
+ */
+static inline void offsets_track(const struct device *dev)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+	struct currsmp_shunt_stm32_data *data = dev->data;
+
+	uint16_t *offsets[3] = {&data->offsets.a, &data->offsets.b,
+				&data->offsets.c};
+	uint8_t phase = data->trk_phase;
+	uint16_t val, offset;
+	uint32_t *acc;
+	bool eos;
+
+	if (LL_ADC_IsActiveFlag_EOC(config->adc) == 0U) {
+		return;
+	}
+
+	val = (uint16_t)LL_ADC_REG_ReadConversionData32(config->adc);
+
+	eos = LL_ADC_IsActiveFlag_EOS(config->adc) != 0U;
+	if (eos) {
+		LL_ADC_ClearFlag_EOS(config->adc);
+	}
+
+	/* keep track of the sequence position (one phase per trigger), samples
+	 * are discarded until the end of sequence if a conversion is missed
+	 */
+	if (eos) {
+		data->trk_phase = 0U;
+		if (phase != 2U) {
+			return;
+		}
+	} else if (phase >= 2U) {
+		data->trk_phase = 3U;
+		return;
+	} else {
+		data->trk_phase = phase + 1U;
+	}
+
+	/* first order IIR filter: acc = acc - acc / 2^shift + val */
+	acc = &data->trk_acc[phase];
+	*acc += val - (*acc >> OFFSET_TRK_SHIFT);
+	offset = (uint16_t)(*acc >> OFFSET_TRK_SHIFT);
+
+#if DUAL_ADC
+	/* apply the same drift to the second ADC offsets */
+	if (config->dual_adc != NULL) {
+		uint16_t *dual_offsets[3] = {&data->dual_offsets.a,
+					     &data->dual_offsets.b,
+					     &data->dual_offsets.c};
+
+		*dual_offsets[phase] = (uint16_t)(*dual_offsets[phase] +
+						  offset - *offsets[phase]);
+	}
+#endif
+
+	*offsets[phase] = offset;
+}
+#endif
+
+/**
+ * @brief ADC IRQ handler.
+ *
+ * @param[in] dev Current sampling device.
+ */
+static inline void adc_irq_handler(const struct device *dev)
 {
-	const struct device *dev = DEVICE_DT_INST_GET(0);
 	const struct currsmp_shunt_stm32_config *config = dev->config;
 	struct currsmp_shunt_stm32_data *data = dev->data;
 
 	if (LL_ADC_IsActiveFlag_JEOS(config->adc)) {
 		LL_ADC_ClearFlag_JEOS(config->adc);
+#if OFFSET_TRACKING
+		if (config->offset_tracking) {
+			offsets_track(dev);
+		}
+#endif
 		data->regulation_cb(data->regulation_ctx);
 	}
-
-	return 0;
 }
 
 /**
@@ -91,47 +205,55 @@ static uint32_t adc_calc_jsqr(uint32_t trigger, uint32_t rank1_ch,
 	return jsqr;
 }
 
+#if DUAL_ADC
 /**
- * @brief Configure ADC.
+ * Compute the ADC injected sequence register (JSQR) for a single channel.
+ *
+ * @param[in] trigger ADC trigger.
+ * @param[in] rank1_ch Rank 1 channel.
+ *
+ * @return Computed JSQR register value.
+ */
+static uint32_t adc_calc_jsqr_single(uint32_t trigger, uint32_t rank1_ch)
+{
+	uint8_t ch1 = __LL_ADC_CHANNEL_TO_DECIMAL_NB(rank1_ch);
+
+#ifdef CONFIG_SOC_SERIES_STM32F3X
+	/* F3X ADC uses channels 1..18, indexed from 0..17 */
+	ch1--;
+#endif
+
+	return ((ch1 & ADC_INJ_RANK_ID_JSQR_MASK)
+		<< ADC_INJ_RANK_1_JSQR_BITOFFSET_POS) |
+	       LL_ADC_INJ_TRIG_EXT_RISING | trigger;
+}
+#endif
+
+/**
+ * @brief Initialize and enable an ADC instance.
  *
  * @param[in] dev Current sampling device.
+ * @param[in] adc ADC instance.
+ * @param[in] pclken ADC clock.
+ * @param[in] ch_a Phase a channel.
+ * @param[in] ch_b Phase b channel.
+ * @param[in] ch_c Phase c channel.
  *
  * @return 0 on success, negative errno otherwise.
  */
-static int adc_configure(const struct device *dev)
+static int adc_enable(const struct device *dev, ADC_TypeDef *adc,
+		      const struct stm32_pclken *pclken, uint32_t ch_a,
+		      uint32_t ch_b, uint32_t ch_c)
 {
 	const struct currsmp_shunt_stm32_config *config = dev->config;
 
 	int ret;
-	const struct device *clk;
 	uint32_t smp;
-	LL_ADC_CommonInitTypeDef adc_cinit;
 	LL_ADC_InitTypeDef adc_init;
 	LL_ADC_REG_InitTypeDef adc_rinit;
 	LL_ADC_INJ_InitTypeDef adc_jinit;
 	uint32_t adc_clk;
 
-	/* enable ADC clock */
-	clk = DEVICE_DT_GET(STM32_CLOCK_CONTROL_NODE);
-	ret = clock_control_on(clk, (clock_control_subsys_t *)&config->pclken);
-	if (ret < 0) {
-		LOG_ERR("Could not turn on ADC clock (%d)", ret);
-		return ret;
-	}
-
-	/* configure common ADC instance */
-	LL_ADC_CommonStructInit(&adc_cinit);
-	if (config->adc_resolution == 6U) {
-		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV2;
-	} else {
-		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV4;
-	}
-	if (LL_ADC_CommonInit(__LL_ADC_COMMON_INSTANCE(config->adc),
-			      &adc_cinit) != SUCCESS) {
-		LOG_ERR("Could not initialize common ADC");
-		return -EIO;
-	}
-
 	/* configure ADC */
 	LL_ADC_StructInit(&adc_init);
 
@@ -141,7 +263,7 @@ static int adc_configure(const struct device *dev)
 		return ret;
 	}
 
-	if (LL_ADC_Init(config->adc, &adc_init) != SUCCESS) {
+	if (LL_ADC_Init(adc, &adc_init) != SUCCESS) {
 		LOG_ERR("Could not initialize ADC");
 		return -EIO;
 	}
@@ -149,7 +271,7 @@ static int adc_configure(const struct device *dev)
 	/* configure ADC (regular) */
 	LL_ADC_REG_StructInit(&adc_rinit);
 	adc_rinit.Overrun = LL_ADC_REG_OVR_DATA_PRESERVED;
-	if (LL_ADC_REG_Init(config->adc, &adc_rinit) != SUCCESS) {
+	if (LL_ADC_REG_Init(adc, &adc_rinit) != SUCCESS) {
 		LOG_ERR("Could not initialize ADC regular group");
 		return -EIO;
 	}
@@ -158,7 +280,7 @@ static int adc_configure(const struct device *dev)
 	LL_ADC_INJ_StructInit(&adc_jinit);
 	adc_jinit.TriggerSource =
 		config->adc_trigger | LL_ADC_INJ_TRIG_EXT_RISING;
-	if (LL_ADC_INJ_Init(config->adc, &adc_jinit) != SUCCESS) {
+	if (LL_ADC_INJ_Init(adc, &adc_jinit) != SUCCESS) {
 		LOG_ERR("Could not initialize ADC injected group");
 		return -EIO;
 	}
@@ -170,29 +292,29 @@ static int adc_configure(const struct device *dev)
 		return ret;
 	}
 
-	LL_ADC_SetChannelSamplingTime(config->adc, config->adc_ch_a, smp);
-	LL_ADC_SetChannelSamplingTime(config->adc, config->adc_ch_b, smp);
-	LL_ADC_SetChannelSamplingTime(config->adc, config->adc_ch_c, smp);
+	LL_ADC_SetChannelSamplingTime(adc, ch_a, smp);
+	LL_ADC_SetChannelSamplingTime(adc, ch_b, smp);
+	LL_ADC_SetChannelSamplingTime(adc, ch_c, smp);
 
 	/* enable internal ADC regulator */
 #if defined(CONFIG_SOC_SERIES_STM32G4X)
-	LL_ADC_DisableDeepPowerDown(config->adc);
+	LL_ADC_DisableDeepPowerDown(adc);
 #endif
-	LL_ADC_EnableInternalRegulator(config->adc);
+	LL_ADC_EnableInternalRegulator(adc);
 	k_busy_wait(LL_ADC_DELAY_INTERNAL_REGUL_STAB_US);
-	if (!LL_ADC_IsInternalRegulatorEnabled(config->adc)) {
+	if (!LL_ADC_IsInternalRegulatorEnabled(adc)) {
 		LOG_ERR("ADC internal regulator not enabled within expected "
 			"time");
 		return -EIO;
 	}
 
 	/* calibrate ADC */
-	LL_ADC_StartCalibration(config->adc, LL_ADC_SINGLE_ENDED);
-	while (LL_ADC_IsCalibrationOnGoing(config->adc))
+	LL_ADC_StartCalibration(adc, LL_ADC_SINGLE_ENDED);
+	while (LL_ADC_IsCalibrationOnGoing(adc))
 		;
 
 	/* wait to enable ADC after calibration */
-	ret = stm32_adc_clk_get(config->adc, &config->pclken, &adc_clk);
+	ret = stm32_adc_clk_get(adc, pclken, &adc_clk);
 	if (ret < 0) {
 		return ret;
 	}
@@ -201,45 +323,207 @@ static int adc_configure(const struct device *dev)
 				       LL_ADC_DELAY_CALIB_ENABLE_ADC_CYCLES)));
 
 	/* enable ADC */
-	LL_ADC_Enable(config->adc);
-	while (LL_ADC_IsActiveFlag_ADRDY(config->adc) != 1U)
+	LL_ADC_Enable(adc);
+	while (LL_ADC_IsActiveFlag_ADRDY(adc) != 1U)
 		;
 
+	return 0;
+}
+
+/**
+ * @brief Configure ADC.
+ *
+ * In dual ADC mode, the second (slave) ADC is configured in the same way, and
+ * its injected conversions are triggered by the first (master) one (injected
+ * simultaneous mode). The mode can only be set while both ADCs are disabled,
+ * so it is set before enabling them. Regular conversions, used for offsets
+ * calibration and tracking, remain independent on each ADC. Only the master
+ * ADC interrupt is enabled.
+ *
+ * @param[in] dev Current sampling device.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+static int adc_configure(const struct device *dev)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+
+	int ret;
+	const struct device *clk;
+	LL_ADC_CommonInitTypeDef adc_cinit;
+
+	/* enable ADC clock */
+	clk = DEVICE_DT_GET(STM32_CLOCK_CONTROL_NODE);
+	ret = clock_control_on(clk, (clock_control_subsys_t *)&config->pclken);
+	if (ret < 0) {
+		LOG_ERR("Could not turn on ADC clock (%d)", ret);
+		return ret;
+	}
+
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		ret = clock_control_on(
+			clk, (clock_control_subsys_t *)&config->dual_pclken);
+		if (ret < 0) {
+			LOG_ERR("Could not turn on dual ADC clock (%d)", ret);
+			return ret;
+		}
+	}
+#endif
+
+	/* configure common ADC instance */
+	LL_ADC_CommonStructInit(&adc_cinit);
+	if (config->adc_resolution == 6U) {
+		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV2;
+	} else {
+		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV4;
+	}
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		adc_cinit.Multimode = LL_ADC_MULTI_DUAL_INJ_SIMULT;
+	}
+#endif
+	if (LL_ADC_CommonInit(__LL_ADC_COMMON_INSTANCE(config->adc),
+			      &adc_cinit) != SUCCESS) {
+		LOG_ERR("Could not initialize common ADC");
+		return -EIO;
+	}
+
+	/* configure and enable ADC(s) */
+	ret = adc_enable(dev, config->adc, &config->pclken, config->adc_ch_a,
+			 config->adc_ch_b, config->adc_ch_c);
+	if (ret < 0) {
+		return ret;
+	}
+
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		ret = adc_enable(dev, config->dual_adc, &config->dual_pclken,
+				 config->dual_adc_ch_a, config->dual_adc_ch_b,
+				 config->dual_adc_ch_c);
+		if (ret < 0) {
+			return ret;
+		}
+	}
+#endif
+
 	/* configure ADC IRQ */
 	LL_ADC_EnableIT_JEOS(config->adc);
 
-	IRQ_DIRECT_CONNECT(DT_IRQ_BY_IDX(DT_INST_PARENT(0), 0, irq),
-			   DT_IRQ_BY_IDX(DT_INST_PARENT(0), 0, priority),
-			   adc_irq, IRQ_ZERO_LATENCY);
+	config->irq_config();
 	irq_enable(config->adc_irq);
 
 	return 0;
 }
 
 /**
- * @brief Perform regular ADC read.
+ * @brief Calibrate an offset (averaged regular ADC read).
  *
- * @param dev Current sampling device
+ * @param adc ADC instance
  * @param channel ADC channel
  *
- * @return Sample value.
+ * @return Average of CONFIG_SPINNER_CURRSMP_SHUNT_STM32_OFFSET_SAMPLES samples.
  */
-static uint16_t adc_read(const struct device *dev, uint32_t channel)
+static inline uint16_t adc_read_avg(ADC_TypeDef *adc, uint32_t channel)
 {
-	const struct currsmp_shunt_stm32_config *config = dev->config;
+	return stm32_adc_read_avg(adc, channel, OFFSET_SAMPLES);
+}
 
-	/* configure sequencer: only one channel */
-	LL_ADC_REG_SetSequencerLength(config->adc, LL_ADC_REG_SEQ_SCAN_DISABLE);
-	LL_ADC_REG_SetSequencerRanks(config->adc, LL_ADC_REG_RANK_1, channel);
+#if OFFSET_TRACKING
+/**
+ * @brief Start offsets tracking.
+ *
+ * Regular conversions of the a, b, c channels are triggered by the SV-PWM
+ * device on zero-vector windows (all high-side switches on), when no current
+ * flows through the shunts. One channel is converted on each trigger
+ * (discontinuous mode).
+ *
+ * @param dev Current sampling device
+ */
+static void offsets_track_start(const struct device *dev)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+	struct currsmp_shunt_stm32_data *data = dev->data;
 
-	/* perform regular conversion */
+	data->trk_acc[0] = (uint32_t)data->offsets.a << OFFSET_TRK_SHIFT;
+	data->trk_acc[1] = (uint32_t)data->offsets.b << OFFSET_TRK_SHIFT;
+	data->trk_acc[2] = (uint32_t)data->offsets.c << OFFSET_TRK_SHIFT;
+	data->trk_phase = 0U;
+
+	LL_ADC_REG_SetSequencerLength(config->adc,
+				      LL_ADC_REG_SEQ_SCAN_ENABLE_3RANKS);
+	LL_ADC_REG_SetSequencerRanks(config->adc, LL_ADC_REG_RANK_1,
+				     config->adc_ch_a);
+	LL_ADC_REG_SetSequencerRanks(config->adc, LL_ADC_REG_RANK_2,
+				     config->adc_ch_b);
+	LL_ADC_REG_SetSequencerRanks(config->adc, LL_ADC_REG_RANK_3,
+				     config->adc_ch_c);
+	LL_ADC_REG_SetSequencerDiscont(config->adc,
+				       LL_ADC_REG_SEQ_DISCONT_1RANK);
+	LL_ADC_REG_SetTriggerSource(config->adc,
+				    config->adc_reg_trigger |
+					    LL_ADC_REG_TRIG_EXT_RISING);
+
+	LL_ADC_ClearFlag_EOC(config->adc);
+	LL_ADC_ClearFlag_EOS(config->adc);
 	LL_ADC_REG_StartConversion(config->adc);
-	while (LL_ADC_IsActiveFlag_EOS(config->adc) != 1U)
+}
+
+/**
+ * @brief Stop offsets tracking.
+ *
+ * @param dev Current sampling device
+ */
+static void offsets_track_stop(const struct device *dev)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+
+	LL_ADC_REG_StopConversion(config->adc);
+	while (LL_ADC_REG_IsStopConversionOngoing(config->adc) != 0U)
 		;
 
-	LL_ADC_ClearFlag_EOS(config->adc);
+	LL_ADC_REG_SetSequencerDiscont(config->adc,
+				       LL_ADC_REG_SEQ_DISCONT_DISABLE);
+	LL_ADC_REG_SetTriggerSource(config->adc, LL_ADC_REG_TRIG_SOFTWARE);
+}
+#endif
+
+/**
+ * @brief Obtain raw phase currents (in ADC counts, offset corrected).
+ *
+ * @param[in] dev Current sampling device.
+ * @param[out] i_a Phase a current.
+ * @param[out] i_b Phase b current.
+ * @param[out] i_c Phase c current.
+ */
+static inline void get_raw_currents(const struct device *dev, int16_t *i_a,
+				    int16_t *i_b, int16_t *i_c)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+	struct currsmp_shunt_stm32_data *data = dev->data;
+
+	uint16_t val_ch1;
+	uint16_t val_ch2;
+
+	val_ch1 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
+							    LL_ADC_INJ_RANK_1);
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		val_ch2 = (uint16_t)LL_ADC_INJ_ReadConversionData32(
+			config->dual_adc, LL_ADC_INJ_RANK_1);
+
+		shunt_get_currents(data->sector, val_ch1, val_ch2,
+				   &data->offsets, &data->dual_offsets, i_a,
+				   i_b, i_c);
+		return;
+	}
+#endif
+
+	val_ch2 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
+							    LL_ADC_INJ_RANK_2);
 
-	return (uint16_t)LL_ADC_REG_ReadConversionData32(config->adc);
+	shunt_get_currents(data->sector, val_ch1, val_ch2, &data->offsets,
+			   &data->offsets, i_a, i_b, i_c);
 }
 
 /*******************************************************************************
@@ -260,58 +544,32 @@ static void currsmp_shunt_stm32_get_currents(const struct device *dev,
 					     struct currsmp_curr *curr)
 {
 	const struct currsmp_shunt_stm32_config *config = dev->config;
-	struct currsmp_shunt_stm32_data *data = dev->data;
-
-	uint16_t val_ch1;
-	uint16_t val_ch2;
-	int16_t i_a = 0, i_b = 0, i_c = 0;
 
-	val_ch1 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
-							    LL_ADC_INJ_RANK_1);
-	val_ch2 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
-							    LL_ADC_INJ_RANK_2);
+	int16_t i_a, i_b, i_c;
 
-	switch (data->sector) {
-	case 1U:
-		i_b = data->i_b_offset - val_ch1;
-		i_c = data->i_c_offset - val_ch2;
-		i_a = -(i_b + i_c);
-		break;
-	case 2U:
-		i_a = data->i_a_offset - val_ch1;
-		i_c = data->i_c_offset - val_ch2;
-		i_b = -(i_a + i_c);
-		break;
-	case 3U:
-		i_a = data->i_a_offset - val_ch1;
-		i_c = data->i_c_offset - val_ch2;
-		i_b = -(i_a + i_c);
-		break;
-	case 4U:
-		i_a = data->i_a_offset - val_ch2;
-		i_b = data->i_b_offset - val_ch1;
-		i_c = -(i_a + i_b);
-		break;
-	case 5U:
-		i_a = data->i_a_offset - val_ch2;
-		i_b = data->i_b_offset - val_ch1;
-		i_c = -(i_a + i_b);
-		break;
-	case 6U:
-		i_b = data->i_b_offset - val_ch1;
-		i_c = data->i_c_offset - val_ch2;
-		i_a = -(i_b + i_c);
-		break;
-	default:
-		__ASSERT(NULL, "Unexpected sector");
-		break;
-	}
+	get_raw_currents(dev, &i_a, &i_b, &i_c);
 
 	curr->i_a = (float)i_a / (2U << (config->adc_resolution - 1U));
 	curr->i_b = (float)i_b / (2U << (config->adc_resolution - 1U));
 	curr->i_c = (float)i_c / (2U << (config->adc_resolution - 1U));
 }
 
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void currsmp_shunt_stm32_get_currents_q31(const struct device *dev,
+						 struct currsmp_curr_q31 *curr)
+{
+	const struct currsmp_shunt_stm32_config *config = dev->config;
+
+	int16_t i_a, i_b, i_c;
+
+	get_raw_currents(dev, &i_a, &i_b, &i_c);
+
+	curr->i_a = shunt_to_q31(i_a, config->adc_resolution);
+	curr->i_b = shunt_to_q31(i_b, config->adc_resolution);
+	curr->i_c = shunt_to_q31(i_c, config->adc_resolution);
+}
+#endif
+
 static void currsmp_shunt_stm32_set_sector(const struct device *dev,
 					   uint8_t sector)
 {
@@ -320,6 +578,11 @@ static void currsmp_shunt_stm32_set_sector(const struct device *dev,
 
 	data->sector = sector;
 	config->adc->JSQR = data->jsqr[sector / 2U % 3U];
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		config->dual_adc->JSQR = data->dual_jsqr[sector / 2U % 3U];
+	}
+#endif
 }
 
 static uint32_t currsmp_shunt_stm32_get_smp_time(const struct device *dev)
@@ -342,6 +605,14 @@ static uint32_t currsmp_shunt_stm32_get_smp_time(const struct device *dev)
 		return 0U;
 	}
 
+#if DUAL_ADC
+	/* both channels sampled simultaneously */
+	if (config->dual_adc != NULL) {
+		return (uint32_t)((1.0e9f / (float)clk) *
+				  (t_sar + (float)config->adc_tsample));
+	}
+#endif
+
 	return (uint32_t)((1.0e9f / (float)clk) *
 			  (t_sar + 2.0f * (float)config->adc_tsample));
 }
@@ -351,12 +622,32 @@ static void currsmp_shunt_stm32_start(const struct device *dev)
 	const struct currsmp_shunt_stm32_config *config = dev->config;
 	struct currsmp_shunt_stm32_data *data = dev->data;
 
-	/* calibrate a, b, c offset */
+	/* calibrate a, b, c offset (averaged) */
 	LL_ADC_ClearFlag_EOS(config->adc);
 
-	data->i_a_offset = adc_read(dev, config->adc_ch_a);
-	data->i_b_offset = adc_read(dev, config->adc_ch_b);
-	data->i_c_offset = adc_read(dev, config->adc_ch_c);
+	data->offsets.a = adc_read_avg(config->adc, config->adc_ch_a);
+	data->offsets.b = adc_read_avg(config->adc, config->adc_ch_b);
+	data->offsets.c = adc_read_avg(config->adc, config->adc_ch_c);
+
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		LL_ADC_ClearFlag_EOS(config->dual_adc);
+
+		data->dual_offsets.a =
+			adc_read_avg(config->dual_adc, config->dual_adc_ch_a);
+		data->dual_offsets.b =
+			adc_read_avg(config->dual_adc, config->dual_adc_ch_b);
+		data->dual_offsets.c =
+			adc_read_avg(config->dual_adc, config->dual_adc_ch_c);
+	}
+#endif
+
+#if OFFSET_TRACKING
+	/* start regular conversions (triggered by sv-pwm on zero vectors) */
+	if (config->offset_tracking) {
+		offsets_track_start(dev);
+	}
+#endif
 
 	/* start injected conversions (triggered by sv-pwm) */
 	LL_ADC_ClearFlag_JEOS(config->adc);
@@ -373,6 +664,12 @@ static void currsmp_shunt_stm32_stop(const struct device *dev)
 
 	while (LL_ADC_INJ_IsConversionOngoing(config->adc) != 0U)
 		;
+
+#if OFFSET_TRACKING
+	if (config->offset_tracking) {
+		offsets_track_stop(dev);
+	}
+#endif
 }
 
 static void currsmp_shunt_stm32_pause(const struct device *dev)
@@ -392,6 +689,9 @@ static void currsmp_shunt_stm32_resume(const struct device *dev)
 static const struct currsmp_driver_api currsmp_shunt_stm32_driver_api = {
 	.configure = currsmp_shunt_stm32_configure,
 	.get_currents = currsmp_shunt_stm32_get_currents,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_currents_q31 = currsmp_shunt_stm32_get_currents_q31,
+#endif
 	.set_sector = currsmp_shunt_stm32_set_sector,
 	.get_smp_time = currsmp_shunt_stm32_get_smp_time,
 	.start = currsmp_shunt_stm32_start,
@@ -425,6 +725,27 @@ static int currsmp_shunt_stm32_init(const struct device *dev)
 	}
 
 	/* pre-compute ADC injected sequences */
+#if DUAL_ADC
+	if (config->dual_adc != NULL) {
+		/* rank 1 on master, rank 2 on slave (single conversion) */
+		data->jsqr[0] = adc_calc_jsqr_single(config->adc_trigger,
+						     config->adc_ch_b);
+		data->jsqr[1] = adc_calc_jsqr_single(config->adc_trigger,
+						     config->adc_ch_a);
+		data->jsqr[2] = adc_calc_jsqr_single(config->adc_trigger,
+						     config->adc_ch_b);
+
+		data->dual_jsqr[0] = adc_calc_jsqr_single(
+			config->adc_trigger, config->dual_adc_ch_c);
+		data->dual_jsqr[1] = adc_calc_jsqr_single(
+			config->adc_trigger, config->dual_adc_ch_c);
+		data->dual_jsqr[2] = adc_calc_jsqr_single(
+			config->adc_trigger, config->dual_adc_ch_a);
+
+		return 0;
+	}
+#endif
+
 	data->jsqr[0] = adc_calc_jsqr(config->adc_trigger, config->adc_ch_b,
 				      config->adc_ch_c);
 	data->jsqr[1] = adc_calc_jsqr(config->adc_trigger, config->adc_ch_a,
@@ -435,27 +756,90 @@ static int currsmp_shunt_stm32_init(const struct device *dev)
 	return 0;
 }
 
-PINCTRL_DT_INST_DEFINE(0);
-
-static const struct currsmp_shunt_stm32_config currsmp_shunt_stm32_config = {
-	.adc = (ADC_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(0)),
-	.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(0)),
-	.adc_irq = DT_IRQ_BY_IDX(DT_INST_PARENT(0), 0, irq),
-	.adc_resolution = DT_INST_PROP(0, adc_resolution),
-	.adc_tsample = DT_INST_PROP(0, adc_tsample),
-	.adc_ch_a = __LL_ADC_DECIMAL_NB_TO_CHANNEL(
-		DT_INST_PROP_BY_IDX(0, adc_channels, 0)),
-	.adc_ch_b = __LL_ADC_DECIMAL_NB_TO_CHANNEL(
-		DT_INST_PROP_BY_IDX(0, adc_channels, 1)),
-	.adc_ch_c = __LL_ADC_DECIMAL_NB_TO_CHANNEL(
-		DT_INST_PROP_BY_IDX(0, adc_channels, 2)),
-	.adc_trigger = DT_INST_PROP(0, adc_trigger),
-	.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(0),
-};
+#if OFFSET_TRACKING
+#define CURRSMP_SHUNT_STM32_OFFSET_TRACKING(inst)                              \
+	.offset_tracking = DT_INST_NODE_HAS_PROP(inst, adc_reg_trigger),       \
+	.adc_reg_trigger = DT_INST_PROP_OR(inst, adc_reg_trigger, 0),
+#else
+#define CURRSMP_SHUNT_STM32_OFFSET_TRACKING(inst)
+#endif
 
-static struct currsmp_shunt_stm32_data currsmp_shunt_stm32_data;
+#if DUAL_ADC
+#define CURRSMP_SHUNT_STM32_DUAL_ADC(inst)                                     \
+	.dual_adc =                                                            \
+		(ADC_TypeDef *)DT_REG_ADDR(DT_INST_PHANDLE(inst, dual_adc)),   \
+	.dual_pclken = STM32_CLOCK_INFO(0, DT_INST_PHANDLE(inst, dual_adc)),   \
+	.dual_adc_ch_a = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                       \
+		DT_INST_PROP_BY_IDX(inst, dual_adc_channels, 0)),              \
+	.dual_adc_ch_b = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                       \
+		DT_INST_PROP_BY_IDX(inst, dual_adc_channels, 1)),              \
+	.dual_adc_ch_c = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                       \
+		DT_INST_PROP_BY_IDX(inst, dual_adc_channels, 2)),
+#endif
 
-DEVICE_DT_INST_DEFINE(0, &currsmp_shunt_stm32_init, NULL,
-		      &currsmp_shunt_stm32_data, &currsmp_shunt_stm32_config,
-		      POST_KERNEL, CONFIG_SPINNER_CURRSMP_INIT_PRIORITY,
-		      &currsmp_shunt_stm32_driver_api);
+/** ADC IRQ line of an instance. */
+#define ADC_IRQ(inst) DT_IRQ_BY_IDX(DT_INST_PARENT(inst), 0, irq)
+
+/*
+ * IRQs are connected per instance, so instances can not share the ADC IRQ line
+ * (e.g. ADC1 and ADC2 on STM32G4).
+ */
+#define CURRSMP_SHUNT_STM32_IRQ_CHECK(i, inst)                                 \
+	BUILD_ASSERT(((i) == (inst)) || (ADC_IRQ(i) != ADC_IRQ(inst)),         \
+		     "ADC IRQ line shared with another instance");
+
+#define CURRSMP_SHUNT_STM32_INIT(inst)                                         \
+	BUILD_ASSERT(!DT_INST_NODE_HAS_PROP(inst, dual_adc) ||                 \
+			     DT_INST_NODE_HAS_PROP(inst, dual_adc_channels),   \
+		     "Dual ADC mode requires dual-adc-channels");              \
+	LISTIFY(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT),                        \
+		CURRSMP_SHUNT_STM32_IRQ_CHECK, (), inst)                       \
+                                                                               \
+                                                                               \
+	ISR_DIRECT_DECLARE(adc_irq_##inst)                                     \
+	{                                                                      \
+		adc_irq_handler(DEVICE_DT_INST_GET(inst));                     \
+		return 0;                                                      \
+	}                                                                      \
+                                                                               \
+	static void irq_config_##inst(void)                                    \
+	{                                                                      \
+		IRQ_DIRECT_CONNECT(                                            \
+			ADC_IRQ(inst),                                         \
+			DT_IRQ_BY_IDX(DT_INST_PARENT(inst), 0, priority),      \
+			adc_irq_##inst, IRQ_ZERO_LATENCY);                     \
+	}                                                                      \
+                                                                               \
+	PINCTRL_DT_INST_DEFINE(inst);                                          \
+                                                                               \
+	static const struct currsmp_shunt_stm32_config                         \
+		currsmp_shunt_stm32_config_##inst = {                          \
+		.adc = (ADC_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(inst)),       \
+		.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(inst)),           \
+		.adc_irq = ADC_IRQ(inst),                                      \
+		.adc_resolution = DT_INST_PROP(inst, adc_resolution),          \
+		.adc_tsample = DT_INST_PROP(inst, adc_tsample),                \
+		.adc_ch_a = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                    \
+			DT_INST_PROP_BY_IDX(inst, adc_channels, 0)),           \
+		.adc_ch_b = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                    \
+			DT_INST_PROP_BY_IDX(inst, adc_channels, 1)),           \
+		.adc_ch_c = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                    \
+			DT_INST_PROP_BY_IDX(inst, adc_channels, 2)),           \
+		.adc_trigger = DT_INST_PROP(inst, adc_trigger),                \
+		.irq_config = irq_config_##inst,                               \
+		CURRSMP_SHUNT_STM32_OFFSET_TRACKING(inst)                      \
+		IF_ENABLED(DT_INST_NODE_HAS_PROP(inst, dual_adc),              \
+			   (CURRSMP_SHUNT_STM32_DUAL_ADC(inst)))               \
+		.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(inst),                  \
+	};                                                                     \
+                                                                               \
+	static struct currsmp_shunt_stm32_data                                 \
+		currsmp_shunt_stm32_data_##inst;                               \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &currsmp_shunt_stm32_init, NULL,           \
+			      &currsmp_shunt_stm32_data_##inst,                \
+			      &currsmp_shunt_stm32_config_##inst, POST_KERNEL, \
+			      CONFIG_SPINNER_CURRSMP_INIT_PRIORITY,            \
+			      &currsmp_shunt_stm32_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(CURRSMP_SHUNT_STM32_INIT)
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT teslabs_sim_currsmp
+
+#include <zephyr/logging/log.h>
+
+#include <spinner/drivers/currsmp.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/utils/mathutil.h>
+
+LOG_MODULE_REGISTER(currsmp_sim, CONFIG_SPINNER_CURRSMP_LOG_LEVEL);
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct currsmp_sim_config {
+	const struct device *plant;
+	float i_fs;
+	uint32_t t_sample;
+};
+
+struct currsmp_sim_data {
+	bool started;
+};
+
+/**
+ * @brief Obtain phase currents, relative to the full-scale current.
+ *
+ * @param[in] dev Current sampling device.
+ * @param[out] i_a Phase a current.
+ * @param[out] i_b Phase b current.
+ * @param[out] i_c Phase c current.
+ */
+static inline void get_norm_currents(const struct device *dev, float *i_a,
+				     float *i_b, float *i_c)
+{
+	const struct currsmp_sim_config *config = dev->config;
+
+	struct pmsm pmsm;
+
+	pmsm_sim_get_state(config->plant, &pmsm);
+	pmsm_get_currents(&pmsm, i_a, i_b, i_c);
+
+	*i_a /= config->i_fs;
+	*i_b /= config->i_fs;
+	*i_c /= config->i_fs;
+}
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static void currsmp_sim_configure(const struct device *dev,
+				  currsmp_regulation_cb_t regulation_cb,
+				  void *ctx)
+{
+	const struct currsmp_sim_config *config = dev->config;
+
+	pmsm_sim_set_callback(config->plant, regulation_cb, ctx);
+}
+
+static void currsmp_sim_get_currents(const struct device *dev,
+				     struct currsmp_curr *curr)
+{
+	get_norm_currents(dev, &curr->i_a, &curr->i_b, &curr->i_c);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void currsmp_sim_get_currents_q31(const struct device *dev,
+					 struct currsmp_curr_q31 *curr)
+{
+	float i_a, i_b, i_c;
+
+	get_norm_currents(dev, &i_a, &i_b, &i_c);
+
+	curr->i_a = f32_to_q31(i_a);
+	curr->i_b = f32_to_q31(i_b);
+	curr->i_c = f32_to_q31(i_c);
+}
+#endif
+
+static void currsmp_sim_set_sector(const struct device *dev, uint8_t sector)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(sector);
+}
+
+static uint32_t currsmp_sim_get_smp_time(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+
+	return config->t_sample;
+}
+
+static void currsmp_sim_start(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+	struct currsmp_sim_data *data = dev->data;
+
+	data->started = true;
+	pmsm_sim_enable_sampling(config->plant, true);
+}
+
+static void currsmp_sim_stop(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+	struct currsmp_sim_data *data = dev->data;
+
+	data->started = false;
+	pmsm_sim_enable_sampling(config->plant, false);
+}
+
+static void currsmp_sim_pause(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+
+	pmsm_sim_enable_sampling(config->plant, false);
+}
+
+static void currsmp_sim_resume(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+	struct currsmp_sim_data *data = dev->data;
+
+	pmsm_sim_enable_sampling(config->plant, data->started);
+}
+
+static const struct currsmp_driver_api currsmp_sim_driver_api = {
+	.configure = currsmp_sim_configure,
+	.get_currents = currsmp_sim_get_currents,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_currents_q31 = currsmp_sim_get_currents_q31,
+#endif
+	.set_sector = currsmp_sim_set_sector,
+	.get_smp_time = currsmp_sim_get_smp_time,
+	.start = currsmp_sim_start,
+	.stop = currsmp_sim_stop,
+	.pause = currsmp_sim_pause,
+	.resume = currsmp_sim_resume,
+};
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int currsmp_sim_init(const struct device *dev)
+{
+	const struct currsmp_sim_config *config = dev->config;
+
+	if (!device_is_ready(config->plant)) {
+		LOG_ERR("Plant device not ready");
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+#define CURRSMP_SIM_INIT(inst)                                                 \
+	static const struct currsmp_sim_config currsmp_sim_config_##inst = {  \
+		.plant = DEVICE_DT_GET(DT_INST_PARENT(inst)),                  \
+		.i_fs = DT_INST_PROP(inst, i_full_scale_milliamps) * 1e-3f,    \
+		.t_sample = DT_INST_PROP(inst, t_sample_ns),                   \
+	};                                                                     \
+                                                                               \
+	static struct currsmp_sim_data currsmp_sim_data_##inst;                \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &currsmp_sim_init, NULL,                   \
+			      &currsmp_sim_data_##inst,                        \
+			      &currsmp_sim_config_##inst, POST_KERNEL,         \
+			      CONFIG_SPINNER_CURRSMP_INIT_PRIORITY,            \
+			      &currsmp_sim_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(CURRSMP_SIM_INIT)
@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT st_stm32_currsmp_single_shunt
+
+#include <zephyr/drivers/clock_control/stm32_clock_control.h>
+#include <zephyr/drivers/pinctrl.h>
+#include <zephyr/irq.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <stm32_ll_adc.h>
+
+#include <spinner/drivers/currsmp.h>
+#include <spinner/utils/shunt.h>
+#include <spinner/utils/stm32_adc.h>
+
+LOG_MODULE_REGISTER(currsmp_single_shunt_stm32,
+		    CONFIG_SPINNER_CURRSMP_LOG_LEVEL);
+
+/** Offset calibration samples. */
+#define OFFSET_SAMPLES CONFIG_SPINNER_CURRSMP_SINGLE_SHUNT_STM32_OFFSET_SAMPLES
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct currsmp_single_shunt_stm32_config {
+	ADC_TypeDef *adc;
+	struct stm32_pclken pclken;
+	uint32_t adc_irq;
+	uint8_t adc_resolution;
+	uint16_t adc_tsample;
+	uint32_t adc_ch;
+	uint32_t adc_trigger;
+	void (*irq_config)(void);
+	const struct pinctrl_dev_config *pcfg;
+};
+
+struct currsmp_single_shunt_stm32_data {
+	currsmp_regulation_cb_t regulation_cb;
+	void *regulation_ctx;
+	uint16_t offset;
+	uint8_t sector;
+};
+
+/**
+ * @brief ADC IRQ handler.
+ *
+ * @param[in] dev Current sampling device.
+ */
+static inline void adc_irq_handler(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+	struct currsmp_single_shunt_stm32_data *data = dev->data;
+
+	if (LL_ADC_IsActiveFlag_JEOS(config->adc)) {
+		LL_ADC_ClearFlag_JEOS(config->adc);
+		data->regulation_cb(data->regulation_ctx);
+	}
+}
+
+/**
+ * Compute the ADC injected sequence register (JSQR) for the given channel.
+ *
+ * The channel is converted twice (ranks 1 and 2), one rank per trigger
+ * (injected discontinuous mode).
+ *
+ * @param[in] trigger ADC trigger.
+ * @param[in] ch Channel.
+ *
+ * @return Computed JSQR register value.
+ */
+static uint32_t adc_calc_jsqr(uint32_t trigger, uint32_t ch)
+{
+	uint32_t jsqr;
+
+	uint8_t ch_nb = __LL_ADC_CHANNEL_TO_DECIMAL_NB(ch);
+
+#ifdef CONFIG_SOC_SERIES_STM32F3X
+	/* F3X ADC uses channels 1..18, indexed from 0..17 */
+	ch_nb--;
+#endif
+
+	jsqr = ((ch_nb & ADC_INJ_RANK_ID_JSQR_MASK)
+		<< ADC_INJ_RANK_1_JSQR_BITOFFSET_POS) |
+	       ((ch_nb & ADC_INJ_RANK_ID_JSQR_MASK)
+		<< ADC_INJ_RANK_2_JSQR_BITOFFSET_POS) |
+	       LL_ADC_INJ_TRIG_EXT_RISING | trigger | 1U;
+
+	return jsqr;
+}
+
+/**
+ * @brief Configure ADC.
+ *
+ * @param[in] dev Current sampling device.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+static int adc_configure(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	int ret;
+	const struct device *clk;
+	uint32_t smp;
+	LL_ADC_CommonInitTypeDef adc_cinit;
+	LL_ADC_InitTypeDef adc_init;
+	LL_ADC_REG_InitTypeDef adc_rinit;
+	LL_ADC_INJ_InitTypeDef adc_jinit;
+	uint32_t adc_clk;
+
+	/* enable ADC clock */
+	clk = DEVICE_DT_GET(STM32_CLOCK_CONTROL_NODE);
+	ret = clock_control_on(clk, (clock_control_subsys_t *)&config->pclken);
+	if (ret < 0) {
+		LOG_ERR("Could not turn on ADC clock (%d)", ret);
+		return ret;
+	}
+
+	/* configure common ADC instance */
+	LL_ADC_CommonStructInit(&adc_cinit);
+	if (config->adc_resolution == 6U) {
+		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV2;
+	} else {
+		adc_cinit.CommonClock = LL_ADC_CLOCK_SYNC_PCLK_DIV4;
+	}
+	if (LL_ADC_CommonInit(__LL_ADC_COMMON_INSTANCE(config->adc),
+			      &adc_cinit) != SUCCESS) {
+		LOG_ERR("Could not initialize common ADC");
+		return -EIO;
+	}
+
+	/* configure ADC */
+	LL_ADC_StructInit(&adc_init);
+
+	ret = stm32_adc_res_get(config->adc_resolution, &adc_init.Resolution);
+	if (ret < 0) {
+		LOG_ERR("Unsupported ADC resolution");
+		return ret;
+	}
+
+	if (LL_ADC_Init(config->adc, &adc_init) != SUCCESS) {
+		LOG_ERR("Could not initialize ADC");
+		return -EIO;
+	}
+
+	/* configure ADC (regular) */
+	LL_ADC_REG_StructInit(&adc_rinit);
+	adc_rinit.Overrun = LL_ADC_REG_OVR_DATA_PRESERVED;
+	if (LL_ADC_REG_Init(config->adc, &adc_rinit) != SUCCESS) {
+		LOG_ERR("Could not initialize ADC regular group");
+		return -EIO;
+	}
+
+	/* configure ADC (injected) */
+	LL_ADC_INJ_StructInit(&adc_jinit);
+	adc_jinit.TriggerSource =
+		config->adc_trigger | LL_ADC_INJ_TRIG_EXT_RISING;
+	adc_jinit.SequencerLength = LL_ADC_INJ_SEQ_SCAN_ENABLE_2RANKS;
+	adc_jinit.SequencerDiscont = LL_ADC_INJ_SEQ_DISCONT_1RANK;
+	if (LL_ADC_INJ_Init(config->adc, &adc_jinit) != SUCCESS) {
+		LOG_ERR("Could not initialize ADC injected group");
+		return -EIO;
+	}
+
+	/* configure sampling time */
+	ret = stm32_adc_smp_get(config->adc_tsample, &smp);
+	if (ret < 0) {
+		LOG_ERR("Unsupported ADC sampling time");
+		return ret;
+	}
+
+	LL_ADC_SetChannelSamplingTime(config->adc, config->adc_ch, smp);
+
+	/* enable internal ADC regulator */
+#if defined(CONFIG_SOC_SERIES_STM32G4X)
+	LL_ADC_DisableDeepPowerDown(config->adc);
+#endif
+	LL_ADC_EnableInternalRegulator(config->adc);
+	k_busy_wait(LL_ADC_DELAY_INTERNAL_REGUL_STAB_US);
+	if (!LL_ADC_IsInternalRegulatorEnabled(config->adc)) {
+		LOG_ERR("ADC internal regulator not enabled within expected "
+			"time");
+		return -EIO;
+	}
+
+	/* calibrate ADC */
+	LL_ADC_StartCalibration(config->adc, LL_ADC_SINGLE_ENDED);
+	while (LL_ADC_IsCalibrationOnGoing(config->adc))
+		;
+
+	/* wait to enable ADC after calibration */
+	ret = stm32_adc_clk_get(config->adc, &config->pclken, &adc_clk);
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_busy_wait(MAX(1U, (uint32_t)((1.0e6f / (float)adc_clk) *
+				       LL_ADC_DELAY_CALIB_ENABLE_ADC_CYCLES)));
+
+	/* enable ADC */
+	LL_ADC_Enable(config->adc);
+	while (LL_ADC_IsActiveFlag_ADRDY(config->adc) != 1U)
+		;
+
+	/* configure ADC IRQ */
+	LL_ADC_EnableIT_JEOS(config->adc);
+
+	config->irq_config();
+	irq_enable(config->adc_irq);
+
+	return 0;
+}
+
+/**
+ * @brief Obtain raw phase currents (in ADC counts, offset corrected).
+ *
+ * @param[in] dev Current sampling device.
+ * @param[out] i_a Phase a current.
+ * @param[out] i_b Phase b current.
+ * @param[out] i_c Phase c current.
+ */
+static inline void get_raw_currents(const struct device *dev, int16_t *i_a,
+				    int16_t *i_b, int16_t *i_c)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+	struct currsmp_single_shunt_stm32_data *data = dev->data;
+
+	uint16_t smp1;
+	uint16_t smp2;
+
+	smp1 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
+							 LL_ADC_INJ_RANK_1);
+	smp2 = (uint16_t)LL_ADC_INJ_ReadConversionData32(config->adc,
+							 LL_ADC_INJ_RANK_2);
+
+	shunt_single_get_currents(data->sector, smp1, smp2, data->offset, i_a,
+				  i_b, i_c);
+}
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static void
+currsmp_single_shunt_stm32_configure(const struct device *dev,
+				     currsmp_regulation_cb_t regulation_cb,
+				     void *ctx)
+{
+	struct currsmp_single_shunt_stm32_data *data = dev->data;
+
+	data->regulation_cb = regulation_cb;
+	data->regulation_ctx = ctx;
+}
+
+static void currsmp_single_shunt_stm32_get_currents(const struct device *dev,
+						    struct currsmp_curr *curr)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	int16_t i_a, i_b, i_c;
+
+	get_raw_currents(dev, &i_a, &i_b, &i_c);
+
+	curr->i_a = (float)i_a / (2U << (config->adc_resolution - 1U));
+	curr->i_b = (float)i_b / (2U << (config->adc_resolution - 1U));
+	curr->i_c = (float)i_c / (2U << (config->adc_resolution - 1U));
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void
+currsmp_single_shunt_stm32_get_currents_q31(const struct device *dev,
+					    struct currsmp_curr_q31 *curr)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	int16_t i_a, i_b, i_c;
+
+	get_raw_currents(dev, &i_a, &i_b, &i_c);
+
+	curr->i_a = shunt_to_q31(i_a, config->adc_resolution);
+	curr->i_b = shunt_to_q31(i_b, config->adc_resolution);
+	curr->i_c = shunt_to_q31(i_c, config->adc_resolution);
+}
+#endif
+
+static void currsmp_single_shunt_stm32_set_sector(const struct device *dev,
+						  uint8_t sector)
+{
+	struct currsmp_single_shunt_stm32_data *data = dev->data;
+
+	/* NOTE: sector gives the phases order of the sampled period */
+	data->sector = sector;
+}
+
+static uint32_t
+currsmp_single_shunt_stm32_get_smp_time(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	int ret;
+	uint32_t clk;
+	float t_sar;
+
+	ret = stm32_adc_clk_get(config->adc, &config->pclken, &clk);
+	if (ret < 0) {
+		LOG_ERR("Could not obtain ADC clock rate");
+		return 0U;
+	}
+
+	ret = stm32_adc_t_sar_get(config->adc_resolution, &t_sar);
+	if (ret < 0) {
+		LOG_ERR("Could not obtain ADC SAR time");
+		return 0U;
+	}
+
+	return (uint32_t)((1.0e9f / (float)clk) *
+			  (t_sar + (float)config->adc_tsample));
+}
+
+static void currsmp_single_shunt_stm32_start(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+	struct currsmp_single_shunt_stm32_data *data = dev->data;
+
+	/* calibrate offset (averaged) */
+	LL_ADC_ClearFlag_EOS(config->adc);
+
+	data->offset =
+		stm32_adc_read_avg(config->adc, config->adc_ch, OFFSET_SAMPLES);
+
+	/* start injected conversions (triggered twice per period by sv-pwm) */
+	config->adc->JSQR = adc_calc_jsqr(config->adc_trigger, config->adc_ch);
+	LL_ADC_ClearFlag_JEOS(config->adc);
+	LL_ADC_INJ_StartConversion(config->adc);
+}
+
+static void currsmp_single_shunt_stm32_stop(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	LL_ADC_INJ_StopConversion(config->adc);
+	while (LL_ADC_INJ_IsStopConversionOngoing(config->adc) != 0U)
+		;
+
+	while (LL_ADC_INJ_IsConversionOngoing(config->adc) != 0U)
+		;
+}
+
+static void currsmp_single_shunt_stm32_pause(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	LL_ADC_DisableIT_JEOS(config->adc);
+}
+
+static void currsmp_single_shunt_stm32_resume(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	LL_ADC_EnableIT_JEOS(config->adc);
+}
+
+static const struct currsmp_driver_api currsmp_single_shunt_stm32_driver_api = {
+	.configure = currsmp_single_shunt_stm32_configure,
+	.get_currents = currsmp_single_shunt_stm32_get_currents,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_currents_q31 = currsmp_single_shunt_stm32_get_currents_q31,
+#endif
+	.set_sector = currsmp_single_shunt_stm32_set_sector,
+	.get_smp_time = currsmp_single_shunt_stm32_get_smp_time,
+	.start = currsmp_single_shunt_stm32_start,
+	.stop = currsmp_single_shunt_stm32_stop,
+	.pause = currsmp_single_shunt_stm32_pause,
+	.resume = currsmp_single_shunt_stm32_resume,
+};
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int currsmp_single_shunt_stm32_init(const struct device *dev)
+{
+	const struct currsmp_single_shunt_stm32_config *config = dev->config;
+
+	int ret;
+
+	/* configure pinmux */
+	ret = pinctrl_apply_state(config->pcfg, PINCTRL_STATE_DEFAULT);
+	if (ret < 0) {
+		LOG_ERR("pinctrl setup failed (%d)", ret);
+		return ret;
+	}
+
+	/* configure ADC */
+	return adc_configure(dev);
+}
+
+/** ADC IRQ line of an instance. */
+#define ADC_IRQ(inst) DT_IRQ_BY_IDX(DT_INST_PARENT(inst), 0, irq)
+
+/** ADC IRQ line of a shunt current sampling instance. */
+#define SHUNT_ADC_IRQ(i)                                                       \
+	DT_IRQ_BY_IDX(DT_PARENT(DT_INST(i, st_stm32_currsmp_shunt)), 0, irq)
+
+/*
+ * IRQs are connected per instance, so instances (of this or the shunt driver)
+ * can not share the ADC IRQ line (e.g. ADC1 and ADC2 on STM32G4).
+ */
+#define CURRSMP_SINGLE_SHUNT_STM32_IRQ_CHECK(i, inst)                          \
+	BUILD_ASSERT(((i) == (inst)) || (ADC_IRQ(i) != ADC_IRQ(inst)),         \
+		     "ADC IRQ line shared with another instance");
+
+#define CURRSMP_SINGLE_SHUNT_STM32_SHUNT_IRQ_CHECK(i, inst)                    \
+	BUILD_ASSERT(SHUNT_ADC_IRQ(i) != ADC_IRQ(inst),                        \
+		     "ADC IRQ line shared with a shunt instance");
+
+#define CURRSMP_SINGLE_SHUNT_STM32_INIT(inst)                                  \
+	LISTIFY(DT_NUM_INST_STATUS_OKAY(DT_DRV_COMPAT),                        \
+		CURRSMP_SINGLE_SHUNT_STM32_IRQ_CHECK, (), inst)                \
+	LISTIFY(DT_NUM_INST_STATUS_OKAY(st_stm32_currsmp_shunt),               \
+		CURRSMP_SINGLE_SHUNT_STM32_SHUNT_IRQ_CHECK, (), inst)          \
+                                                                               \
+	ISR_DIRECT_DECLARE(adc_irq_##inst)                                     \
+	{                                                                      \
+		adc_irq_handler(DEVICE_DT_INST_GET(inst));                     \
+		return 0;                                                      \
+	}                                                                      \
+                                                                               \
+	static void irq_config_##inst(void)                                    \
+	{                                                                      \
+		IRQ_DIRECT_CONNECT(                                            \
+			ADC_IRQ(inst),                                         \
+			DT_IRQ_BY_IDX(DT_INST_PARENT(inst), 0, priority),      \
+			adc_irq_##inst, IRQ_ZERO_LATENCY);                     \
+	}                                                                      \
+                                                                               \
+	PINCTRL_DT_INST_DEFINE(inst);                                          \
+                                                                               \
+	static const struct currsmp_single_shunt_stm32_config                  \
+		currsmp_single_shunt_stm32_config_##inst = {                   \
+		.adc = (ADC_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(inst)),       \
+		.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(inst)),           \
+		.adc_irq = ADC_IRQ(inst),                                      \
+		.adc_resolution = DT_INST_PROP(inst, adc_resolution),          \
+		.adc_tsample = DT_INST_PROP(inst, adc_tsample),                \
+		.adc_ch = __LL_ADC_DECIMAL_NB_TO_CHANNEL(                      \
+			DT_INST_PROP(inst, adc_channel)),                      \
+		.adc_trigger = DT_INST_PROP(inst, adc_trigger),                \
+		.irq_config = irq_config_##inst,                               \
+		.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(inst),                  \
+	};                                                                     \
+                                                                               \
+	static struct currsmp_single_shunt_stm32_data                          \
+		currsmp_single_shunt_stm32_data_##inst;                        \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &currsmp_single_shunt_stm32_init, NULL,    \
+			      &currsmp_single_shunt_stm32_data_##inst,         \
+			      &currsmp_single_shunt_stm32_config_##inst,       \
+			      POST_KERNEL,                                     \
+			      CONFIG_SPINNER_CURRSMP_INIT_PRIORITY,            \
+			      &currsmp_single_shunt_stm32_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(CURRSMP_SINGLE_SHUNT_STM32_INIT)
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT teslabs_sim_feedback
+
+#include <zephyr/logging/log.h>
+
+#include <spinner/drivers/feedback.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/utils/mathutil.h>
+
+LOG_MODULE_REGISTER(feedback_sim, CONFIG_SPINNER_FEEDBACK_LOG_LEVEL);
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct feedback_sim_config {
+	const struct device *plant;
+};
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static float feedback_sim_get_eangle(const struct device *dev)
+{
+	const struct feedback_sim_config *config = dev->config;
+
+	struct pmsm pmsm;
+
+	pmsm_sim_get_state(config->plant, &pmsm);
+
+	return pmsm.theta_e * (360.0f / TWO_PI);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static int32_t feedback_sim_get_eangle_q31(const struct device *dev)
+{
+	const struct feedback_sim_config *config = dev->config;
+
+	struct pmsm pmsm;
+
+	pmsm_sim_get_state(config->plant, &pmsm);
+
+	/* NOTE: [0, 2 pi) maps to [0, 2^32), wrapping to [-1, 1) */
+	return (int32_t)(uint32_t)(uint64_t)(pmsm.theta_e *
+					     (4294967296.0f / TWO_PI));
+}
+#endif
+
+static float feedback_sim_get_speed(const struct device *dev)
+{
+	const struct feedback_sim_config *config = dev->config;
+
+	struct pmsm pmsm;
+
+	pmsm_sim_get_state(config->plant, &pmsm);
+
+	return pmsm_get_espeed(&pmsm) / TWO_PI;
+}
+
+static const struct feedback_driver_api feedback_sim_driver_api = {
+	.get_eangle = feedback_sim_get_eangle,
+	.get_speed = feedback_sim_get_speed,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_eangle_q31 = feedback_sim_get_eangle_q31,
+#endif
+};
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int feedback_sim_init(const struct device *dev)
+{
+	const struct feedback_sim_config *config = dev->config;
+
+	if (!device_is_ready(config->plant)) {
+		LOG_ERR("Plant device not ready");
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+#define FEEDBACK_SIM_INIT(inst)                                                \
+	static const struct feedback_sim_config feedback_sim_config_##inst = { \
+		.plant = DEVICE_DT_GET(DT_INST_PARENT(inst)),                  \
+	};                                                                     \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &feedback_sim_init, NULL, NULL,            \
+			      &feedback_sim_config_##inst, POST_KERNEL,        \
+			      CONFIG_KERNEL_INIT_PRIORITY_DEVICE,              \
+			      &feedback_sim_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(FEEDBACK_SIM_INIT)
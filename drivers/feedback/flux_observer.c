@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT teslabs_flux_observer
+
+#include <zephyr/logging/log.h>
+
+#include <spinner/drivers/feedback.h>
+#include <spinner/observer/flux.h>
+#include <spinner/utils/mathutil.h>
+
+LOG_MODULE_REGISTER(flux_observer, CONFIG_SPINNER_FEEDBACK_LOG_LEVEL);
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct flux_observer_config {
+	struct flux_obs_params params;
+	float i_fs;
+	float v_fs;
+};
+
+struct flux_observer_data {
+	flux_obs_t obs;
+	/* last inputs (SI units) */
+	float i_alpha;
+	float i_beta;
+	float v_alpha;
+	float v_beta;
+	bool ready;
+};
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static void flux_observer_configure(const struct device *dev, uint32_t freq)
+{
+	const struct flux_observer_config *config = dev->config;
+	struct flux_observer_data *data = dev->data;
+
+	struct flux_obs_params params = config->params;
+
+	params.ts = 1.0f / (float)freq;
+	flux_obs_init(&data->obs, &params);
+
+	data->i_alpha = 0.0f;
+	data->i_beta = 0.0f;
+	data->v_alpha = 0.0f;
+	data->v_beta = 0.0f;
+	data->ready = true;
+}
+
+static void flux_observer_update(const struct device *dev)
+{
+	struct flux_observer_data *data = dev->data;
+
+	if (!data->ready) {
+		return;
+	}
+
+	flux_obs_update(&data->obs, data->i_alpha, data->i_beta, data->v_alpha,
+			data->v_beta);
+}
+
+static void flux_observer_set_inputs(const struct device *dev,
+				     const struct feedback_inputs *inputs)
+{
+	const struct flux_observer_config *config = dev->config;
+	struct flux_observer_data *data = dev->data;
+
+	data->i_alpha = inputs->i_alpha * config->i_fs;
+	data->i_beta = inputs->i_beta * config->i_fs;
+	data->v_alpha = inputs->v_alpha * config->v_fs;
+	data->v_beta = inputs->v_beta * config->v_fs;
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void flux_observer_set_inputs_q31(const struct device *dev,
+					 const struct feedback_inputs_q31 *inputs)
+{
+	const struct feedback_inputs f32 = {
+		.i_alpha = (float)inputs->i_alpha / 2147483648.0f,
+		.i_beta = (float)inputs->i_beta / 2147483648.0f,
+		.v_alpha = (float)inputs->v_alpha / 2147483648.0f,
+		.v_beta = (float)inputs->v_beta / 2147483648.0f,
+	};
+
+	flux_observer_set_inputs(dev, &f32);
+}
+#endif
+
+static float flux_observer_get_eangle(const struct device *dev)
+{
+	struct flux_observer_data *data = dev->data;
+
+	return flux_obs_get_eangle(&data->obs);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static int32_t flux_observer_get_eangle_q31(const struct device *dev)
+{
+	struct flux_observer_data *data = dev->data;
+
+	/* NOTE: [0, 360) degrees maps to [0, 2^32), wrapping to [-1, 1) */
+	return (int32_t)(uint32_t)(uint64_t)(flux_obs_get_eangle(&data->obs) *
+					     (4294967296.0f / 360.0f));
+}
+#endif
+
+static float flux_observer_get_speed(const struct device *dev)
+{
+	struct flux_observer_data *data = dev->data;
+
+	if (!data->ready) {
+		return 0.0f;
+	}
+
+	return flux_obs_get_speed(&data->obs);
+}
+
+static const struct feedback_driver_api flux_observer_driver_api = {
+	.configure = flux_observer_configure,
+	.update = flux_observer_update,
+	.set_inputs = flux_observer_set_inputs,
+	.get_eangle = flux_observer_get_eangle,
+	.get_speed = flux_observer_get_speed,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.set_inputs_q31 = flux_observer_set_inputs_q31,
+	.get_eangle_q31 = flux_observer_get_eangle_q31,
+#endif
+};
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int flux_observer_init(const struct device *dev)
+{
+	const struct flux_observer_config *config = dev->config;
+
+	if ((config->params.l <= 0.0f) || (config->params.flux <= 0.0f)) {
+		LOG_ERR("Invalid motor parameters");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+#define MOTOR_NODE(inst) DT_INST_PHANDLE(inst, motor)
+
+#define FLUX_OBSERVER_INIT(inst)                                               \
+	static const struct flux_observer_config                               \
+		flux_observer_config_##inst = {                                \
+		.params =                                                      \
+			{                                                      \
+				.r = DT_PROP(MOTOR_NODE(inst),                 \
+					     resistance_micro_ohms) *          \
+				     1e-6f,                                    \
+				.l = (DT_PROP(MOTOR_NODE(inst),                \
+					      inductance_d_nano_henries) +     \
+				      DT_PROP(MOTOR_NODE(inst),                \
+					      inductance_q_nano_henries)) *    \
+				     0.5e-9f,                                  \
+				.flux = DT_PROP(MOTOR_NODE(inst),              \
+						flux_linkage_micro_webers) *   \
+					1e-6f,                                 \
+				.gain = (float)DT_INST_PROP(inst, gain),       \
+				.pll_bw = (float)DT_INST_PROP(inst,            \
+							      pll_bandwidth),  \
+			},                                                     \
+		.i_fs = DT_INST_PROP(inst, i_full_scale_milliamps) * 1e-3f,    \
+		.v_fs = DT_INST_PROP(inst, v_bus_millivolts) * 1e-3f *         \
+			V_NORM_TO_V_BUS,                                       \
+	};                                                                     \
+                                                                               \
+	static struct flux_observer_data flux_observer_data_##inst;            \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &flux_observer_init, NULL,                 \
+			      &flux_observer_data_##inst,                      \
+			      &flux_observer_config_##inst, POST_KERNEL,       \
+			      CONFIG_KERNEL_INIT_PRIORITY_DEVICE,              \
+			      &flux_observer_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(FLUX_OBSERVER_INIT)
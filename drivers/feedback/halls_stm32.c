@@ -10,10 +10,13 @@
 #include <zephyr/drivers/pinctrl.h>
 #include <zephyr/irq.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 
 #include <stm32_ll_tim.h>
 
 #include <spinner/drivers/feedback.h>
+#include <spinner/pll/pll.h>
 #include <spinner/utils/stm32_tim.h>
 
 LOG_MODULE_REGISTER(halls_stm32, CONFIG_SPINNER_FEEDBACK_LOG_LEVEL);
@@ -22,6 +25,23 @@ LOG_MODULE_REGISTER(halls_stm32, CONFIG_SPINNER_FEEDBACK_LOG_LEVEL);
  * Private
  ******************************************************************************/
 
+/** Angle state: period since the previous edge (timer ticks, 0 if unknown). */
+#define STATE_PERIOD_MSK 0xFFFFUL
+/** Angle state: sector (0...5, 60 degrees each). */
+#define STATE_SECTOR_POS 16U
+#define STATE_SECTOR_MSK (0x7UL << STATE_SECTOR_POS)
+/** Angle state: reverse direction. */
+#define STATE_REVERSE BIT(19)
+/** Angle state: edges counter (wraps). */
+#define STATE_EDGES_POS 20U
+#define STATE_EDGES_MSK (0xFFFUL << STATE_EDGES_POS)
+
+/** Maximum sector fraction (Q16). */
+#define FRAC_MAX 0xFFFFUL
+
+/** Degrees to Q31 angle conversion factor (2^32 / 360). */
+#define DEG_TO_Q31 11930465UL
+
 struct halls_stm32_config {
 	TIM_TypeDef *timer;
 	struct stm32_pclken pclken;
@@ -30,14 +50,26 @@ struct halls_stm32_config {
 	struct gpio_dt_spec h3;
 	uint32_t irq;
 	uint32_t phase_shift;
+	uint32_t interp_min_speed;
+	uint32_t pll_bandwidth;
+	void (*irq_config)(void);
 	const struct pinctrl_dev_config *pcfg;
 };
 
 struct halls_stm32_data {
-	uint16_t eangle;
+	/** Angle state (sector, direction and period), see STATE_*. */
+	atomic_t state;
 	uint8_t last_state;
+	/** Timer counter frequency (Hz). */
 	uint32_t tfreq;
-	int32_t raw_speed;
+	/** Timer overflowed since the last edge (speed below minimum). */
+	bool stalled;
+	/** Angle tracking PLL (fed with edges on every update). */
+	pll_q31_t pll;
+	/** Edges counter of the last edge provided to the PLL. */
+	uint32_t pll_edges;
+	/** PLL configured (periodic updates available). */
+	bool pll_ready;
 };
 
 static uint8_t halls_stm32_get_state(const struct device *dev)
@@ -51,18 +83,104 @@ static uint8_t halls_stm32_get_state(const struct device *dev)
 	       (uint8_t)gpio_pin_get_raw(config->h1.port, config->h1.pin);
 }
 
-ISR_DIRECT_DECLARE(timer_irq)
+/**
+ * @brief Obtain the sector of a Halls state.
+ *
+ * @param[in] halls_state Halls state (H3, H2, H1 bits).
+ *
+ * @return Sector (0...5, 60 degrees each), -1 if the state is not valid.
+ */
+static int halls_stm32_get_sector(uint8_t halls_state)
+{
+	switch (halls_state) {
+	case 5U:
+		return 0;
+	case 1U:
+		return 1;
+	case 3U:
+		return 2;
+	case 2U:
+		return 3;
+	case 6U:
+		return 4;
+	case 4U:
+		return 5;
+	default:
+		return -1;
+	}
+}
+
+/**
+ * @brief Obtain the angle state and the fraction of the current sector
+ * travelled since the last edge.
+ *
+ * The fraction is extrapolated from the period between the last two edges and
+ * the time elapsed since the last edge (timer counter, reset on every edge).
+ * It is saturated at the end of the sector, and it is zero (block angle) if
+ * the period is unknown, e.g. below the minimum interpolation speed.
+ *
+ * @param[in] dev Halls instance.
+ * @param[out] state Angle state.
+ *
+ * @return Sector fraction (Q16).
+ */
+static uint32_t halls_stm32_get_frac(const struct device *dev, uint32_t *state)
+{
+	const struct halls_stm32_config *config = dev->config;
+	struct halls_stm32_data *data = dev->data;
+
+	atomic_val_t s;
+	uint32_t period, cnt;
+	bool edge;
+
+	/* the timer IRQ may preempt us, make sure counter matches the state */
+	do {
+		s = atomic_get(&data->state);
+		cnt = LL_TIM_GetCounter(config->timer);
+		edge = LL_TIM_IsActiveFlag_CC1(config->timer) != 0U;
+	} while (atomic_get(&data->state) != s);
+
+	*state = (uint32_t)s;
+
+	period = (uint32_t)s & STATE_PERIOD_MSK;
+	if (period == 0U) {
+		return 0U;
+	}
+
+	/* edge not yet processed (counter already reset): end of sector */
+	if (edge || (cnt >= period)) {
+		return FRAC_MAX;
+	}
+
+	return (cnt << 16U) / period;
+}
+
+/**
+ * @brief Timer IRQ handler.
+ *
+ * @param[in] dev Feedback device.
+ */
+static inline void timer_irq_handler(const struct device *dev)
 {
-	const struct device *dev = DEVICE_DT_INST_GET(0);
 	const struct halls_stm32_config *config = dev->config;
 	struct halls_stm32_data *data = dev->data;
 
 	uint8_t curr_state;
 	uint16_t eangle = 0U;
 	int8_t direction = 1;
+	bool valid = true;
+	uint32_t state, period, edges;
+
+	/* no edges for a full timer period: speed below interpolation minimum */
+	if (LL_TIM_IsActiveFlag_UPDATE(config->timer) != 0U) {
+		LL_TIM_ClearFlag_UPDATE(config->timer);
+
+		data->stalled = true;
+		atomic_and(&data->state, ~(atomic_val_t)STATE_PERIOD_MSK);
+	}
 
 	if (LL_TIM_IsActiveFlag_CC1(config->timer) == 0U) {
-		return 0;
+		return;
 	}
 
 	LL_TIM_ClearFlag_CC1(config->timer);
@@ -76,6 +194,8 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 1U) {
 			eangle = 60;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 
 		break;
@@ -85,6 +205,8 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 3U) {
 			eangle = 120;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 		break;
 	case 3U:
@@ -93,6 +215,8 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 2U) {
 			eangle = 180;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 		break;
 	case 2U:
@@ -101,6 +225,8 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 6U) {
 			eangle = 240;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 		break;
 	case 6U:
@@ -109,6 +235,8 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 4U) {
 			eangle = 300;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 		break;
 	case 4U:
@@ -117,44 +245,202 @@ ISR_DIRECT_DECLARE(timer_irq)
 		} else if (data->last_state == 5U) {
 			eangle = 0;
 			direction = -1;
+		} else {
+			valid = false;
 		}
 		break;
 	default:
 		__ASSERT(NULL, "Unexpected halls state: %d", curr_state);
-		return 0;
+		return;
 	}
 
-	eangle += config->phase_shift;
+	/*
+	 * Missed or spurious edge: resynchronize the sector to the current
+	 * state, with a block angle (period unknown until the next valid edge).
+	 * The edge is not provided to the PLL, as its angle is unknown.
+	 */
+	if (!valid) {
+		state = (uint32_t)atomic_get(&data->state) &
+			(STATE_REVERSE | STATE_EDGES_MSK);
+		state |= (uint32_t)halls_stm32_get_sector(curr_state)
+			 << STATE_SECTOR_POS;
+
+		atomic_set(&data->state, (atomic_val_t)state);
+		data->last_state = curr_state;
+		data->stalled = true;
+		return;
+	}
 
-	data->eangle = eangle;
-	data->last_state = curr_state;
-	data->raw_speed =
-		direction * (int32_t)LL_TIM_IC_GetCaptureCH1(config->timer);
+	/*
+	 * In reverse direction the angle decreases from the edge angle, which
+	 * is the upper bound of the sector (e.g. 60 for 5 <- 1).
+	 */
+	state = ((direction > 0) ? (eangle / 60U) : ((eangle + 300U) / 60U) % 6U)
+		<< STATE_SECTOR_POS;
+	if (direction < 0) {
+		state |= STATE_REVERSE;
+	}
 
-	return 0;
+	/*
+	 * Period is only valid if the timer did not overflow and the motor kept
+	 * spinning in the same direction since the previous edge.
+	 */
+	period = LL_TIM_IC_GetCaptureCH1(config->timer);
+	if (!data->stalled && (period != 0U) &&
+	    (((uint32_t)atomic_get(&data->state) & STATE_REVERSE) ==
+	     (state & STATE_REVERSE))) {
+		state |= MIN(period, STATE_PERIOD_MSK);
+	}
+
+	edges = (uint32_t)atomic_get(&data->state) + BIT(STATE_EDGES_POS);
+	state |= edges & STATE_EDGES_MSK;
+
+	atomic_set(&data->state, (atomic_val_t)state);
+	data->last_state = curr_state;
+	data->stalled = false;
 }
 
 /*******************************************************************************
  * API
  ******************************************************************************/
 
+static void halls_stm32_configure(const struct device *dev, uint32_t freq)
+{
+	const struct halls_stm32_config *config = dev->config;
+	struct halls_stm32_data *data = dev->data;
+
+	/* speed is zero if no edges are seen within the minimum speed period */
+	pll_q31_init(&data->pll, (float)config->pll_bandwidth, 1.0f / (float)freq,
+		     1.0f / (6.0f * (float)config->interp_min_speed));
+	data->pll_edges = (uint32_t)atomic_get(&data->state) & STATE_EDGES_MSK;
+	data->pll_ready = true;
+}
+
+static void halls_stm32_update(const struct device *dev)
+{
+	const struct halls_stm32_config *config = dev->config;
+	struct halls_stm32_data *data = dev->data;
+
+	uint32_t state, eangle;
+
+	state = (uint32_t)atomic_get(&data->state);
+
+	/* provide new edge, if any (sector boundary crossed) */
+	if ((state & STATE_EDGES_MSK) != data->pll_edges) {
+		data->pll_edges = state & STATE_EDGES_MSK;
+
+		eangle = ((state & STATE_SECTOR_MSK) >> STATE_SECTOR_POS) * 60U +
+			 config->phase_shift;
+		if ((state & STATE_REVERSE) != 0U) {
+			eangle += 60U;
+		}
+
+		pll_q31_event(&data->pll,
+			      (int32_t)((eangle % 360U) * DEG_TO_Q31));
+	}
+
+	pll_q31_update(&data->pll);
+}
+
 static float halls_stm32_get_eangle(const struct device *dev)
 {
+	const struct halls_stm32_config *config = dev->config;
 	struct halls_stm32_data *data = dev->data;
 
-	return (float)data->eangle;
+	uint32_t state, frac;
+	float eangle, delta;
+
+	if (IS_ENABLED(CONFIG_SPINNER_FEEDBACK_HALLS_STM32_PLL_ANGLE) &&
+	    data->pll_ready) {
+		return (float)(uint32_t)data->pll.theta * (360.0f / 4294967296.0f);
+	}
+
+	frac = halls_stm32_get_frac(dev, &state);
+
+	eangle = (float)(((state & STATE_SECTOR_MSK) >> STATE_SECTOR_POS) *
+				 60U +
+			 config->phase_shift);
+	delta = (float)frac * (60.0f / 65536.0f);
+
+	if ((state & STATE_REVERSE) != 0U) {
+		eangle += 60.0f - delta;
+	} else {
+		eangle += delta;
+	}
+
+	if (eangle >= 360.0f) {
+		eangle -= 360.0f;
+	}
+
+	return eangle;
 }
 
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+/** Sector (60 degrees) Q31 angle per Q16 fraction unit. */
+#define SECTOR_FRAC_TO_Q31 ((60UL * DEG_TO_Q31) >> 16U)
+
+static int32_t halls_stm32_get_eangle_q31(const struct device *dev)
+{
+	const struct halls_stm32_config *config = dev->config;
+	struct halls_stm32_data *data = dev->data;
+
+	uint32_t state, frac, eangle, delta;
+
+	if (IS_ENABLED(CONFIG_SPINNER_FEEDBACK_HALLS_STM32_PLL_ANGLE) &&
+	    data->pll_ready) {
+		return data->pll.theta;
+	}
+
+	frac = halls_stm32_get_frac(dev, &state);
+
+	eangle = (((state & STATE_SECTOR_MSK) >> STATE_SECTOR_POS) * 60U +
+		  config->phase_shift) *
+		 DEG_TO_Q31;
+	delta = frac * SECTOR_FRAC_TO_Q31;
+
+	if ((state & STATE_REVERSE) != 0U) {
+		eangle += (FRAC_MAX + 1U) * SECTOR_FRAC_TO_Q31 - delta;
+	} else {
+		eangle += delta;
+	}
+
+	/* NOTE: [0, 360) degrees maps to [0, 2^32), wrapping to [-1, 1) */
+	return (int32_t)eangle;
+}
+#endif
+
 static float halls_stm32_get_speed(const struct device *dev)
 {
 	struct halls_stm32_data *data = dev->data;
 
-	return (float)(data->tfreq / data->raw_speed / 6UL);
+	uint32_t state, period;
+	float speed;
+
+	if (data->pll_ready) {
+		return pll_q31_get_speed(&data->pll);
+	}
+
+	/* no periodic updates: use the last period */
+	state = (uint32_t)atomic_get(&data->state);
+	period = state & STATE_PERIOD_MSK;
+	if (period == 0U) {
+		return 0.0f;
+	}
+
+	speed = (float)data->tfreq / (float)(6U * period);
+
+	return ((state & STATE_REVERSE) != 0U) ? -speed : speed;
 }
 
 static const struct feedback_driver_api halls_stm32_driver_api = {
+	.configure = halls_stm32_configure,
+	.update = halls_stm32_update,
 	.get_eangle = halls_stm32_get_eangle,
-	.get_speed = halls_stm32_get_speed};
+	.get_speed = halls_stm32_get_speed,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_eangle_q31 = halls_stm32_get_eangle_q31,
+#endif
+};
 
 /*******************************************************************************
  * Init
@@ -170,6 +456,8 @@ static int halls_stm32_init(const struct device *dev)
 	LL_TIM_InitTypeDef init;
 	LL_TIM_ENCODER_InitTypeDef enc_init;
 	uint8_t curr_state;
+	int sector;
+	uint32_t tim_clk, ticks;
 
 	/* configure pinmux */
 	ret = pinctrl_apply_state(config->pcfg, PINCTRL_STATE_DEFAULT);
@@ -187,8 +475,23 @@ static int halls_stm32_init(const struct device *dev)
 		return ret;
 	}
 
-	/* initialize timer */
+	/* obtain timer clock (used for speed calculations) */
+	ret = stm32_tim_clk_get(&config->pclken, &tim_clk);
+	if (ret < 0) {
+		return ret;
+	}
+
+	/*
+	 * initialize timer, so that it overflows (no interpolation) if the
+	 * period between edges exceeds the one at the minimum speed
+	 */
+	ticks = tim_clk / (6U * config->interp_min_speed);
+
 	LL_TIM_StructInit(&init);
+	init.Prescaler = ticks / (UINT16_MAX + 1U);
+	data->tfreq = tim_clk / (init.Prescaler + 1U);
+	init.Autoreload = MIN(data->tfreq / (6U * config->interp_min_speed),
+			      UINT16_MAX);
 	if (LL_TIM_Init(config->timer, &init) != SUCCESS) {
 		LOG_ERR("Could not initialize timer");
 		return -EIO;
@@ -206,16 +509,15 @@ static int halls_stm32_init(const struct device *dev)
 		return -EIO;
 	}
 
-	/* configure CC unit and timer update source */
+	/* reset counter on every edge (counter is the time since last edge) */
+	LL_TIM_SetSlaveMode(config->timer, LL_TIM_SLAVEMODE_RESET);
+
+	/* configure CC unit and timer update source (overflow only) */
 	LL_TIM_SetUpdateSource(config->timer, LL_TIM_UPDATESOURCE_COUNTER);
 	LL_TIM_CC_EnableChannel(config->timer, LL_TIM_CHANNEL_CH1);
+	LL_TIM_ClearFlag_UPDATE(config->timer);
 	LL_TIM_EnableIT_CC1(config->timer);
-
-	/* store timer frequency (used for speed calculations) */
-	ret = stm32_tim_clk_get(&config->pclken, &data->tfreq);
-	if (ret < 0) {
-		return ret;
-	}
+	LL_TIM_EnableIT_UPDATE(config->timer);
 
 	/* check H1/H2/H3 GPIO readiness */
 	if (!device_is_ready(config->h1.port) ||
@@ -225,59 +527,67 @@ static int halls_stm32_init(const struct device *dev)
 		return -ENODEV;
 	}
 
-	/* initialize electrical angle */
+	/* initialize electrical angle (block angle until two edges are seen) */
 	curr_state = halls_stm32_get_state(dev);
-	switch (curr_state) {
-	case 5U:
-		data->eangle = 0U;
-		break;
-	case 1U:
-		data->eangle = 60U;
-		break;
-	case 3U:
-		data->eangle = 120U;
-		break;
-	case 2U:
-		data->eangle = 180U;
-		break;
-	case 6U:
-		data->eangle = 240U;
-		break;
-	case 4U:
-		data->eangle = 300U;
-		break;
-	default:
-		break;
+	sector = halls_stm32_get_sector(curr_state);
+	if (sector >= 0) {
+		atomic_set(&data->state,
+			   (atomic_val_t)sector << STATE_SECTOR_POS);
 	}
 
-	data->eangle += config->phase_shift;
 	data->last_state = curr_state;
+	data->stalled = true;
 
 	/* connect and enable timer IRQ */
-	IRQ_DIRECT_CONNECT(DT_IRQ_BY_NAME(DT_INST_PARENT(0), global, irq),
-			   DT_IRQ_BY_NAME(DT_INST_PARENT(0), global, priority),
-			   timer_irq, 0);
+	config->irq_config();
 	irq_enable(config->irq);
 
+	LL_TIM_EnableCounter(config->timer);
+
 	return 0;
 }
 
-PINCTRL_DT_INST_DEFINE(0);
-
-static const struct halls_stm32_config halls_stm32_config = {
-	.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(0)),
-	.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(0)),
-	.h1 = GPIO_DT_SPEC_INST_GET(0, h1_gpios),
-	.h2 = GPIO_DT_SPEC_INST_GET(0, h2_gpios),
-	.h3 = GPIO_DT_SPEC_INST_GET(0, h3_gpios),
-	.irq = DT_IRQ_BY_NAME(DT_INST_PARENT(0), global, irq),
-	.phase_shift = DT_INST_PROP(0, phase_shift),
-	.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(0),
-};
-
-static struct halls_stm32_data halls_stm32_data;
-
-DEVICE_DT_INST_DEFINE(0, &halls_stm32_init, NULL, &halls_stm32_data,
-		      &halls_stm32_config, POST_KERNEL,
-		      CONFIG_KERNEL_INIT_PRIORITY_DEVICE,
-		      &halls_stm32_driver_api);
+#define HALLS_STM32_INIT(inst)                                                 \
+	BUILD_ASSERT(DT_INST_PROP(inst, interp_min_speed) > 0,                 \
+		     "Minimum interpolation speed must be greater than zero"); \
+                                                                               \
+	ISR_DIRECT_DECLARE(timer_irq_##inst)                                   \
+	{                                                                      \
+		timer_irq_handler(DEVICE_DT_INST_GET(inst));                   \
+		return 0;                                                      \
+	}                                                                      \
+                                                                               \
+	static void irq_config_##inst(void)                                    \
+	{                                                                      \
+		IRQ_DIRECT_CONNECT(                                            \
+			DT_IRQ_BY_NAME(DT_INST_PARENT(inst), global, irq),     \
+			DT_IRQ_BY_NAME(DT_INST_PARENT(inst), global,           \
+				       priority),                              \
+			timer_irq_##inst, 0);                                  \
+	}                                                                      \
+                                                                               \
+	PINCTRL_DT_INST_DEFINE(inst);                                          \
+                                                                               \
+	static const struct halls_stm32_config halls_stm32_config_##inst = {  \
+		.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(inst)),     \
+		.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(inst)),           \
+		.h1 = GPIO_DT_SPEC_INST_GET(inst, h1_gpios),                   \
+		.h2 = GPIO_DT_SPEC_INST_GET(inst, h2_gpios),                   \
+		.h3 = GPIO_DT_SPEC_INST_GET(inst, h3_gpios),                   \
+		.irq = DT_IRQ_BY_NAME(DT_INST_PARENT(inst), global, irq),      \
+		.phase_shift = DT_INST_PROP(inst, phase_shift),                \
+		.interp_min_speed = DT_INST_PROP(inst, interp_min_speed),      \
+		.pll_bandwidth = DT_INST_PROP(inst, pll_bandwidth),            \
+		.irq_config = irq_config_##inst,                               \
+		.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(inst),                  \
+	};                                                                     \
+                                                                               \
+	static struct halls_stm32_data halls_stm32_data_##inst;                \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &halls_stm32_init, NULL,                   \
+			      &halls_stm32_data_##inst,                        \
+			      &halls_stm32_config_##inst, POST_KERNEL,         \
+			      CONFIG_KERNEL_INIT_PRIORITY_DEVICE,              \
+			      &halls_stm32_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(HALLS_STM32_INIT)
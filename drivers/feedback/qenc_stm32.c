@@ -0,0 +1,365 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT st_stm32_qenc
+
+#include <zephyr/drivers/clock_control/stm32_clock_control.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/pinctrl.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <stm32_ll_tim.h>
+
+#include <spinner/drivers/feedback.h>
+
+LOG_MODULE_REGISTER(qenc_stm32, CONFIG_SPINNER_FEEDBACK_LOG_LEVEL);
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Degrees to Q31 angle conversion factor (2^32 / 360). */
+#define DEG_TO_Q31 11930465UL
+
+/** Speed measurement: counts (signed). */
+#define MEAS_COUNTS_MSK 0xFFFFUL
+/** Speed measurement: update periods. */
+#define MEAS_STEPS_POS 16U
+
+struct qenc_stm32_config {
+	TIM_TypeDef *timer;
+	struct stm32_pclken pclken;
+	struct gpio_dt_spec index;
+	/** Counts per mechanical revolution (x4 decoding). */
+	uint32_t cpr;
+	/** Electrical angle per count (Q31 angle). */
+	uint32_t k;
+	uint32_t pole_pairs;
+	/** Electrical angle at the index pulse (Q31 angle). */
+	uint32_t index_offset;
+	uint32_t speed_window_us;
+	uint32_t speed_timeout_ms;
+	const struct pinctrl_dev_config *pcfg;
+};
+
+struct qenc_stm32_data {
+	const struct device *dev;
+	/** Electrical angle offset (Q31 angle). */
+	atomic_t offset;
+	struct gpio_callback index_cb;
+	/* speed measurement (M/T), regulation IRQ owned */
+	uint32_t freq;
+	uint32_t window;
+	uint32_t timeout;
+	uint16_t last_cnt;
+	uint16_t ref_cnt;
+	bool ref_valid;
+	uint32_t steps;
+	/** Last speed measurement (counts and update periods), see MEAS_*. */
+	atomic_t meas;
+};
+
+/**
+ * @brief Wrap a counts difference to (-cpr / 2, cpr / 2].
+ *
+ * @param[in] d Counts difference (within (-cpr, cpr)).
+ * @param[in] cpr Counts per revolution.
+ *
+ * @return Wrapped difference.
+ */
+static inline int32_t wrap_counts(int32_t d, uint32_t cpr)
+{
+	if (d > (int32_t)(cpr / 2U)) {
+		d -= (int32_t)cpr;
+	} else if (d <= -(int32_t)(cpr / 2U)) {
+		d += (int32_t)cpr;
+	}
+
+	return d;
+}
+
+/**
+ * @brief Publish a speed measurement.
+ *
+ * @param[in] data Driver data.
+ * @param[in] counts Counts.
+ * @param[in] steps Update periods.
+ */
+static inline void meas_publish(struct qenc_stm32_data *data, int32_t counts,
+				uint32_t steps)
+{
+	atomic_set(&data->meas,
+		   (atomic_val_t)(((uint32_t)counts & MEAS_COUNTS_MSK) |
+				  (MIN(steps, UINT16_MAX) << MEAS_STEPS_POS)));
+}
+
+/**
+ * @brief Obtain the Q31 electrical angle.
+ *
+ * @param[in] dev Encoder instance.
+ *
+ * @return Electrical angle (Q31).
+ */
+static inline uint32_t qenc_stm32_eangle(const struct device *dev)
+{
+	const struct qenc_stm32_config *config = dev->config;
+	struct qenc_stm32_data *data = dev->data;
+
+	/* NOTE: pole_pairs * 2^32 per revolution wraps to electrical angle */
+	return LL_TIM_GetCounter(config->timer) * config->k +
+	       (uint32_t)atomic_get(&data->offset);
+}
+
+static void index_handler(const struct device *port, struct gpio_callback *cb,
+			  uint32_t pins)
+{
+	struct qenc_stm32_data *data =
+		CONTAINER_OF(cb, struct qenc_stm32_data, index_cb);
+	const struct qenc_stm32_config *config = data->dev->config;
+
+	uint32_t cnt;
+
+	ARG_UNUSED(port);
+	ARG_UNUSED(pins);
+
+	cnt = LL_TIM_GetCounter(config->timer);
+	atomic_set(&data->offset,
+		   (atomic_val_t)(config->index_offset - cnt * config->k));
+}
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static void qenc_stm32_configure(const struct device *dev, uint32_t freq)
+{
+	const struct qenc_stm32_config *config = dev->config;
+	struct qenc_stm32_data *data = dev->data;
+
+	data->freq = freq;
+	data->window = MAX((uint32_t)(((uint64_t)config->speed_window_us *
+				       freq) / USEC_PER_SEC),
+			   1U);
+	data->timeout = CLAMP((uint32_t)(((uint64_t)config->speed_timeout_ms *
+					  freq) / MSEC_PER_SEC),
+			      data->window + 1U, UINT16_MAX);
+	data->last_cnt = (uint16_t)LL_TIM_GetCounter(config->timer);
+	data->ref_valid = false;
+	data->steps = 0U;
+	atomic_set(&data->meas, 0);
+}
+
+static void qenc_stm32_update(const struct device *dev)
+{
+	const struct qenc_stm32_config *config = dev->config;
+	struct qenc_stm32_data *data = dev->data;
+
+	uint16_t cnt;
+
+	if (data->freq == 0U) {
+		return;
+	}
+
+	/*
+	 * M/T method: counts are measured between two count changes separated
+	 * by at least the measurement window, so that the measured time
+	 * matches the counts at low speed (longer window).
+	 */
+	cnt = (uint16_t)LL_TIM_GetCounter(config->timer);
+	data->steps++;
+
+	if (cnt != data->last_cnt) {
+		data->last_cnt = cnt;
+
+		if (!data->ref_valid) {
+			data->ref_cnt = cnt;
+			data->ref_valid = true;
+			data->steps = 0U;
+		} else if (data->steps >= data->window) {
+			meas_publish(data,
+				     wrap_counts((int32_t)cnt -
+							 (int32_t)data->ref_cnt,
+						 config->cpr),
+				     data->steps);
+			data->ref_cnt = cnt;
+			data->steps = 0U;
+		}
+	}
+
+	/* no counts for too long: standstill */
+	if (data->steps >= data->timeout) {
+		meas_publish(data, 0, 1U);
+		data->ref_valid = false;
+		data->steps = 0U;
+	}
+}
+
+static float qenc_stm32_get_eangle(const struct device *dev)
+{
+	return (float)qenc_stm32_eangle(dev) * (360.0f / 4294967296.0f);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static int32_t qenc_stm32_get_eangle_q31(const struct device *dev)
+{
+	/* NOTE: [0, 360) degrees maps to [0, 2^32), wrapping to [-1, 1) */
+	return (int32_t)qenc_stm32_eangle(dev);
+}
+#endif
+
+static float qenc_stm32_get_speed(const struct device *dev)
+{
+	const struct qenc_stm32_config *config = dev->config;
+	struct qenc_stm32_data *data = dev->data;
+
+	uint32_t meas, steps;
+	int16_t counts;
+
+	meas = (uint32_t)atomic_get(&data->meas);
+	counts = (int16_t)(meas & MEAS_COUNTS_MSK);
+	steps = meas >> MEAS_STEPS_POS;
+	if (steps == 0U) {
+		return 0.0f;
+	}
+
+	return (float)counts * (float)config->pole_pairs * (float)data->freq /
+	       ((float)config->cpr * (float)steps);
+}
+
+static const struct feedback_driver_api qenc_stm32_driver_api = {
+	.configure = qenc_stm32_configure,
+	.update = qenc_stm32_update,
+	.get_eangle = qenc_stm32_get_eangle,
+	.get_speed = qenc_stm32_get_speed,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.get_eangle_q31 = qenc_stm32_get_eangle_q31,
+#endif
+};
+
+/*******************************************************************************
+ * Init
+ ******************************************************************************/
+
+static int qenc_stm32_init(const struct device *dev)
+{
+	const struct qenc_stm32_config *config = dev->config;
+	struct qenc_stm32_data *data = dev->data;
+
+	int ret;
+	const struct device *clk;
+	LL_TIM_InitTypeDef init;
+	LL_TIM_ENCODER_InitTypeDef enc_init;
+
+	/* configure pinmux */
+	ret = pinctrl_apply_state(config->pcfg, PINCTRL_STATE_DEFAULT);
+	if (ret < 0) {
+		LOG_ERR("pinctrl setup failed (%d)", ret);
+		return ret;
+	}
+
+	/* enable timer clock */
+	clk = DEVICE_DT_GET(STM32_CLOCK_CONTROL_NODE);
+
+	ret = clock_control_on(clk, (clock_control_subsys_t *)&config->pclken);
+	if (ret < 0) {
+		LOG_ERR("Could not turn on timer clock (%d)", ret);
+		return ret;
+	}
+
+	/* initialize timer (counter wraps once per mechanical revolution) */
+	LL_TIM_StructInit(&init);
+	init.Autoreload = config->cpr - 1U;
+	if (LL_TIM_Init(config->timer, &init) != SUCCESS) {
+		LOG_ERR("Could not initialize timer");
+		return -EIO;
+	}
+
+	/* configure encoder mode (x4, both edges of both channels) */
+	LL_TIM_ENCODER_StructInit(&enc_init);
+	enc_init.EncoderMode = LL_TIM_ENCODERMODE_X4_TI12;
+	if (LL_TIM_ENCODER_Init(config->timer, &enc_init) != SUCCESS) {
+		LOG_ERR("Could not initialize encoder mode");
+		return -EIO;
+	}
+
+	data->dev = dev;
+
+	/* until the index pulse is seen, angle is relative to this position */
+	atomic_set(&data->offset, (atomic_val_t)config->index_offset);
+
+	/* configure index pulse (optional) */
+	if (config->index.port != NULL) {
+		if (!device_is_ready(config->index.port)) {
+			LOG_ERR("Index GPIO device not ready");
+			return -ENODEV;
+		}
+
+		ret = gpio_pin_configure_dt(&config->index, GPIO_INPUT);
+		if (ret < 0) {
+			LOG_ERR("Could not configure index GPIO (%d)", ret);
+			return ret;
+		}
+
+		gpio_init_callback(&data->index_cb, index_handler,
+				   BIT(config->index.pin));
+
+		ret = gpio_add_callback(config->index.port, &data->index_cb);
+		if (ret < 0) {
+			LOG_ERR("Could not add index GPIO callback (%d)", ret);
+			return ret;
+		}
+
+		ret = gpio_pin_interrupt_configure_dt(&config->index,
+						      GPIO_INT_EDGE_TO_ACTIVE);
+		if (ret < 0) {
+			LOG_ERR("Could not configure index interrupt (%d)",
+				ret);
+			return ret;
+		}
+	}
+
+	LL_TIM_SetCounter(config->timer, 0U);
+	LL_TIM_EnableCounter(config->timer);
+
+	return 0;
+}
+
+/** Counts per mechanical revolution (x4 decoding). */
+#define QENC_STM32_CPR(inst) (4U * DT_INST_PROP(inst, lines))
+
+#define QENC_STM32_INIT(inst)                                                  \
+	BUILD_ASSERT(QENC_STM32_CPR(inst) <= (UINT16_MAX + 1U),                \
+		     "Counts per revolution must fit the 16-bit timer "        \
+		     "counter");                                               \
+                                                                               \
+	PINCTRL_DT_INST_DEFINE(inst);                                          \
+                                                                               \
+	static const struct qenc_stm32_config qenc_stm32_config_##inst = {    \
+		.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(inst)),     \
+		.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(inst)),           \
+		.index = GPIO_DT_SPEC_INST_GET_OR(inst, index_gpios, {0}),     \
+		.cpr = QENC_STM32_CPR(inst),                                   \
+		.k = (uint32_t)(((uint64_t)DT_INST_PROP(inst, pole_pairs)      \
+				 << 32U) /                                     \
+				QENC_STM32_CPR(inst)),                         \
+		.pole_pairs = DT_INST_PROP(inst, pole_pairs),                  \
+		.index_offset = (DT_INST_PROP(inst, index_offset) % 360U) *    \
+				DEG_TO_Q31,                                    \
+		.speed_window_us = DT_INST_PROP(inst, speed_window_us),        \
+		.speed_timeout_ms = DT_INST_PROP(inst, speed_timeout_ms),      \
+		.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(inst),                  \
+	};                                                                     \
+                                                                               \
+	static struct qenc_stm32_data qenc_stm32_data_##inst;                  \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &qenc_stm32_init, NULL,                    \
+			      &qenc_stm32_data_##inst,                         \
+			      &qenc_stm32_config_##inst, POST_KERNEL,          \
+			      CONFIG_KERNEL_INIT_PRIORITY_DEVICE,              \
+			      &qenc_stm32_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(QENC_STM32_INIT)
@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT teslabs_sim_pmsm
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <spinner/drivers/sim/pmsm_sim.h>
+
+LOG_MODULE_REGISTER(pmsm_sim, CONFIG_SPINNER_SIM_PMSM_PLANT_LOG_LEVEL);
+
+BUILD_ASSERT((CONFIG_SYS_CLOCK_TICKS_PER_SEC %
+	      CONFIG_SPINNER_SIM_PMSM_PLANT_PWM_FREQ) == 0,
+	     "System tick rate must be a multiple of the PWM frequency");
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Value 1 / sqrt(3). */
+#define INV_SQRT_3 0.5773502691896258f
+
+/** Plant period (s). */
+#define PERIOD (1.0f / CONFIG_SPINNER_SIM_PMSM_PLANT_PWM_FREQ)
+
+struct pmsm_sim_config {
+	struct pmsm_params params;
+	float v_bus;
+};
+
+struct pmsm_sim_data {
+	struct k_spinlock lock;
+	struct k_timer timer;
+	struct pmsm pmsm;
+	float d_a;
+	float d_b;
+	float d_c;
+	bool inverter;
+	bool sampling;
+	pmsm_sim_cb_t cb;
+	void *ctx;
+};
+
+static void timer_expiry(struct k_timer *timer)
+{
+	const struct device *dev = k_timer_user_data_get(timer);
+	const struct pmsm_sim_config *config = dev->config;
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+	pmsm_sim_cb_t cb = NULL;
+	void *ctx = NULL;
+
+	key = k_spin_lock(&data->lock);
+
+	if (data->inverter) {
+		float d_n, v_an, v_bn, v_cn;
+
+		/* phase to neutral voltages (balanced load) */
+		d_n = (data->d_a + data->d_b + data->d_c) / 3.0f;
+		v_an = config->v_bus * (data->d_a - d_n);
+		v_bn = config->v_bus * (data->d_b - d_n);
+		v_cn = config->v_bus * (data->d_c - d_n);
+
+		pmsm_step(&data->pmsm, v_an, (v_bn - v_cn) * INV_SQRT_3,
+			  PERIOD);
+	} else {
+		pmsm_step_open(&data->pmsm, PERIOD);
+	}
+
+	if (data->sampling) {
+		cb = data->cb;
+		ctx = data->ctx;
+	}
+
+	k_spin_unlock(&data->lock, key);
+
+	if (cb != NULL) {
+		cb(ctx);
+	}
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void pmsm_sim_set_callback(const struct device *dev, pmsm_sim_cb_t cb,
+			   void *ctx)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	data->cb = cb;
+	data->ctx = ctx;
+	k_spin_unlock(&data->lock, key);
+}
+
+void pmsm_sim_enable_sampling(const struct device *dev, bool enable)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	data->sampling = enable;
+	k_spin_unlock(&data->lock, key);
+}
+
+void pmsm_sim_enable_inverter(const struct device *dev, bool enable)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	data->inverter = enable;
+	data->d_a = 0.5f;
+	data->d_b = 0.5f;
+	data->d_c = 0.5f;
+	k_spin_unlock(&data->lock, key);
+}
+
+void pmsm_sim_set_duties(const struct device *dev, float d_a, float d_b,
+			 float d_c)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	data->d_a = d_a;
+	data->d_b = d_b;
+	data->d_c = d_c;
+	k_spin_unlock(&data->lock, key);
+}
+
+void pmsm_sim_set_load(const struct device *dev, float t_l)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	pmsm_set_load(&data->pmsm, t_l);
+	k_spin_unlock(&data->lock, key);
+}
+
+void pmsm_sim_get_state(const struct device *dev, struct pmsm *pmsm)
+{
+	struct pmsm_sim_data *data = dev->data;
+
+	k_spinlock_key_t key;
+
+	key = k_spin_lock(&data->lock);
+	*pmsm = data->pmsm;
+	k_spin_unlock(&data->lock, key);
+}
+
+uint32_t pmsm_sim_get_freq(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return CONFIG_SPINNER_SIM_PMSM_PLANT_PWM_FREQ;
+}
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int pmsm_sim_init(const struct device *dev)
+{
+	const struct pmsm_sim_config *config = dev->config;
+	struct pmsm_sim_data *data = dev->data;
+
+	if ((config->params.r <= 0.0f) || (config->params.l_d <= 0.0f) ||
+	    (config->params.l_q <= 0.0f)) {
+		LOG_ERR("Invalid motor parameters");
+		return -EINVAL;
+	}
+
+	pmsm_init(&data->pmsm, &config->params);
+
+	data->d_a = 0.5f;
+	data->d_b = 0.5f;
+	data->d_c = 0.5f;
+
+	/* plant runs continuously, so that motor can coast when stopped */
+	k_timer_init(&data->timer, timer_expiry, NULL);
+	k_timer_user_data_set(&data->timer, (void *)dev);
+	k_timer_start(&data->timer,
+		      K_USEC(USEC_PER_SEC /
+			     CONFIG_SPINNER_SIM_PMSM_PLANT_PWM_FREQ),
+		      K_USEC(USEC_PER_SEC /
+			     CONFIG_SPINNER_SIM_PMSM_PLANT_PWM_FREQ));
+
+	return 0;
+}
+
+#define MOTOR_NODE(inst) DT_INST_PHANDLE(inst, motor)
+
+#define PMSM_SIM_INIT(inst)                                                    \
+	static const struct pmsm_sim_config pmsm_sim_config_##inst = {        \
+		.params =                                                      \
+			{                                                      \
+				.pole_pairs =                                  \
+					DT_PROP(MOTOR_NODE(inst), pole_pairs), \
+				.r = DT_PROP(MOTOR_NODE(inst),                 \
+					     resistance_micro_ohms) *          \
+				     1e-6f,                                    \
+				.l_d = DT_PROP(MOTOR_NODE(inst),               \
+					       inductance_d_nano_henries) *    \
+				       1e-9f,                                  \
+				.l_q = DT_PROP(MOTOR_NODE(inst),               \
+					       inductance_q_nano_henries) *    \
+				       1e-9f,                                  \
+				.flux = DT_PROP(MOTOR_NODE(inst),              \
+						flux_linkage_micro_webers) *   \
+					1e-6f,                                 \
+				.j = DT_PROP(MOTOR_NODE(inst),                 \
+					     inertia_nano_kg_m2) *             \
+				     1e-9f,                                    \
+				.b = DT_PROP(MOTOR_NODE(inst),                 \
+					     friction_nano_nm_s) *             \
+				     1e-9f,                                    \
+			},                                                     \
+		.v_bus = DT_INST_PROP(inst, v_bus_millivolts) * 1e-3f,         \
+	};                                                                     \
+                                                                               \
+	static struct pmsm_sim_data pmsm_sim_data_##inst;                      \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &pmsm_sim_init, NULL,                      \
+			      &pmsm_sim_data_##inst, &pmsm_sim_config_##inst,  \
+			      POST_KERNEL,                                     \
+			      CONFIG_SPINNER_SIM_PMSM_PLANT_INIT_PRIORITY,     \
+			      NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(PMSM_SIM_INIT)
@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT teslabs_sim_svpwm
+
+#include <zephyr/logging/log.h>
+
+#include <spinner/drivers/currsmp.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/drivers/svpwm.h>
+#include <spinner/svm/svm.h>
+
+LOG_MODULE_REGISTER(svpwm_sim, CONFIG_SPINNER_SVPWM_LOG_LEVEL);
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct svpwm_sim_config {
+	const struct device *plant;
+	const struct device *currsmp;
+};
+
+struct svpwm_sim_data {
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	svm_q31_t svm_q31;
+	bool q31;
+#endif
+	svm_t svm;
+};
+
+/*******************************************************************************
+ * API
+ ******************************************************************************/
+
+static void svpwm_sim_start(const struct device *dev)
+{
+	const struct svpwm_sim_config *config = dev->config;
+	struct svpwm_sim_data *data = dev->data;
+
+	svm_init(&data->svm);
+	data->svm.sector = 5U;
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	svm_q31_init(&data->svm_q31);
+	data->svm_q31.sector = 5U;
+	data->q31 = false;
+#endif
+	currsmp_set_sector(config->currsmp, data->svm.sector);
+
+	pmsm_sim_enable_inverter(config->plant, true);
+}
+
+static void svpwm_sim_stop(const struct device *dev)
+{
+	const struct svpwm_sim_config *config = dev->config;
+
+	pmsm_sim_enable_inverter(config->plant, false);
+}
+
+static void svpwm_sim_set_phase_voltages(const struct device *dev,
+					 float v_alpha, float v_beta)
+{
+	const struct svpwm_sim_config *config = dev->config;
+	struct svpwm_sim_data *data = dev->data;
+
+	const svm_duties_t *duties = &data->svm.duties;
+
+	/* space-vector modulation */
+	svm_set(&data->svm, v_alpha, v_beta);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	data->q31 = false;
+#endif
+
+	/* program duties */
+	pmsm_sim_set_duties(config->plant, duties->a, duties->b, duties->c);
+
+	/* inform current sampling device about current sector */
+	currsmp_set_sector(config->currsmp, data->svm.sector);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void svpwm_sim_set_phase_voltages_q31(const struct device *dev,
+					     int32_t v_alpha, int32_t v_beta)
+{
+	const struct svpwm_sim_config *config = dev->config;
+	struct svpwm_sim_data *data = dev->data;
+
+	const svm_duties_q31_t *duties = &data->svm_q31.duties;
+
+	/* space-vector modulation */
+	svm_q31_set(&data->svm_q31, v_alpha, v_beta);
+	data->q31 = true;
+
+	/* program duties */
+	pmsm_sim_set_duties(config->plant, (float)duties->a / 2147483648.0f,
+			    (float)duties->b / 2147483648.0f,
+			    (float)duties->c / 2147483648.0f);
+
+	/* inform current sampling device about current sector */
+	currsmp_set_sector(config->currsmp, data->svm_q31.sector);
+}
+#endif
+
+static float svpwm_sim_get_mod_index(const struct device *dev)
+{
+	struct svpwm_sim_data *data = dev->data;
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	if (data->q31) {
+		return svm_q31_get_mod_index(&data->svm_q31);
+	}
+#endif
+
+	return svm_get_mod_index(&data->svm);
+}
+
+static uint32_t svpwm_sim_get_freq(const struct device *dev)
+{
+	const struct svpwm_sim_config *config = dev->config;
+
+	return pmsm_sim_get_freq(config->plant);
+}
+
+static const struct svpwm_driver_api svpwm_sim_driver_api = {
+	.start = svpwm_sim_start,
+	.stop = svpwm_sim_stop,
+	.set_phase_voltages = svpwm_sim_set_phase_voltages,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.set_phase_voltages_q31 = svpwm_sim_set_phase_voltages_q31,
+#endif
+	.get_mod_index = svpwm_sim_get_mod_index,
+	.get_freq = svpwm_sim_get_freq,
+};
+
+/*******************************************************************************
+ * Initialization
+ ******************************************************************************/
+
+static int svpwm_sim_init(const struct device *dev)
+{
+	const struct svpwm_sim_config *config = dev->config;
+
+	if (!device_is_ready(config->plant)) {
+		LOG_ERR("Plant device not ready");
+		return -ENODEV;
+	}
+
+	if (!device_is_ready(config->currsmp)) {
+		LOG_ERR("Current sampling device not ready");
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+#define SVPWM_SIM_INIT(inst)                                                   \
+	static const struct svpwm_sim_config svpwm_sim_config_##inst = {      \
+		.plant = DEVICE_DT_GET(DT_INST_PARENT(inst)),                  \
+		.currsmp = DEVICE_DT_GET(DT_INST_PHANDLE(inst, currsmp)),      \
+	};                                                                     \
+                                                                               \
+	static struct svpwm_sim_data svpwm_sim_data_##inst;                    \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &svpwm_sim_init, NULL,                     \
+			      &svpwm_sim_data_##inst,                          \
+			      &svpwm_sim_config_##inst, POST_KERNEL,           \
+			      CONFIG_SPINNER_SVPWM_INIT_PRIORITY,              \
+			      &svpwm_sim_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(SVPWM_SIM_INIT)
@@ -10,6 +10,7 @@
 #include <zephyr/drivers/pinctrl.h>
 #include <zephyr/logging/log.h>
 
+#include <arm_math.h>
 #include <stm32_ll_tim.h>
 
 #include <spinner/drivers/currsmp.h>
@@ -19,6 +20,16 @@
 
 LOG_MODULE_REGISTER(svpwm_stm32, CONFIG_SPINNER_SVPWM_LOG_LEVEL);
 
+/** Single-shunt current sampling support (any instance). */
+#define SINGLE_SHUNT DT_HAS_COMPAT_STATUS_OKAY(st_stm32_currsmp_single_shunt)
+
+#ifdef CONFIG_SPINNER_SVPWM_STM32_DT_COMP
+/** Dead-time compensation current band (relative to full-scale). */
+#define DT_COMP_I_BAND (CONFIG_SPINNER_SVPWM_STM32_DT_COMP_I_BAND / 1000.0f)
+#else
+#define DT_COMP_I_BAND 0.0f
+#endif
+
 /*******************************************************************************
  * Private
  ******************************************************************************/
@@ -30,6 +41,10 @@ struct svpwm_stm32_config {
 	uint32_t t_dead;
 	uint32_t t_rise;
 	const struct device *currsmp;
+#if SINGLE_SHUNT
+	/* two sampling points per period (single-shunt) */
+	bool single_shunt;
+#endif
 	const struct gpio_dt_spec *enable;
 	size_t enable_len;
 	const struct pinctrl_dev_config *pcfg;
@@ -37,9 +52,278 @@ struct svpwm_stm32_config {
 
 struct svpwm_stm32_data {
 	uint32_t period;
+	/* ADC sampling: settling (t_dead + t_rise) and sampling time (ticks) */
+	uint32_t smp_settle;
+	uint32_t smp_len;
+	float d_smp;
+	float d_dt;
+#if SINGLE_SHUNT
+	/* compare shifts introduced on the last cycle (ticks) */
+	int32_t ccr_shift[3];
+#endif
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	svm_q31_t svm_q31;
+	bool q31;
+#endif
 	svm_t svm;
 };
 
+/**
+ * @brief Obtain compare value for a given duty cycle.
+ *
+ * In center-aligned PWM mode 1 the output is active while the counter is
+ * below the compare value, so a compare value equal to the period would still
+ * produce a short inactive pulse at the counter peak. A full duty cycle, as
+ * required by the discontinuous SVM modes, needs period + 1.
+ *
+ * @param[in] period Timer period (ARR).
+ * @param[in] duty Duty cycle (0...1).
+ *
+ * @return Compare value.
+ */
+static inline uint32_t duty_to_ccr(uint32_t period, float duty)
+{
+	if (duty >= 1.0f) {
+		return period + 1U;
+	}
+
+	return (uint32_t)(period * duty);
+}
+
+/**
+ * @brief Obtain the ADC trigger compare value for the given phase compares.
+ *
+ * Currents are sampled on the two phases with the longest low-side on time,
+ * the shortest of them given by the middle compare value. The low-side on time
+ * is centered at the counter peak, where sampling starts by default. If the
+ * low-side on time left after the peak does not cover the settling or the
+ * sampling time (high modulation indices), the trigger is moved before the
+ * peak, right after the settling time, so that the whole low-side on time can
+ * be used for sampling.
+ *
+ * @param[in] data Driver data.
+ * @param[in] ccr_a Phase a compare value.
+ * @param[in] ccr_b Phase b compare value.
+ * @param[in] ccr_c Phase c compare value.
+ *
+ * @return ADC trigger compare value.
+ */
+static inline uint32_t smp_ccr(const struct svpwm_stm32_data *data,
+			       uint32_t ccr_a, uint32_t ccr_b, uint32_t ccr_c)
+{
+	uint32_t ccr_mid;
+
+	ccr_mid = MAX(MIN(ccr_a, ccr_b), MIN(MAX(ccr_a, ccr_b), ccr_c));
+
+	if ((ccr_mid + MAX(data->smp_settle, data->smp_len)) <= data->period) {
+		return data->period - 1U;
+	}
+
+	return MIN(ccr_mid + data->smp_settle, data->period - 1U);
+}
+
+/**
+ * @brief Convert a time to timer ticks (rounded up).
+ *
+ * @param[in] t Time (ns).
+ * @param[in] freq Timer counter frequency (Hz).
+ *
+ * @return Timer ticks.
+ */
+static inline uint32_t ns_to_ticks(uint32_t t, uint32_t freq)
+{
+	return (uint32_t)(((uint64_t)t * freq + 999999999ULL) / 1000000000ULL);
+}
+
+/**
+ * @brief Check if the current sampling device is a single shunt.
+ *
+ * @param[in] dev SV-PWM device.
+ *
+ * @return True if single-shunt, false otherwise.
+ */
+static inline bool single_shunt(const struct device *dev)
+{
+#if SINGLE_SHUNT
+	const struct svpwm_stm32_config *config = dev->config;
+
+	return config->single_shunt;
+#else
+	ARG_UNUSED(dev);
+
+	return false;
+#endif
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+/**
+ * @brief Obtain compare value for a given duty cycle (Q31).
+ *
+ * @param[in] period Timer period (ARR).
+ * @param[in] duty Duty cycle (Q31, 0...1).
+ *
+ * @return Compare value.
+ *
+ * @see duty_to_ccr()
+ */
+static inline uint32_t duty_q31_to_ccr(uint32_t period, int32_t duty)
+{
+	if (duty == INT32_MAX) {
+		return period + 1U;
+	}
+
+	return (uint32_t)(((uint64_t)period * (uint32_t)duty) >> 31U);
+}
+#endif
+
+#if SINGLE_SHUNT
+/**
+ * @brief Program compare values (single-shunt).
+ *
+ * The DC-link current equals -i_min while only the min duty phase is connected
+ * to the low side, and i_max while only the max duty phase is connected to the
+ * high side. Both active vectors are sampled on the up-counting half period,
+ * after the settling time (CH4 and CH6, combined on TRGO2).
+ *
+ * If an active vector is shorter than the settling plus the sampling time,
+ * the min (max) phase compare is shifted down (up) to make room for it. The
+ * mid phase compare is only moved if the windows would not fit in the period
+ * otherwise. Introduced shifts are compensated on the next cycle, so that
+ * phase voltages are preserved on average.
+ *
+ * Phases order is passed to the current sampling device as the sector with
+ * the same order (see shunt_single_get_currents()), instead of the SV-PWM
+ * sector.
+ *
+ * @param[in] dev SV-PWM device.
+ * @param[in] ccr Phase compare values (a, b, c).
+ * @param[in] sector SV-PWM sector (unused).
+ */
+static void ccr_program_single_shunt(const struct device *dev,
+				     const uint32_t ccr[3], uint8_t sector)
+{
+	/* sector for each (max, min) phases pair */
+	static const uint8_t order_sector[3][3] = {
+		{0U, 6U, 1U},
+		{3U, 0U, 2U},
+		{4U, 5U, 0U},
+	};
+
+	const struct svpwm_stm32_config *config = dev->config;
+	struct svpwm_stm32_data *data = dev->data;
+
+	int32_t c[3], c_max, c_mid, c_min;
+	int32_t w = (int32_t)(data->smp_settle + data->smp_len);
+	int32_t period = (int32_t)data->period;
+	size_t max, mid, min, tmp;
+
+	ARG_UNUSED(sector);
+
+	/* compensate the last cycle shifts */
+	for (size_t i = 0U; i < 3U; i++) {
+		c[i] = (int32_t)ccr[i] - data->ccr_shift[i];
+	}
+
+	/* sort phases */
+	max = 0U;
+	mid = 1U;
+	min = 2U;
+
+	if (c[max] < c[mid]) {
+		tmp = max;
+		max = mid;
+		mid = tmp;
+	}
+
+	if (c[mid] < c[min]) {
+		tmp = mid;
+		mid = min;
+		min = tmp;
+	}
+
+	if (c[max] < c[mid]) {
+		tmp = max;
+		max = mid;
+		mid = tmp;
+	}
+
+	/* insert sampling windows */
+	c_mid = CLAMP(c[mid], w, period - w);
+	c_min = CLAMP(c[min], 0, c_mid - w);
+	c_max = CLAMP(c[max], c_mid + w, period + 1);
+
+	data->ccr_shift[max] = c_max - c[max];
+	data->ccr_shift[mid] = c_mid - c[mid];
+	data->ccr_shift[min] = c_min - c[min];
+
+	c[max] = c_max;
+	c[mid] = c_mid;
+	c[min] = c_min;
+
+	LL_TIM_OC_SetCompareCH1(config->timer, (uint32_t)c[0]);
+	LL_TIM_OC_SetCompareCH2(config->timer, (uint32_t)c[1]);
+	LL_TIM_OC_SetCompareCH3(config->timer, (uint32_t)c[2]);
+	LL_TIM_OC_SetCompareCH4(config->timer,
+				(uint32_t)c_min + data->smp_settle);
+	LL_TIM_OC_SetCompareCH6(config->timer,
+				(uint32_t)c_mid + data->smp_settle);
+
+	currsmp_set_sector(config->currsmp, order_sector[max][min]);
+}
+#endif
+
+/**
+ * @brief Program compare values (three/two shunts).
+ *
+ * @param[in] dev SV-PWM device.
+ * @param[in] ccr Phase compare values (a, b, c).
+ * @param[in] sector SV-PWM sector.
+ */
+static void ccr_program_shunt(const struct device *dev, const uint32_t ccr[3],
+			      uint8_t sector)
+{
+	const struct svpwm_stm32_config *config = dev->config;
+	struct svpwm_stm32_data *data = dev->data;
+
+	LL_TIM_OC_SetCompareCH1(config->timer, ccr[0]);
+	LL_TIM_OC_SetCompareCH2(config->timer, ccr[1]);
+	LL_TIM_OC_SetCompareCH3(config->timer, ccr[2]);
+	LL_TIM_OC_SetCompareCH4(config->timer,
+				smp_ccr(data, ccr[0], ccr[1], ccr[2]));
+
+	/* zero-vector trigger (counter valley), only if the window fits */
+	if (MIN(MIN(ccr[0], ccr[1]), ccr[2]) >=
+	    data->smp_settle + data->smp_len) {
+		LL_TIM_OC_SetCompareCH5(config->timer,
+					MAX(data->smp_settle, 1U));
+	} else {
+		LL_TIM_OC_SetCompareCH5(config->timer, 0U);
+	}
+
+	/* inform current sampling device about current sector */
+	currsmp_set_sector(config->currsmp, sector);
+}
+
+/**
+ * @brief Program compare values.
+ *
+ * @param[in] dev SV-PWM device.
+ * @param[in] ccr Phase compare values (a, b, c).
+ * @param[in] sector SV-PWM sector.
+ */
+static inline void ccr_program(const struct device *dev,
+			       const uint32_t ccr[3], uint8_t sector)
+{
+#if SINGLE_SHUNT
+	if (single_shunt(dev)) {
+		ccr_program_single_shunt(dev, ccr, sector);
+		return;
+	}
+#endif
+
+	ccr_program_shunt(dev, ccr, sector);
+}
+
 /*******************************************************************************
  * API
  ******************************************************************************/
@@ -49,19 +333,35 @@ static void svpwm_stm32_start(const struct device *dev)
 	const struct svpwm_stm32_config *config = dev->config;
 	struct svpwm_stm32_data *data = dev->data;
 
+	uint32_t ccr[3] = {data->period / 2U, data->period / 2U,
+			   data->period / 2U};
+
 	svm_init(&data->svm);
 	data->svm.sector = 5U;
-	currsmp_set_sector(config->currsmp, data->svm.sector);
+	data->svm.d_smp = data->d_smp;
+	svm_set_dead_time(&data->svm, data->d_dt, DT_COMP_I_BAND);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	svm_q31_init(&data->svm_q31);
+	data->svm_q31.sector = 5U;
+	/* d_smp may be 1.0 (single shunt), saturate to the Q31 range */
+	data->svm_q31.d_smp =
+		clip_q63_to_q31((q63_t)(data->d_smp * 2147483648.0f));
+	svm_q31_set_dead_time(&data->svm_q31, data->d_dt, DT_COMP_I_BAND);
+	data->q31 = false;
+#endif
+#if SINGLE_SHUNT
+	for (size_t i = 0U; i < 3U; i++) {
+		data->ccr_shift[i] = 0;
+	}
+#endif
 
 	/* activate enable pins if available */
 	for (size_t i = 0U; i < config->enable_len; i++) {
 		gpio_pin_set(config->enable[i].port, config->enable[i].pin, 1);
 	}
 
-	/* configure timer OC for a, b, c */
-	LL_TIM_OC_SetCompareCH1(config->timer, data->period / 2U);
-	LL_TIM_OC_SetCompareCH2(config->timer, data->period / 2U);
-	LL_TIM_OC_SetCompareCH3(config->timer, data->period / 2U);
+	/* configure timer OC for a, b, c and ADC trigger */
+	ccr_program(dev, ccr, data->svm.sector);
 
 	LL_TIM_CC_EnableChannel(config->timer, LL_TIM_CHANNEL_CH1);
 	LL_TIM_CC_EnableChannel(config->timer, LL_TIM_CHANNEL_CH2);
@@ -72,8 +372,10 @@ static void svpwm_stm32_start(const struct device *dev)
 		LL_TIM_CC_EnableChannel(config->timer, LL_TIM_CHANNEL_CH3N);
 	}
 
-	/* configure timer OC for ADC trigger */
 	LL_TIM_CC_EnableChannel(config->timer, LL_TIM_CHANNEL_CH4);
+	LL_TIM_CC_EnableChannel(config->timer, single_shunt(dev)
+						       ? LL_TIM_CHANNEL_CH6
+						       : LL_TIM_CHANNEL_CH5);
 
 	/* start timer */
 	LL_TIM_EnableAllOutputs(config->timer);
@@ -100,6 +402,9 @@ static void svpwm_stm32_stop(const struct device *dev)
 	}
 
 	LL_TIM_CC_DisableChannel(config->timer, LL_TIM_CHANNEL_CH4);
+	LL_TIM_CC_DisableChannel(config->timer, single_shunt(dev)
+							? LL_TIM_CHANNEL_CH6
+							: LL_TIM_CHANNEL_CH5);
 
 	/* deactivate enable pins if available */
 	for (size_t i = 0U; i < config->enable_len; i++) {
@@ -114,26 +419,95 @@ static void svpwm_stm32_set_phase_voltages(const struct device *dev,
 	struct svpwm_stm32_data *data = dev->data;
 
 	const svm_duties_t *duties = &data->svm.duties;
+	uint32_t ccr[3];
 
 	/* space-vector modulation */
 	svm_set(&data->svm, v_alpha, v_beta);
 
-	/* program duties */
-	LL_TIM_OC_SetCompareCH1(config->timer,
-				(uint32_t)(data->period * duties->a));
-	LL_TIM_OC_SetCompareCH2(config->timer,
-				(uint32_t)(data->period * duties->b));
-	LL_TIM_OC_SetCompareCH3(config->timer,
-				(uint32_t)(data->period * duties->c));
+#ifdef CONFIG_SPINNER_SVPWM_STM32_DT_COMP
+	/* dead-time compensation (currents of the last sampling point) */
+	if (data->d_dt > 0.0f) {
+		struct currsmp_curr curr;
 
-	/* inform current sampling device about current sector */
-	currsmp_set_sector(config->currsmp, data->svm.sector);
+		currsmp_get_currents(config->currsmp, &curr);
+		svm_comp_dead_time(&data->svm, curr.i_a, curr.i_b, curr.i_c);
+	}
+#endif
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	data->q31 = false;
+#endif
+
+	/* program duties and ADC sampling point */
+	ccr[0] = duty_to_ccr(data->period, duties->a);
+	ccr[1] = duty_to_ccr(data->period, duties->b);
+	ccr[2] = duty_to_ccr(data->period, duties->c);
+
+	ccr_program(dev, ccr, data->svm.sector);
+}
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+static void svpwm_stm32_set_phase_voltages_q31(const struct device *dev,
+					       int32_t v_alpha, int32_t v_beta)
+{
+	const struct svpwm_stm32_config *config = dev->config;
+	struct svpwm_stm32_data *data = dev->data;
+
+	const svm_duties_q31_t *duties = &data->svm_q31.duties;
+	uint32_t ccr[3];
+
+	/* space-vector modulation */
+	svm_q31_set(&data->svm_q31, v_alpha, v_beta);
+	data->q31 = true;
+
+#ifdef CONFIG_SPINNER_SVPWM_STM32_DT_COMP
+	/* dead-time compensation (currents of the last sampling point) */
+	if (data->svm_q31.d_dt > 0) {
+		struct currsmp_curr_q31 curr;
+
+		currsmp_get_currents_q31(config->currsmp, &curr);
+		svm_q31_comp_dead_time(&data->svm_q31, curr.i_a, curr.i_b,
+				       curr.i_c);
+	}
+#endif
+
+	/* program duties (period * duty, duty in Q31) and ADC sampling point */
+	ccr[0] = duty_q31_to_ccr(data->period, duties->a);
+	ccr[1] = duty_q31_to_ccr(data->period, duties->b);
+	ccr[2] = duty_q31_to_ccr(data->period, duties->c);
+
+	ccr_program(dev, ccr, data->svm_q31.sector);
+}
+#endif
+
+static float svpwm_stm32_get_mod_index(const struct device *dev)
+{
+	struct svpwm_stm32_data *data = dev->data;
+
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	if (data->q31) {
+		return svm_q31_get_mod_index(&data->svm_q31);
+	}
+#endif
+
+	return svm_get_mod_index(&data->svm);
+}
+
+static uint32_t svpwm_stm32_get_freq(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return CONFIG_SPINNER_SVPWM_STM32_PWM_FREQ;
 }
 
 static const struct svpwm_driver_api svpwm_stm32_driver_api = {
 	.start = svpwm_stm32_start,
 	.stop = svpwm_stm32_stop,
 	.set_phase_voltages = svpwm_stm32_set_phase_voltages,
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	.set_phase_voltages_q31 = svpwm_stm32_set_phase_voltages_q31,
+#endif
+	.get_mod_index = svpwm_stm32_get_mod_index,
+	.get_freq = svpwm_stm32_get_freq,
 };
 
 /*******************************************************************************
@@ -146,8 +520,9 @@ static int svpwm_stm32_init(const struct device *dev)
 	struct svpwm_stm32_data *data = dev->data;
 
 	int ret;
-	uint32_t freq;
+	uint32_t freq, ckd, t_smp, t_dead;
 	uint16_t psc;
+	uint8_t dtg;
 	const struct device *clk;
 	LL_TIM_InitTypeDef tim_init;
 	LL_TIM_OC_InitTypeDef tim_ocinit;
@@ -180,18 +555,80 @@ static int svpwm_stm32_init(const struct device *dev)
 		return ret;
 	}
 
+	/* NOTE: period + 1 (full duty cycle) must fit in the compare register */
 	psc = 0U;
-	do {
+	data->period = __LL_TIM_CALC_ARR(
+		freq, psc, CONFIG_SPINNER_SVPWM_STM32_PWM_FREQ * 2U);
+	while (data->period >= UINT16_MAX) {
+		psc++;
 		data->period = __LL_TIM_CALC_ARR(
 			freq, psc, CONFIG_SPINNER_SVPWM_STM32_PWM_FREQ * 2U);
-		psc++;
-	} while (data->period > UINT16_MAX);
+	}
+
+	/* dead time, inserted by the timer on complementary outputs (otherwise
+	 * by the driver IC), used for sampling and compensation in both cases.
+	 * The timer rounds it up, so the actual (programmed) value is used.
+	 */
+	ckd = LL_TIM_CLOCKDIVISION_DIV1;
+	dtg = 0U;
+	t_dead = config->t_dead;
+	if (config->enable_comp_outputs) {
+		ret = stm32_tim_dead_time_get(freq, config->t_dead, &ckd,
+					      &dtg);
+		if (ret < 0) {
+			LOG_ERR("Dead time too long (%u ns)", config->t_dead);
+			return ret;
+		}
+
+		t_dead = stm32_tim_dead_time_ns(freq, ckd, dtg);
+	}
+
+	if (IS_ENABLED(CONFIG_SPINNER_SVPWM_STM32_DT_COMP)) {
+		data->d_dt = (float)t_dead * 1.0e-9f *
+			     (float)CONFIG_SPINNER_SVPWM_STM32_PWM_FREQ;
+	} else {
+		data->d_dt = 0.0f;
+	}
+
+	/* ADC sampling window: the sampled phases low-side needs to be on for
+	 * t_dead + t_rise (settling) before sampling starts, and during the
+	 * whole ADC sampling time
+	 */
+	t_smp = currsmp_get_smp_time(config->currsmp);
+
+	data->smp_settle = ns_to_ticks(t_dead + config->t_rise,
+				       freq / (psc + 1U));
+	data->smp_len = ns_to_ticks(t_smp, freq / (psc + 1U));
+
+	if (single_shunt(dev)) {
+		/* both active vectors windows need to fit in half a period */
+		if (data->period < 2U * (data->smp_settle + data->smp_len)) {
+			LOG_ERR("PWM period too short for single-shunt "
+				"sampling");
+			return -EINVAL;
+		}
+
+		/* sampling windows are inserted, no limit on duty cycles */
+		data->d_smp = 1.0f;
+	} else {
+		/* maximum duty cycle of the sampled phases (discontinuous SVM
+		 * modes), so that the low-side on time covers the sampling
+		 * window (the trigger is moved before the counter peak if
+		 * needed, see smp_ccr())
+		 */
+		float t_win = (float)(t_dead + config->t_rise + t_smp);
+
+		data->d_smp = 1.0f - t_win * 1.0e-9f *
+				(float)CONFIG_SPINNER_SVPWM_STM32_PWM_FREQ;
+	}
 
 	/* initialize timer
 	 * NOTE: repetition counter set to 1, update will happen on underflow
 	 */
 	LL_TIM_StructInit(&tim_init);
+	tim_init.Prescaler = psc;
 	tim_init.CounterMode = LL_TIM_COUNTERMODE_CENTER_UP;
+	tim_init.ClockDivision = ckd;
 	tim_init.Autoreload = data->period;
 	tim_init.RepetitionCounter = 1U;
 	if (LL_TIM_Init(config->timer, &tim_init) != SUCCESS) {
@@ -233,13 +670,38 @@ static int svpwm_stm32_init(const struct device *dev)
 
 	LL_TIM_SetTriggerOutput(config->timer, LL_TIM_TRGO_OC4REF);
 
+	if (single_shunt(dev)) {
+		/* second ADC trigger channel, both combined on TRGO2 */
+		if (LL_TIM_OC_Init(config->timer, LL_TIM_CHANNEL_CH6,
+				   &tim_ocinit) != SUCCESS) {
+			LOG_ERR("Could not initialize timer OC for channel 6");
+			return -EIO;
+		}
+
+		LL_TIM_SetTriggerOutput2(config->timer,
+					 LL_TIM_TRGO2_OC4_RISING_OC6_RISING);
+	} else {
+		/* zero-vector trigger channel (e.g. offset tracking), TRGO2 */
+		tim_ocinit.CompareValue = 0U;
+		if (LL_TIM_OC_Init(config->timer, LL_TIM_CHANNEL_CH5,
+				   &tim_ocinit) != SUCCESS) {
+			LOG_ERR("Could not initialize timer OC for channel 5");
+			return -EIO;
+		}
+
+		LL_TIM_SetTriggerOutput2(config->timer, LL_TIM_TRGO2_OC5);
+	}
+
 	/* enable pre-load on all OC channels */
 	LL_TIM_OC_EnablePreload(config->timer, LL_TIM_CHANNEL_CH1);
 	LL_TIM_OC_EnablePreload(config->timer, LL_TIM_CHANNEL_CH2);
 	LL_TIM_OC_EnablePreload(config->timer, LL_TIM_CHANNEL_CH3);
 	LL_TIM_OC_EnablePreload(config->timer, LL_TIM_CHANNEL_CH4);
+	LL_TIM_OC_EnablePreload(config->timer, single_shunt(dev)
+						       ? LL_TIM_CHANNEL_CH6
+						       : LL_TIM_CHANNEL_CH5);
 
-	/* configure ADC sampling point (middle of the period) */
+	/* configure ADC sampling point (counter peak, adjusted every cycle) */
 	LL_TIM_OC_SetCompareCH4(config->timer, data->period - 1U);
 
 	/* setup break and dead-time if available */
@@ -247,8 +709,7 @@ static int svpwm_stm32_init(const struct device *dev)
 	brk_dt_init.OSSRState = LL_TIM_OSSR_ENABLE;
 	brk_dt_init.OSSIState = LL_TIM_OSSI_ENABLE;
 	brk_dt_init.LockLevel = LL_TIM_LOCKLEVEL_1;
-	/* TODO: add support for dead-time */
-	brk_dt_init.DeadTime = 0U;
+	brk_dt_init.DeadTime = dtg;
 	brk_dt_init.BreakState = LL_TIM_BREAK_ENABLE;
 	brk_dt_init.BreakPolarity = LL_TIM_BREAK_POLARITY_HIGH;
 	brk_dt_init.Break2State = LL_TIM_BREAK2_ENABLE;
@@ -276,27 +737,39 @@ static int svpwm_stm32_init(const struct device *dev)
 	return 0;
 }
 
-PINCTRL_DT_INST_DEFINE(0);
-
-static const struct gpio_dt_spec enable_pins[] = {DT_FOREACH_PROP_ELEM_SEP(
-	DT_INST_CHILD(0, driver), enable_gpios, GPIO_DT_SPEC_GET_BY_IDX, (, ))};
-
-static const struct svpwm_stm32_config svpwm_stm32_config = {
-	.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(0)),
-	.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(0)),
-	.enable_comp_outputs = DT_PROP_OR(DT_INST_CHILD(0, driver),
-					  enable_comp_outputs, false),
-	.t_dead = DT_PROP_OR(DT_INST_CHILD(0, driver), t_dead_ns, 0),
-	.t_rise = DT_PROP_OR(DT_INST_CHILD(0, driver), t_rise_ns, 0),
-	.currsmp = DEVICE_DT_GET(DT_INST_PHANDLE(0, currsmp)),
-	.enable = enable_pins,
-	.enable_len = ARRAY_SIZE(enable_pins),
-	.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(0),
-};
-
-static struct svpwm_stm32_data svpwm_stm32_data;
-
-DEVICE_DT_INST_DEFINE(0, &svpwm_stm32_init, NULL, &svpwm_stm32_data,
-		      &svpwm_stm32_config, POST_KERNEL,
-		      CONFIG_SPINNER_SVPWM_INIT_PRIORITY,
-		      &svpwm_stm32_driver_api);
+#define SVPWM_STM32_INIT(inst)                                                 \
+	PINCTRL_DT_INST_DEFINE(inst);                                          \
+                                                                               \
+	static const struct gpio_dt_spec enable_pins_##inst[] = {              \
+		DT_FOREACH_PROP_ELEM_SEP(DT_INST_CHILD(inst, driver),          \
+					 enable_gpios,                         \
+					 GPIO_DT_SPEC_GET_BY_IDX, (, ))};      \
+                                                                               \
+	static const struct svpwm_stm32_config svpwm_stm32_config_##inst = {  \
+		.timer = (TIM_TypeDef *)DT_REG_ADDR(DT_INST_PARENT(inst)),     \
+		.pclken = STM32_CLOCK_INFO(0, DT_INST_PARENT(inst)),           \
+		.enable_comp_outputs = DT_PROP_OR(DT_INST_CHILD(inst, driver), \
+						  enable_comp_outputs, false), \
+		.t_dead = DT_PROP_OR(DT_INST_CHILD(inst, driver), t_dead_ns,   \
+				     0),                                       \
+		.t_rise = DT_PROP_OR(DT_INST_CHILD(inst, driver), t_rise_ns,   \
+				     0),                                       \
+		.currsmp = DEVICE_DT_GET(DT_INST_PHANDLE(inst, currsmp)),      \
+		IF_ENABLED(SINGLE_SHUNT,                                       \
+			   (.single_shunt = DT_NODE_HAS_COMPAT(                \
+				    DT_INST_PHANDLE(inst, currsmp),            \
+				    st_stm32_currsmp_single_shunt),))          \
+		.enable = enable_pins_##inst,                                  \
+		.enable_len = ARRAY_SIZE(enable_pins_##inst),                  \
+		.pcfg = PINCTRL_DT_INST_DEV_CONFIG_GET(inst),                  \
+	};                                                                     \
+                                                                               \
+	static struct svpwm_stm32_data svpwm_stm32_data_##inst;                \
+                                                                               \
+	DEVICE_DT_INST_DEFINE(inst, &svpwm_stm32_init, NULL,                   \
+			      &svpwm_stm32_data_##inst,                        \
+			      &svpwm_stm32_config_##inst, POST_KERNEL,         \
+			      CONFIG_SPINNER_SVPWM_INIT_PRIORITY,              \
+			      &svpwm_stm32_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(SVPWM_STM32_INIT)
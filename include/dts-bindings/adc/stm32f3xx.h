@@ -10,8 +10,9 @@
 #ifndef _DTS_BINDINGS_INVERTER_STM32F3XX_H_
 #define _DTS_BINDINGS_INVERTER_STM32F3XX_H_
 
-/* Ref. RM0365, Rev. 8, Table 88. */
+/* Ref. RM0365, Rev. 8, Tables 87, 88. */
 
+#define _STM32_ADC_EXT_POS  6U
 #define _STM32_ADC_JEXT_POS 2U
 
 #define STM32_ADC_INJ_TRIG_TIM1_TRGO  (0U << _STM32_ADC_JEXT_POS)
@@ -28,4 +29,7 @@
 #define STM32_ADC_INJ_TRIG_TIM6_TRGO  (14U << _STM32_ADC_JEXT_POS)
 #define STM32_ADC_INJ_TRIG_TIM15_TRGO (15U << _STM32_ADC_JEXT_POS)
 
+#define STM32_ADC_REG_TRIG_TIM1_TRGO  (9U << _STM32_ADC_EXT_POS)
+#define STM32_ADC_REG_TRIG_TIM1_TRGO2 (10U << _STM32_ADC_EXT_POS)
+
 #endif /* _DTS_BINDINGS_INVERTER_STM32F3XX_H_ */
@@ -10,8 +10,9 @@
 #ifndef _DTS_BINDINGS_INVERTER_STM32G4XX_H_
 #define _DTS_BINDINGS_INVERTER_STM32G4XX_H_
 
-/* Ref. RM0440, Rev. 6, Tables 164, 166. */
+/* Ref. RM0440, Rev. 6, Tables 163, 164, 165, 166. */
 
+#define _STM32_ADC_EXT_POS  5U
 #define _STM32_ADC_JEXT_POS 2U
 
 #define STM32_ADC12_INJ_TRIG_TIM1_TRGO	     (0U << _STM32_ADC_JEXT_POS)
@@ -77,4 +78,14 @@
 #define STM32_ADC345_INJ_TRIG_LPTIMOUT	      (29U << _STM32_ADC_JEXT_POS)
 #define STM32_ADC345_INJ_TRIG_TIM7_TRGO	      (30U << _STM32_ADC_JEXT_POS)
 
+#define STM32_ADC12_REG_TRIG_TIM8_TRGO	(7U << _STM32_ADC_EXT_POS)
+#define STM32_ADC12_REG_TRIG_TIM8_TRGO2 (8U << _STM32_ADC_EXT_POS)
+#define STM32_ADC12_REG_TRIG_TIM1_TRGO	(9U << _STM32_ADC_EXT_POS)
+#define STM32_ADC12_REG_TRIG_TIM1_TRGO2 (10U << _STM32_ADC_EXT_POS)
+
+#define STM32_ADC345_REG_TRIG_TIM8_TRGO	 (7U << _STM32_ADC_EXT_POS)
+#define STM32_ADC345_REG_TRIG_TIM8_TRGO2 (8U << _STM32_ADC_EXT_POS)
+#define STM32_ADC345_REG_TRIG_TIM1_TRGO	 (9U << _STM32_ADC_EXT_POS)
+#define STM32_ADC345_REG_TRIG_TIM1_TRGO2 (10U << _STM32_ADC_EXT_POS)
+
 #endif /* _DTS_BINDINGS_INVERTER_STM32G4XX_H_ */
@@ -10,29 +10,570 @@
 #ifndef _SPINNER_LIB_CONTROL_CLOOP_H_
 #define _SPINNER_LIB_CONTROL_CLOOP_H_
 
+#include <stddef.h>
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+#include <spinner/pi/pi.h>
+#include <spinner/utils/dbuf.h>
+
 /**
  * @defgroup spinner_lib_control_cloop Current Loop API
  * @ingroup spinner_lib_control
+ *
+ * Each current loop instance regulates one motor, given by its current
+ * sampling, feedback and SV-PWM devices, from the current sampling device
+ * regulation IRQ. Multiple instances can run on the same SoC (e.g. two motors
+ * driven by two timers and separate ADCs).
+ *
+ * If CONFIG_SPINNER_CLOOP_DEFAULT is enabled, a default instance bound to the
+ * currsmp, feedback and svpwm devicetree node labels is initialized at boot.
+ * If a teslabs,cloop devicetree node is present, motor parameters and
+ * bandwidth of the default instance are taken from it.
+ * The speed and position loops, the shell, the scope and the profiling
+ * statistics run on the default instance only.
+ *
  * @{
  */
 
+/**
+ * @brief Current loop PI controllers gains.
+ *
+ * Gains are normalized (currents relative to the current sampling full-scale,
+ * voltages to 2/3 of V_bus), integral gains being per sample.
+ */
+struct cloop_gains {
+	/** Torque (q-axis) proportional gain. */
+	float t_kp;
+	/** Torque (q-axis) integral gain. */
+	float t_ki;
+	/** Flux (d-axis) proportional gain. */
+	float f_kp;
+	/** Flux (d-axis) integral gain. */
+	float f_ki;
+};
+
+/** @brief Current loop motor parameters. */
+struct cloop_motor {
+	/** Stator phase resistance (Ohm). */
+	float r;
+	/** d-axis inductance (H). */
+	float l_d;
+	/** q-axis inductance (H). */
+	float l_q;
+	/** Permanent magnet flux linkage (Wb). */
+	float flux;
+	/** Current sampling full-scale current (A). */
+	float i_fs;
+	/** Inverter DC bus voltage (V). */
+	float v_bus;
+};
+
+/** @cond INTERNAL_HIDDEN */
+
+/** @brief Parameters used by the regulation IRQ. */
+struct cloop_params {
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	q31_t i_q_ref;
+	q31_t i_d_ref;
+	struct pi_dq_coeffs_q31 coeffs;
+#else
+	float i_q_ref;
+	float i_d_ref;
+	/* i_q limit for the speed loop (i_max, d-axis priority) */
+	float i_q_max;
+	struct pi_dq_coeffs coeffs;
+#ifdef CONFIG_SPINNER_CLOOP_DECOUPLING
+	/* decoupling coefficients (normalized, speeds in rev/s) */
+	float k_r;
+	float k_l_d;
+	float k_l_q;
+	float k_flux;
+#endif
+#endif
+};
+
+/** @endcond */
+
+/**
+ * @brief Current loop instance.
+ *
+ * Fields are internal, the instance needs to be initialized with cloop_init().
+ */
+typedef struct cloop {
+	/** @cond INTERNAL_HIDDEN */
+	const struct device *currsmp;
+	const struct device *feedback;
+	const struct device *svpwm;
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	pi_dq_q31_t pi;
+#else
+	pi_dq_t pi;
+#endif
+	/* regulation IRQ parameters (copy of the last published) */
+	struct cloop_params params;
+	atomic_val_t params_seq;
+	/* parameters exchange buffers */
+	struct cloop_params params_buf[2];
+	struct dbuf params_dbuf;
+	/* thread context settings */
+	struct k_mutex lock;
+	float i_d_ref;
+	float i_q_ref;
+	float i_max;
+	struct cloop_gains gains;
+	struct cloop_motor motor;
+	float bw;
+	/** @endcond */
+} cloop_t;
+
+#if defined(CONFIG_SPINNER_CLOOP_DEFAULT) || defined(__DOXYGEN__)
+/** Default current loop instance. */
+extern cloop_t cloop_default;
+#endif
+
+/**
+ * @brief Initialize a current loop instance.
+ *
+ * The instance takes over the current sampling device regulation callback,
+ * and configures the feedback device with the SV-PWM frequency. References
+ * are zero, motor parameters are not set (no bandwidth), and gains and limits
+ * are set to their Kconfig defaults.
+ *
+ * @note Must be called from thread context, with the loop stopped.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] currsmp Current sampling device.
+ * @param[in] feedback Feedback device.
+ * @param[in] svpwm SV-PWM device.
+ *
+ * @retval 0 On success.
+ * @retval -ENODEV If any of the devices is not ready.
+ */
+int cloop_init(cloop_t *cloop, const struct device *currsmp,
+	       const struct device *feedback, const struct device *svpwm);
+
 /**
  * @brief Start current loop.
+ *
+ * @param[in] cloop Current loop instance.
  */
-void cloop_start(void);
+void cloop_start(cloop_t *cloop);
 
 /**
  * @brief Stop current loop.
+ *
+ * @param[in] cloop Current loop instance.
  */
-void cloop_stop(void);
+void cloop_stop(cloop_t *cloop);
 
 /**
  * @brief Set current loop working point.
  *
+ * References, as well as limits and gains, are handed over to the regulation
+ * IRQ without masking it (double buffer), so that they can be updated at high
+ * rates without disturbing the regulation.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] cloop Current loop instance.
  * @param[in] i_d i_d current value.
  * @param[in] i_q i_q current value.
  */
-void cloop_set_ref(float i_d, float i_q);
+void cloop_set_ref(cloop_t *cloop, float i_d, float i_q);
+
+/**
+ * @brief Set the current references amplitude limit.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] i_max Maximum current amplitude (relative to full-scale, defaults
+ * to 1).
+ */
+void cloop_set_i_max(cloop_t *cloop, float i_max);
+
+/**
+ * @brief Set the PI controllers gains.
+ *
+ * Controllers state is preserved. Gains are no longer computed from the
+ * bandwidth (see cloop_set_bandwidth()).
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] gains Gains.
+ */
+void cloop_set_gains(cloop_t *cloop, const struct cloop_gains *gains);
+
+/**
+ * @brief Obtain the PI controllers gains.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[out] gains Gains.
+ */
+void cloop_get_gains(cloop_t *cloop, struct cloop_gains *gains);
+
+/**
+ * @brief Compute the PI controllers gains for a closed loop bandwidth.
+ *
+ * Gains are computed for the discrete plant, i.e. the R-L circuit of each axis
+ * sampled with a zero-order hold at the PWM period Ts. The PI zero cancels the
+ * plant pole, a = exp(-R * Ts / L), and the closed loop pole is placed at
+ * exp(-2 * pi * bw * Ts):
+ *
+ *     kp = R * a * (1 - exp(-2 * pi * bw * Ts)) / (1 - a)
+ *     ki = R * (1 - exp(-2 * pi * bw * Ts))
+ *
+ * which tend to the continuous time design (kp = w * L, ki = w * R * Ts) for
+ * bandwidths well below the PWM frequency. Gains are normalized using the
+ * motor full-scale current and bus voltage. As the regulation adds one PWM
+ * period of delay, the bandwidth is limited to 1/10 of the PWM frequency
+ * (1/20 or lower is recommended for a well damped response).
+ *
+ * @param[out] gains Gains.
+ * @param[in] motor Motor parameters (resistance, inductances, full-scale
+ * current and bus voltage are used).
+ * @param[in] bw Closed loop bandwidth (Hz).
+ * @param[in] f_pwm PWM frequency (Hz).
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If motor parameters are not set, or the bandwidth is out of
+ * range.
+ */
+int cloop_gains_compute(struct cloop_gains *gains,
+			const struct cloop_motor *motor, float bw,
+			uint32_t f_pwm);
+
+/**
+ * @brief Set the closed loop bandwidth.
+ *
+ * Gains are computed from the motor parameters and the SV-PWM frequency (see
+ * cloop_gains_compute()), and recomputed whenever motor parameters are set
+ * (e.g. after an identification). A zero bandwidth keeps the current gains,
+ * which then can only be changed with cloop_set_gains().
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] bw Closed loop bandwidth (Hz), zero to disable.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If motor parameters are not set, or the bandwidth is out of
+ * range (bandwidth is left unchanged).
+ */
+int cloop_set_bandwidth(cloop_t *cloop, float bw);
+
+/**
+ * @brief Set the motor parameters.
+ *
+ * If CONFIG_SPINNER_CLOOP_DECOUPLING is enabled, the cross-coupling
+ * (-w * L_q * i_q, w * L_d * i_d), back-EMF (w * flux) and resistive
+ * (R * i_ref) voltages are added to the PI controllers output, being w the
+ * electrical speed provided by the feedback device, so that the PI controllers
+ * only need to correct the model error. Terms can be disabled by setting the
+ * corresponding parameters to zero (the default).
+ *
+ * If a bandwidth is set (see cloop_set_bandwidth()), gains are recomputed from
+ * the new parameters. If they can not be computed (e.g. zero resistance), the
+ * parameters are not applied and both motor parameters and gains are left
+ * unchanged.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] motor Motor parameters.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If a bandwidth is set and gains can not be computed from the
+ * given parameters.
+ */
+int cloop_set_motor(cloop_t *cloop, const struct cloop_motor *motor);
+
+/**
+ * @brief Obtain the motor parameters.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[out] motor Motor parameters.
+ */
+void cloop_get_motor(cloop_t *cloop, struct cloop_motor *motor);
+
+#if defined(CONFIG_SPINNER_CLOOP_IDENT) || defined(__DOXYGEN__)
+
+/** @brief Motor parameters identification configuration. */
+struct cloop_ident_config {
+	/** Test current (relative to full-scale). */
+	float i_test;
+	/** Inductance test voltage amplitude (relative to 2/3 of V_bus). */
+	float v_hf;
+	/** Flux linkage test speed (electrical rev/s). */
+	float speed;
+	/** Current sampling full-scale current (A). */
+	float i_fs;
+	/** Inverter DC bus voltage (V). */
+	float v_bus;
+};
+
+/**
+ * @brief Identify the motor parameters.
+ *
+ * The current sampling regulation callback is taken over while the
+ * identification runs, so that the following tests are run from the
+ * regulation IRQ:
+ *
+ * 1. Resistance: a DC voltage is ramped along the alpha axis (aligning the
+ *    rotor d-axis to it) until the current reaches i_test / 2, and then
+ *    i_test. The resistance is obtained from the voltage to current slope
+ *    between both points, so that inverter voltage drops cancel out.
+ * 2. Inductances: a square wave voltage of amplitude v_hf is added to the DC
+ *    voltage along the d-axis (L_d), and then the q-axis (L_q). Inductances
+ *    are obtained from the current slope.
+ * 3. Flux linkage: a current vector of amplitude i_test is rotated up to the
+ *    test speed (I/f control), the rotor following it. Flux linkage is
+ *    obtained from the voltage left after subtracting the resistive and
+ *    inductive drops (back-EMF).
+ *
+ * The rotor needs to be free to align and rotate, without load. Results are
+ * stored as the instance motor parameters (see cloop_set_motor()).
+ *
+ * @note Must be called from thread context, with the loop stopped. It blocks
+ * until the identification finishes (a few seconds).
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] config Identification configuration.
+ * @param[out] motor Identified motor parameters.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If the configuration is not valid.
+ * @retval -EIO If the test current could not be reached, or the results are
+ * not valid (including not allowing to compute gains for the configured
+ * bandwidth).
+ * @retval -ETIMEDOUT If any test did not finish in time.
+ */
+int cloop_ident_run(cloop_t *cloop, const struct cloop_ident_config *config,
+		    struct cloop_motor *motor);
+
+#endif /* defined(CONFIG_SPINNER_CLOOP_IDENT) || defined(__DOXYGEN__) */
+
+/**
+ * @brief Obtain the modulation index applied by the current loop.
+ *
+ * A modulation index below the one requested by the PI controllers indicates a
+ * voltage shortfall (the inverter output is saturated).
+ *
+ * @param[in] cloop Current loop instance.
+ *
+ * @return Modulation index.
+ *
+ * @see svpwm_get_mod_index()
+ */
+float cloop_get_mod_index(cloop_t *cloop);
+
+/** @brief Current loop profiled stages. */
+enum cloop_stats_stage {
+	/** Phase currents read. */
+	CLOOP_STATS_STAGE_CURRENTS,
+	/** Electrical angle read and sin/cos. */
+	CLOOP_STATS_STAGE_SIN_COS,
+	/** Clarke and Park transforms. */
+	CLOOP_STATS_STAGE_PARK,
+	/** i_d and i_q PI controllers. */
+	CLOOP_STATS_STAGE_PI,
+	/** Inverse Park transform. */
+	CLOOP_STATS_STAGE_INV_PARK,
+	/** SV-PWM (modulation and timer update). */
+	CLOOP_STATS_STAGE_SVPWM,
+	/** Scope capture. */
+	CLOOP_STATS_STAGE_SCOPE,
+	/** Whole regulation callback. */
+	CLOOP_STATS_STAGE_TOTAL,
+	/** Time between consecutive regulation callbacks. */
+	CLOOP_STATS_STAGE_PERIOD,
+	/** Number of stages. */
+	CLOOP_STATS_STAGE_COUNT,
+};
+
+#if defined(CONFIG_SPINNER_CLOOP_STATS) || defined(__DOXYGEN__)
+
+/** Number of histogram bins (log2 scale). */
+#define CLOOP_STATS_HIST_BINS 16U
+
+/** @brief Current loop stage statistics. */
+struct cloop_stats {
+	/** Minimum (cycles). */
+	uint32_t min;
+	/** Maximum (cycles). */
+	uint32_t max;
+	/** Sum of all measurements (cycles). */
+	uint64_t sum;
+	/** Number of measurements. */
+	uint32_t count;
+	/**
+	 * Histogram. Bin n counts measurements in [2^(n - 1), 2^n) cycles,
+	 * last bin also includes any measurement above its range.
+	 */
+	uint32_t hist[CLOOP_STATS_HIST_BINS];
+};
+
+/**
+ * @brief Obtain current loop stage statistics.
+ *
+ * @param[in] stage Stage.
+ * @param[out] stats Where statistics will be stored.
+ */
+void cloop_stats_get(enum cloop_stats_stage stage, struct cloop_stats *stats);
+
+/**
+ * @brief Reset current loop statistics.
+ *
+ * @note Statistics are reset on the next regulation cycle.
+ */
+void cloop_stats_reset(void);
+
+/**
+ * @brief Obtain the rate of the cycle counter used for statistics.
+ *
+ * @return Cycle counter rate (Hz), zero if unknown.
+ */
+uint32_t cloop_stats_get_rate(void);
+
+#endif /* defined(CONFIG_SPINNER_CLOOP_STATS) || defined(__DOXYGEN__) */
+
+#if defined(CONFIG_SPINNER_CLOOP_SCOPE) || defined(__DOXYGEN__)
+
+/**
+ * @brief Current loop scope signals.
+ *
+ * All signals are captured as 16-bit words.
+ */
+enum cloop_scope_signal {
+	/** i_d current (Q15, relative to full-scale). */
+	CLOOP_SCOPE_SIGNAL_I_D,
+	/** i_q current (Q15, relative to full-scale). */
+	CLOOP_SCOPE_SIGNAL_I_Q,
+	/** v_d voltage (Q15, saturated). */
+	CLOOP_SCOPE_SIGNAL_V_D,
+	/** v_q voltage (Q15, saturated). */
+	CLOOP_SCOPE_SIGNAL_V_Q,
+	/** Electrical angle (unsigned, 65536 per turn). */
+	CLOOP_SCOPE_SIGNAL_EANGLE,
+	/** SVM sector of the requested voltage vector (1...6). */
+	CLOOP_SCOPE_SIGNAL_SECTOR,
+	/** Number of signals. */
+	CLOOP_SCOPE_SIGNAL_COUNT,
+};
+
+/** @brief Current loop scope trigger. */
+enum cloop_scope_trig {
+	/** No trigger, samples are streamed. */
+	CLOOP_SCOPE_TRIG_NONE,
+	/** Signal crosses the level upwards. */
+	CLOOP_SCOPE_TRIG_RISING,
+	/** Signal crosses the level downwards. */
+	CLOOP_SCOPE_TRIG_FALLING,
+	/** Software event (cloop_scope_trigger()). */
+	CLOOP_SCOPE_TRIG_EVENT,
+};
+
+/** @brief Current loop scope state. */
+enum cloop_scope_state {
+	/** Not capturing. */
+	CLOOP_SCOPE_STATE_IDLE,
+	/** Streaming samples (no trigger). */
+	CLOOP_SCOPE_STATE_STREAMING,
+	/** Capturing pre-trigger samples, waiting for the trigger. */
+	CLOOP_SCOPE_STATE_ARMED,
+	/** Capturing post-trigger samples. */
+	CLOOP_SCOPE_STATE_TRIGGERED,
+	/** Capture completed, samples available. */
+	CLOOP_SCOPE_STATE_DONE,
+};
+
+/** @brief Current loop scope configuration. */
+struct cloop_scope_config {
+	/** Captured signals (bit mask of #cloop_scope_signal). */
+	uint32_t signals;
+	/** Decimation (1 captures every regulation cycle). */
+	uint16_t decimation;
+	/** Trigger. */
+	enum cloop_scope_trig trig;
+	/** Trigger signal (rising/falling triggers). */
+	enum cloop_scope_signal trig_signal;
+	/** Trigger level (rising/falling triggers, signal units). */
+	int16_t trig_level;
+	/** Number of samples captured before the trigger. */
+	uint32_t pre;
+	/** Number of samples captured after the trigger (including it). */
+	uint32_t post;
+};
+
+/**
+ * @brief Start a scope capture.
+ *
+ * Samples (selected signals in #cloop_scope_signal order, 16-bit words in
+ * native byte order) are captured from the regulation IRQ into a ring buffer.
+ * Without a trigger, samples are streamed and need to be read continuously
+ * (samples are dropped if the buffer is full, see
+ * cloop_scope_get_overruns()). With a trigger, a single capture of pre + post
+ * samples around the trigger is done, available once the state is
+ * #CLOOP_SCOPE_STATE_DONE.
+ *
+ * @param[in] config Configuration.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If the configuration is not valid (e.g. no signals or pre +
+ * post samples exceed the buffer capacity).
+ */
+int cloop_scope_start(const struct cloop_scope_config *config);
+
+/**
+ * @brief Stop the scope capture.
+ */
+void cloop_scope_stop(void);
+
+/**
+ * @brief Trigger the scope (event trigger).
+ *
+ * @note It can be called from any context.
+ */
+void cloop_scope_trigger(void);
+
+/**
+ * @brief Obtain the scope state.
+ *
+ * @return State.
+ */
+enum cloop_scope_state cloop_scope_get_state(void);
+
+/**
+ * @brief Obtain the number of samples dropped while streaming.
+ *
+ * @return Number of dropped samples.
+ */
+uint32_t cloop_scope_get_overruns(void);
+
+/**
+ * @brief Obtain the size of a sample.
+ *
+ * @return Sample size (bytes), zero if no capture has been started.
+ */
+size_t cloop_scope_get_sample_size(void);
+
+/**
+ * @brief Read captured samples.
+ *
+ * @note Only one reader is allowed.
+ *
+ * @param[out] buf Destination buffer.
+ * @param[in] size Destination buffer size (bytes).
+ *
+ * @return Number of bytes read (whole samples only).
+ */
+size_t cloop_scope_read(void *buf, size_t size);
+
+#endif /* defined(CONFIG_SPINNER_CLOOP_SCOPE) || defined(__DOXYGEN__) */
 
 /** @} */
 
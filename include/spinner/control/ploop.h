@@ -0,0 +1,127 @@
+/**
+ * @file
+ *
+ * Position loop API.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_PLOOP_H_
+#define _SPINNER_LIB_CONTROL_PLOOP_H_
+
+#include <stdbool.h>
+
+#include <spinner/traj/traj.h>
+
+/**
+ * @defgroup spinner_lib_control_ploop Position Loop API
+ * @ingroup spinner_lib_control
+ *
+ * The position loop runs on top of the speed loop, from the regulation IRQ
+ * every CONFIG_SPINNER_PLOOP_DIV speed regulation cycles. Moves to the target
+ * position follow a trajectory (trapezoidal or S-curve) computed
+ * incrementally, whose velocity and acceleration are fed forward to the speed
+ * and current loops, and whose position is tracked with a proportional
+ * controller.
+ *
+ * The position is obtained by unwrapping the feedback electrical angle on
+ * every current regulation cycle, so any feedback device providing the
+ * electrical angle can be used. Positions are given in electrical turns
+ * (relative to the position at the first current regulation cycle).
+ *
+ * @{
+ */
+
+/** @brief Position loop gains. */
+struct ploop_gains {
+	/** Proportional gain (rev/s per turn of error, 1/s). */
+	float kp;
+	/** Acceleration feedforward gain (current per rev/s^2). */
+	float ka;
+};
+
+/**
+ * @brief Start position loop.
+ *
+ * The speed loop reference is driven by the position loop from the next
+ * position regulation cycle, holding the current position until a target is
+ * set.
+ *
+ * @note The speed loop needs to be started (sloop_start()).
+ * @note Must be called from thread context.
+ */
+void ploop_start(void);
+
+/**
+ * @brief Stop position loop.
+ *
+ * The speed loop returns to its own reference (sloop_set_ref()), ramping
+ * from the last position loop speed reference.
+ *
+ * @note Must be called from thread context.
+ */
+void ploop_stop(void);
+
+/**
+ * @brief Set target position.
+ *
+ * A move to the target is started, even if the previous move has not
+ * finished.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] pos Target position (electrical turns).
+ */
+void ploop_set_target(float pos);
+
+/**
+ * @brief Set the trajectory limits.
+ *
+ * Limits are given in electrical turns (rev/s, rev/s^2, rev/s^3).
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] limits Limits.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If limits are not valid, or the S-curve does not fit the
+ * trajectory buffer (see CONFIG_SPINNER_PLOOP_TRAJ_BUF_SIZE).
+ */
+int ploop_set_limits(const struct traj_limits *limits);
+
+/**
+ * @brief Set the position loop gains.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] gains Gains.
+ */
+void ploop_set_gains(const struct ploop_gains *gains);
+
+/**
+ * @brief Obtain the position loop gains.
+ *
+ * @param[out] gains Gains.
+ */
+void ploop_get_gains(struct ploop_gains *gains);
+
+/**
+ * @brief Obtain the current position.
+ *
+ * @note The position is only tracked while the current loop is running.
+ *
+ * @return Position (electrical turns).
+ */
+float ploop_get_position(void);
+
+/**
+ * @brief Check if the last move has been completed.
+ *
+ * @return True if the trajectory has reached the target.
+ */
+bool ploop_is_done(void);
+
+/** @} */
+
+#endif /* _SPINNER_LIB_CONTROL_PLOOP_H_ */
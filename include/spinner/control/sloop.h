@@ -0,0 +1,106 @@
+/**
+ * @file
+ *
+ * Speed loop API.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_SLOOP_H_
+#define _SPINNER_LIB_CONTROL_SLOOP_H_
+
+/**
+ * @defgroup spinner_lib_control_sloop Speed Loop API
+ * @ingroup spinner_lib_control
+ *
+ * The speed loop runs on top of the current loop, from the regulation IRQ
+ * every CONFIG_SPINNER_SLOOP_DIV regulation cycles. It follows the speed
+ * reference using an acceleration ramp, and drives the current loop i_q
+ * reference with a PI controller. Speeds are given in electrical revolutions
+ * per second (see feedback_get_speed()), and currents relative to full-scale.
+ *
+ * @{
+ */
+
+/** @brief Speed loop PI controller gains. */
+struct sloop_gains {
+	/** Proportional gain (current per rev/s). */
+	float kp;
+	/** Integral gain (current per rev/s per second). */
+	float ki;
+};
+
+/**
+ * @brief Start speed loop.
+ *
+ * The current loop i_q reference is driven by the speed loop from the next
+ * speed regulation cycle. The speed ramp starts at the measured speed, and the
+ * PI controller at the current i_q reference (bumpless).
+ *
+ * @note The current loop needs to be started (cloop_start()).
+ * @note Must be called from thread context.
+ */
+void sloop_start(void);
+
+/**
+ * @brief Stop speed loop.
+ *
+ * The current loop returns to its own references (cloop_set_ref()).
+ *
+ * @note Must be called from thread context.
+ */
+void sloop_stop(void);
+
+/**
+ * @brief Set speed reference.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] speed Speed (electrical revolutions per second).
+ */
+void sloop_set_ref(float speed);
+
+/**
+ * @brief Set the speed ramp acceleration.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] accel Acceleration (electrical revolutions per second squared).
+ */
+void sloop_set_accel(float accel);
+
+/**
+ * @brief Set the i_q reference limit.
+ *
+ * The i_q reference is also limited by the current loop amplitude limit
+ * (cloop_set_i_max()), the i_d reference taking priority.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] i_max Maximum i_q current (relative to full-scale, defaults to
+ * 1).
+ */
+void sloop_set_i_max(float i_max);
+
+/**
+ * @brief Set the PI controller gains.
+ *
+ * Controller state is preserved.
+ *
+ * @note Must be called from thread context.
+ *
+ * @param[in] gains Gains.
+ */
+void sloop_set_gains(const struct sloop_gains *gains);
+
+/**
+ * @brief Obtain the PI controller gains.
+ *
+ * @param[out] gains Gains.
+ */
+void sloop_get_gains(struct sloop_gains *gains);
+
+/** @} */
+
+#endif /* _SPINNER_LIB_CONTROL_SLOOP_H_ */
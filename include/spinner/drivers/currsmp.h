@@ -32,6 +32,16 @@ struct currsmp_curr {
 	float i_c;
 };
 
+/** @brief Current sampling currents (Q31). */
+struct currsmp_curr_q31 {
+	/** Phase a current. */
+	int32_t i_a;
+	/** Phase b current. */
+	int32_t i_b;
+	/** Phase c current. */
+	int32_t i_c;
+};
+
 /** @cond INTERNAL_HIDDEN */
 
 struct currsmp_driver_api {
@@ -39,6 +49,10 @@ struct currsmp_driver_api {
 			  currsmp_regulation_cb_t regulation_cb, void *ctx);
 	void (*get_currents)(const struct device *dev,
 			     struct currsmp_curr *curr);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	void (*get_currents_q31)(const struct device *dev,
+				 struct currsmp_curr_q31 *curr);
+#endif
 	void (*set_sector)(const struct device *dev, uint8_t sector);
 	uint32_t (*get_smp_time)(const struct device *dev);
 	void (*start)(const struct device *dev);
@@ -81,6 +95,25 @@ static inline void currsmp_get_currents(const struct device *dev,
 	api->get_currents(dev, curr);
 }
 
+#if defined(CONFIG_SPINNER_DRIVERS_Q31) || defined(__DOXYGEN__)
+/**
+ * @brief Get phase currents (Q31).
+ *
+ * Currents are scaled in the same way as in currsmp_get_currents(), that is,
+ * relative to the sampling full-scale range.
+ *
+ * @param[in] dev Current sampling device.
+ * @param[out] curr Pointer where phase currents will be stored.
+ */
+static inline void currsmp_get_currents_q31(const struct device *dev,
+					    struct currsmp_curr_q31 *curr)
+{
+	const struct currsmp_driver_api *api = dev->api;
+
+	api->get_currents_q31(dev, curr);
+}
+#endif
+
 /**
  * @brief Set SV-PWM sector.
  *
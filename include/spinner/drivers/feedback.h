@@ -19,15 +19,135 @@
  * @{
  */
 
+/**
+ * @brief Feedback estimator inputs.
+ *
+ * Values are normalized as in the current loop, that is, currents are relative
+ * to the current sampling full-scale and voltages to the SV-PWM hexagon vertex
+ * amplitude (2/3 of the DC bus voltage).
+ */
+struct feedback_inputs {
+	/** Alpha current (sampled at the start of the period). */
+	float i_alpha;
+	/** Beta current (sampled at the start of the period). */
+	float i_beta;
+	/** Alpha voltage (applied during the period). */
+	float v_alpha;
+	/** Beta voltage (applied during the period). */
+	float v_beta;
+};
+
+/** @brief Feedback estimator inputs (Q31). */
+struct feedback_inputs_q31 {
+	/** Alpha current (sampled at the start of the period). */
+	int32_t i_alpha;
+	/** Beta current (sampled at the start of the period). */
+	int32_t i_beta;
+	/** Alpha voltage (applied during the period). */
+	int32_t v_alpha;
+	/** Beta voltage (applied during the period). */
+	int32_t v_beta;
+};
+
 /** @cond INTERNAL_HIDDEN */
 
 struct feedback_driver_api {
+	void (*configure)(const struct device *dev, uint32_t freq);
+	void (*update)(const struct device *dev);
+	void (*set_inputs)(const struct device *dev,
+			   const struct feedback_inputs *inputs);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	void (*set_inputs_q31)(const struct device *dev,
+			       const struct feedback_inputs_q31 *inputs);
+#endif
 	float (*get_eangle)(const struct device *dev);
 	float (*get_speed)(const struct device *dev);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	int32_t (*get_eangle_q31)(const struct device *dev);
+#endif
 };
 
 /** @endcond */
 
+/**
+ * @brief Configure the feedback periodic update.
+ *
+ * Drivers running estimators (e.g. an angle tracking PLL) need to know the
+ * rate at which feedback_update() is called.
+ *
+ * @note This function needs to be called before calling feedback_update().
+ *
+ * @param dev Feedback instance.
+ * @param freq Update frequency (Hz).
+ */
+static inline void feedback_configure(const struct device *dev, uint32_t freq)
+{
+	const struct feedback_driver_api *api = dev->api;
+
+	if (api->configure != NULL) {
+		api->configure(dev, freq);
+	}
+}
+
+/**
+ * @brief Update the feedback estimations.
+ *
+ * It needs to be called periodically (e.g. from the regulation loop, before
+ * obtaining the electrical angle), at the frequency given to
+ * feedback_configure().
+ *
+ * @param dev Feedback instance.
+ */
+static inline void feedback_update(const struct device *dev)
+{
+	const struct feedback_driver_api *api = dev->api;
+
+	if (api->update != NULL) {
+		api->update(dev);
+	}
+}
+
+/**
+ * @brief Set estimator inputs.
+ *
+ * Sensorless drivers estimate the angle and speed from the stator currents and
+ * voltages. Inputs need to be provided on every period, before the next call
+ * to feedback_update().
+ *
+ * @param dev Feedback instance.
+ * @param inputs Inputs.
+ */
+static inline void feedback_set_inputs(const struct device *dev,
+				       const struct feedback_inputs *inputs)
+{
+	const struct feedback_driver_api *api = dev->api;
+
+	if (api->set_inputs != NULL) {
+		api->set_inputs(dev, inputs);
+	}
+}
+
+#if defined(CONFIG_SPINNER_DRIVERS_Q31) || defined(__DOXYGEN__)
+/**
+ * @brief Set estimator inputs (Q31).
+ *
+ * @param dev Feedback instance.
+ * @param inputs Inputs (Q31).
+ *
+ * @see feedback_set_inputs()
+ */
+static inline void
+feedback_set_inputs_q31(const struct device *dev,
+			const struct feedback_inputs_q31 *inputs)
+{
+	const struct feedback_driver_api *api = dev->api;
+
+	if (api->set_inputs_q31 != NULL) {
+		api->set_inputs_q31(dev, inputs);
+	}
+}
+#endif
+
 /**
  * @brief Get electrical angle.
  *
@@ -41,11 +161,29 @@ static inline float feedback_get_eangle(const struct device *dev)
 	return api->get_eangle(dev);
 }
 
+#if defined(CONFIG_SPINNER_DRIVERS_Q31) || defined(__DOXYGEN__)
+/**
+ * @brief Get electrical angle (Q31).
+ *
+ * The angle is returned in the format used by the CMSIS-DSP Q31 functions,
+ * that is, [-1, 1) maps to [-180, 180) degrees.
+ *
+ * @param dev Feedback instance.
+ * @return Electrical angle (Q31).
+ */
+static inline int32_t feedback_get_eangle_q31(const struct device *dev)
+{
+	const struct feedback_driver_api *api = dev->api;
+
+	return api->get_eangle_q31(dev);
+}
+#endif
+
 /**
  * @brief Get speed.
  *
  * @param dev Feedback instance.
- * @return Speed.
+ * @return Speed (electrical revolutions per second).
  */
 static inline float feedback_get_speed(const struct device *dev)
 {
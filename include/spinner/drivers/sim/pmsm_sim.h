@@ -0,0 +1,106 @@
+/**
+ * @file
+ *
+ * Simulated PMSM plant.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_DRIVERS_SIM_PMSM_SIM_H_
+#define _SPINNER_DRIVERS_SIM_PMSM_SIM_H_
+
+#include <zephyr/device.h>
+#include <zephyr/types.h>
+
+#include <spinner/sim/pmsm.h>
+
+/**
+ * @defgroup spinner_drivers_sim_pmsm Simulated PMSM plant
+ * @ingroup spinner_drivers
+ *
+ * The plant simulates an ideal inverter driving a PMSM. It is run at the PWM
+ * rate from a kernel timer, so that the following sequence is executed on
+ * each period:
+ *
+ * 1. Plant is integrated using the phase duties set in the previous period.
+ * 2. Regulation callback is called (if sampling is enabled).
+ *
+ * The plant is the backend of the simulated current sampling, SV-PWM and
+ * feedback drivers, but it can also be used directly, e.g. to apply a load
+ * torque or inspect the motor state in tests.
+ *
+ * @{
+ */
+
+/** @brief Simulated PMSM plant callback. */
+typedef void (*pmsm_sim_cb_t)(void *ctx);
+
+/**
+ * @brief Set the callback called on each period.
+ *
+ * @param[in] dev Plant device.
+ * @param[in] cb Callback.
+ * @param[in] ctx Callback context.
+ */
+void pmsm_sim_set_callback(const struct device *dev, pmsm_sim_cb_t cb,
+			   void *ctx);
+
+/**
+ * @brief Enable or disable current sampling (i.e. callback calls).
+ *
+ * @param[in] dev Plant device.
+ * @param[in] enable Enable flag.
+ */
+void pmsm_sim_enable_sampling(const struct device *dev, bool enable);
+
+/**
+ * @brief Enable or disable the inverter.
+ *
+ * When disabled, motor phases are left floating, so stator currents are zero.
+ * Duties are reset to 50% on any change.
+ *
+ * @param[in] dev Plant device.
+ * @param[in] enable Enable flag.
+ */
+void pmsm_sim_enable_inverter(const struct device *dev, bool enable);
+
+/**
+ * @brief Set phase duties (applied on the next period).
+ *
+ * @param[in] dev Plant device.
+ * @param[in] d_a Phase a duty (0..1).
+ * @param[in] d_b Phase b duty (0..1).
+ * @param[in] d_c Phase c duty (0..1).
+ */
+void pmsm_sim_set_duties(const struct device *dev, float d_a, float d_b,
+			 float d_c);
+
+/**
+ * @brief Set motor load torque.
+ *
+ * @param[in] dev Plant device.
+ * @param[in] t_l Load torque (N m).
+ */
+void pmsm_sim_set_load(const struct device *dev, float t_l);
+
+/**
+ * @brief Obtain a snapshot of the motor model.
+ *
+ * @param[in] dev Plant device.
+ * @param[out] pmsm Where the motor model will be copied.
+ */
+void pmsm_sim_get_state(const struct device *dev, struct pmsm *pmsm);
+
+/**
+ * @brief Obtain plant frequency (PWM rate).
+ *
+ * @param[in] dev Plant device.
+ *
+ * @return Frequency (Hz).
+ */
+uint32_t pmsm_sim_get_freq(const struct device *dev);
+
+/** @} */
+
+#endif /* _SPINNER_DRIVERS_SIM_PMSM_SIM_H_ */
@@ -26,6 +26,12 @@ struct svpwm_driver_api {
 	void (*stop)(const struct device *dev);
 	void (*set_phase_voltages)(const struct device *dev, float v_alpha,
 				   float v_beta);
+#ifdef CONFIG_SPINNER_DRIVERS_Q31
+	void (*set_phase_voltages_q31)(const struct device *dev,
+				       int32_t v_alpha, int32_t v_beta);
+#endif
+	float (*get_mod_index)(const struct device *dev);
+	uint32_t (*get_freq)(const struct device *dev);
 };
 
 /** @endcond */
@@ -72,6 +78,58 @@ static inline void svpwm_set_phase_voltages(const struct device *dev,
 	api->set_phase_voltages(dev, v_alpha, v_beta);
 }
 
+#if defined(CONFIG_SPINNER_DRIVERS_Q31) || defined(__DOXYGEN__)
+/**
+ * @brief Set phase voltages (Q31).
+ *
+ * @param[in] dev SV-PWM device.
+ * @param[in] v_alpha Alpha voltage (Q31).
+ * @param[in] v_beta Beta voltage (Q31).
+ */
+static inline void svpwm_set_phase_voltages_q31(const struct device *dev,
+						int32_t v_alpha, int32_t v_beta)
+{
+	const struct svpwm_driver_api *api = dev->api;
+
+	api->set_phase_voltages_q31(dev, v_alpha, v_beta);
+}
+#endif
+
+/**
+ * @brief Obtain the modulation index of the last applied voltages.
+ *
+ * The modulation index is relative to six-step operation. When the requested
+ * voltages exceed what the modulator can apply (see the SVM overmodulation
+ * modes), the modulation index reflects the applied (limited) voltages.
+ *
+ * @param[in] dev SV-PWM device.
+ *
+ * @return Modulation index.
+ */
+static inline float svpwm_get_mod_index(const struct device *dev)
+{
+	const struct svpwm_driver_api *api = dev->api;
+
+	return api->get_mod_index(dev);
+}
+
+/**
+ * @brief Obtain the PWM frequency.
+ *
+ * Phase voltages are updated (and currents sampled) once per PWM period, so
+ * this is also the regulation loop frequency.
+ *
+ * @param[in] dev SV-PWM device.
+ *
+ * @return PWM frequency (Hz).
+ */
+static inline uint32_t svpwm_get_freq(const struct device *dev)
+{
+	const struct svpwm_driver_api *api = dev->api;
+
+	return api->get_freq(dev);
+}
+
 /** @} */
 
 #endif /* _SPINNER_DRIVERS_SVPWM_H_ */
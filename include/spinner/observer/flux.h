@@ -0,0 +1,124 @@
+/**
+ * @file
+ *
+ * Nonlinear flux observer.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_OBSERVER_FLUX_H_
+#define _SPINNER_LIB_OBSERVER_FLUX_H_
+
+#include <spinner/pll/pll.h>
+
+/**
+ * @defgroup spinner_lib_observer_flux Nonlinear flux observer API
+ *
+ * Sensorless rotor angle estimation for surface PMSMs, based on the nonlinear
+ * flux observer by Ortega et al. The observer integrates the stator voltage
+ * equation in the alpha/beta frame,
+ *
+ * x' = v - R i + gamma / 2 * psi * (flux^2 - |psi|^2),  psi = x - L i
+ *
+ * where psi is the estimated permanent magnet flux vector, so that the
+ * correction term drives its magnitude towards the known flux linkage. The
+ * electrical angle is the angle of psi, and the speed is estimated with an
+ * angle tracking PLL (see @ref spinner_lib_pll).
+ *
+ * Each update requires a handful of multiplications and a single atan2(), so
+ * that it can be run from the regulation IRQ. Estimation is not possible at
+ * (or near) standstill, where the back-EMF is too small.
+ *
+ * @{
+ */
+
+/** @brief Flux observer parameters. */
+struct flux_obs_params {
+	/** Stator resistance (Ohm). */
+	float r;
+	/** Stator inductance (H), e.g. (L_d + L_q) / 2. */
+	float l;
+	/** Permanent magnet flux linkage (Wb). */
+	float flux;
+	/**
+	 * Observer gain, normalized to the flux linkage (gamma * flux^2, 1/s).
+	 */
+	float gain;
+	/** Update period (s). */
+	float ts;
+	/** Speed PLL bandwidth (Hz). */
+	float pll_bw;
+};
+
+/** @brief Flux observer state. */
+typedef struct flux_obs {
+	/** Stator resistance (Ohm). */
+	float r;
+	/** Stator inductance (H). */
+	float l;
+	/** Squared flux linkage (Wb^2). */
+	float flux_sq;
+	/** Observer gain (gamma / 2). */
+	float gamma_2;
+	/** Update period (s). */
+	float ts;
+	/** Observer alpha state (Wb). */
+	float x_alpha;
+	/** Observer beta state (Wb). */
+	float x_beta;
+	/** Estimated electrical angle (degrees, [0, 360)). */
+	float theta;
+	/** Speed PLL. */
+	pll_t pll;
+} flux_obs_t;
+
+/**
+ * @brief Initialize flux observer.
+ *
+ * Observer starts at zero angle and speed.
+ *
+ * @param[in] obs Observer instance.
+ * @param[in] params Parameters.
+ */
+void flux_obs_init(flux_obs_t *obs, const struct flux_obs_params *params);
+
+/**
+ * @brief Update observer (one update period).
+ *
+ * @param[in] obs Observer instance.
+ * @param[in] i_alpha Stator alpha current, at the start of the period (A).
+ * @param[in] i_beta Stator beta current, at the start of the period (A).
+ * @param[in] v_alpha Stator alpha voltage applied during the period (V).
+ * @param[in] v_beta Stator beta voltage applied during the period (V).
+ */
+void flux_obs_update(flux_obs_t *obs, float i_alpha, float i_beta,
+		     float v_alpha, float v_beta);
+
+/**
+ * @brief Obtain estimated electrical angle.
+ *
+ * @param[in] obs Observer instance.
+ *
+ * @return Electrical angle (degrees, [0, 360)).
+ */
+static inline float flux_obs_get_eangle(const flux_obs_t *obs)
+{
+	return obs->theta;
+}
+
+/**
+ * @brief Obtain estimated electrical speed.
+ *
+ * @param[in] obs Observer instance.
+ *
+ * @return Speed (electrical revolutions per second).
+ */
+static inline float flux_obs_get_speed(const flux_obs_t *obs)
+{
+	return pll_get_speed(&obs->pll);
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_OBSERVER_FLUX_H_ */
@@ -0,0 +1,475 @@
+/**
+ * @file
+ *
+ * PI controllers (single and d/q axes).
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_PI_PI_H_
+#define _SPINNER_LIB_PI_PI_H_
+
+#include <stdint.h>
+
+#include <arm_math.h>
+
+/**
+ * @defgroup spinner_lib_pi PI controllers API
+ *
+ * Discrete PI controllers with back-calculation anti-windup: a single
+ * controller with a symmetric output limit (e.g. speed regulation), and a pair
+ * of controllers for the d/q axes current regulation, with a circular output
+ * (voltage) limit.
+ *
+ * The d/q output vector is limited to a circle of radius v_max, giving
+ * priority to the d-axis: v_d is limited to v_max, and v_q to the remaining
+ * amplitude, sqrt(v_max^2 - v_d^2). The square root is only computed when the
+ * limit is exceeded. When an output is limited, its integrator is corrected by
+ * the excess scaled by ki / kp (back-calculation with a tracking time equal to
+ * the integral time), so that integrators do not wind up while saturated.
+ *
+ * Controllers are discrete (per sample gains), in parallel form:
+ *
+ *     u[n] = kp * e[n] + i[n - 1] + ki * e[n]
+ *     i[n] = i[n - 1] + ki * e[n] + kaw * (v[n] - u[n])
+ *
+ * where v[n] is the limited output. Coefficients are precomputed, so that they
+ * can be prepared outside of the regulation IRQ (e.g. on gains change).
+ *
+ * @{
+ */
+
+/** @brief PI controller coefficients. */
+struct pi_coeffs {
+	/** Proportional gain. */
+	float kp;
+	/** Integral gain (per sample). */
+	float ki;
+	/** Anti-windup gain. */
+	float kaw;
+};
+
+/** @brief PI controller. */
+typedef struct pi {
+	/** Coefficients. */
+	struct pi_coeffs c;
+	/** Output limit (absolute value). */
+	float limit;
+	/** Integrator. */
+	float i;
+} pi_t;
+
+/**
+ * @brief Compute PI controller coefficients.
+ *
+ * @param[out] c Coefficients.
+ * @param[in] kp Proportional gain.
+ * @param[in] ki Integral gain (per sample).
+ */
+void pi_coeffs_compute(struct pi_coeffs *c, float kp, float ki);
+
+/**
+ * @brief Initialize PI controller.
+ *
+ * Coefficients are initialized to zero.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] limit Output limit (absolute value).
+ */
+void pi_init(pi_t *pi, float limit);
+
+/**
+ * @brief Set PI controller coefficients.
+ *
+ * Integrator is preserved.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] c Coefficients.
+ */
+static inline void pi_set_coeffs(pi_t *pi, const struct pi_coeffs *c)
+{
+	pi->c = *c;
+}
+
+/**
+ * @brief Set PI controller output limit.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] limit Output limit (absolute value).
+ */
+static inline void pi_set_limit(pi_t *pi, float limit)
+{
+	pi->limit = limit;
+}
+
+/**
+ * @brief Reset PI controller integrator.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] i Integrator value (e.g. the current output, for a bumpless
+ * start).
+ */
+static inline void pi_reset(pi_t *pi, float i)
+{
+	pi->i = i;
+}
+
+/**
+ * @brief Run PI controller, with output feedforward.
+ *
+ * Same form as the d/q controllers: the feedforward term is added before the
+ * limit, and the integrator is corrected by the excess scaled by the
+ * anti-windup gain.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] e Error.
+ * @param[in] ff Feedforward.
+ *
+ * @return Output (limited).
+ */
+static inline float pi_run_ff(pi_t *pi, float e, float ff)
+{
+	float i, u, v;
+
+	i = pi->i + pi->c.ki * e;
+	u = pi->c.kp * e + i + ff;
+
+	if (u > pi->limit) {
+		v = pi->limit;
+	} else if (u < -pi->limit) {
+		v = -pi->limit;
+	} else {
+		v = u;
+	}
+
+	pi->i = i + pi->c.kaw * (v - u);
+
+	return v;
+}
+
+/**
+ * @brief Run PI controller.
+ *
+ * @param[in] pi PI controller instance.
+ * @param[in] e Error.
+ *
+ * @return Output (limited).
+ */
+static inline float pi_run(pi_t *pi, float e)
+{
+	return pi_run_ff(pi, e, 0.0f);
+}
+
+/** @brief d/q PI controllers coefficients. */
+struct pi_dq_coeffs {
+	/** d-axis proportional gain. */
+	float kp_d;
+	/** d-axis integral gain (per sample). */
+	float ki_d;
+	/** d-axis anti-windup gain. */
+	float kaw_d;
+	/** q-axis proportional gain. */
+	float kp_q;
+	/** q-axis integral gain (per sample). */
+	float ki_q;
+	/** q-axis anti-windup gain. */
+	float kaw_q;
+};
+
+/** @brief d/q PI controllers. */
+typedef struct pi_dq {
+	/** Coefficients. */
+	struct pi_dq_coeffs c;
+	/** Output limit (vector amplitude). */
+	float v_max;
+	/** d-axis integrator. */
+	float i_d;
+	/** q-axis integrator. */
+	float i_q;
+} pi_dq_t;
+
+/**
+ * @brief Compute d/q PI controllers coefficients.
+ *
+ * @param[out] c Coefficients.
+ * @param[in] kp_d d-axis proportional gain.
+ * @param[in] ki_d d-axis integral gain (per sample).
+ * @param[in] kp_q q-axis proportional gain.
+ * @param[in] ki_q q-axis integral gain (per sample).
+ */
+void pi_dq_coeffs_compute(struct pi_dq_coeffs *c, float kp_d, float ki_d,
+			  float kp_q, float ki_q);
+
+/**
+ * @brief Initialize d/q PI controllers.
+ *
+ * Coefficients are initialized to zero.
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] v_max Output limit (vector amplitude).
+ */
+void pi_dq_init(pi_dq_t *pi, float v_max);
+
+/**
+ * @brief Set d/q PI controllers coefficients.
+ *
+ * Integrators are preserved.
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] c Coefficients.
+ */
+static inline void pi_dq_set_coeffs(pi_dq_t *pi, const struct pi_dq_coeffs *c)
+{
+	pi->c = *c;
+}
+
+/**
+ * @brief Reset d/q PI controllers integrators.
+ *
+ * @param[in] pi PI controllers instance.
+ */
+static inline void pi_dq_reset(pi_dq_t *pi)
+{
+	pi->i_d = 0.0f;
+	pi->i_q = 0.0f;
+}
+
+/**
+ * @brief Run d/q PI controllers, with output feedforward.
+ *
+ * Feedforward terms are added to the controllers output before the limit, so
+ * that the limit (and anti-windup) applies to the total output.
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] e_d d-axis error.
+ * @param[in] e_q q-axis error.
+ * @param[in] ff_d d-axis feedforward.
+ * @param[in] ff_q q-axis feedforward.
+ * @param[out] v_d d-axis output.
+ * @param[out] v_q q-axis output.
+ */
+static inline void pi_dq_run_ff(pi_dq_t *pi, float e_d, float e_q, float ff_d,
+				float ff_q, float *v_d, float *v_q)
+{
+	float i_d, i_q, u_d, u_q, v_q_max_sq;
+
+	/* d-axis (priority) */
+	i_d = pi->i_d + pi->c.ki_d * e_d;
+	u_d = pi->c.kp_d * e_d + i_d + ff_d;
+
+	if (u_d > pi->v_max) {
+		*v_d = pi->v_max;
+	} else if (u_d < -pi->v_max) {
+		*v_d = -pi->v_max;
+	} else {
+		*v_d = u_d;
+	}
+
+	pi->i_d = i_d + pi->c.kaw_d * (*v_d - u_d);
+
+	/* q-axis (remaining amplitude) */
+	i_q = pi->i_q + pi->c.ki_q * e_q;
+	u_q = pi->c.kp_q * e_q + i_q + ff_q;
+
+	v_q_max_sq = pi->v_max * pi->v_max - *v_d * *v_d;
+	if (u_q * u_q > v_q_max_sq) {
+		float v_q_max;
+
+		(void)arm_sqrt_f32(v_q_max_sq, &v_q_max);
+		*v_q = (u_q > 0.0f) ? v_q_max : -v_q_max;
+	} else {
+		*v_q = u_q;
+	}
+
+	pi->i_q = i_q + pi->c.kaw_q * (*v_q - u_q);
+}
+
+/**
+ * @brief Run d/q PI controllers.
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] e_d d-axis error.
+ * @param[in] e_q q-axis error.
+ * @param[out] v_d d-axis output.
+ * @param[out] v_q q-axis output.
+ */
+static inline void pi_dq_run(pi_dq_t *pi, float e_d, float e_q, float *v_d,
+			     float *v_q)
+{
+	pi_dq_run_ff(pi, e_d, e_q, 0.0f, 0.0f, v_d, v_q);
+}
+
+/** @brief d/q PI controllers coefficients (Q31). */
+struct pi_dq_coeffs_q31 {
+	/** d-axis proportional gain (scaled down by the gain shift). */
+	q31_t kp_d;
+	/** d-axis integral gain (per sample, scaled down by the gain shift). */
+	q31_t ki_d;
+	/** d-axis anti-windup gain. */
+	q31_t kaw_d;
+	/** q-axis proportional gain (scaled down by the gain shift). */
+	q31_t kp_q;
+	/** q-axis integral gain (per sample, scaled down by the gain shift). */
+	q31_t ki_q;
+	/** q-axis anti-windup gain. */
+	q31_t kaw_q;
+};
+
+/**
+ * @brief d/q PI controllers (Q31).
+ *
+ * Q31 gains can not exceed 1.0, so proportional and integral gains are scaled
+ * down by 2^shift, and their products scaled up (with saturation)
+ * accordingly.
+ */
+typedef struct pi_dq_q31 {
+	/** Coefficients. */
+	struct pi_dq_coeffs_q31 c;
+	/** Output limit (vector amplitude). */
+	q31_t v_max;
+	/** Gains shift. */
+	uint8_t shift;
+	/** d-axis integrator. */
+	q31_t i_d;
+	/** q-axis integrator. */
+	q31_t i_q;
+} pi_dq_q31_t;
+
+/**
+ * @brief Compute d/q PI controllers coefficients (Q31).
+ *
+ * @param[out] c Coefficients.
+ * @param[in] kp_d d-axis proportional gain.
+ * @param[in] ki_d d-axis integral gain (per sample).
+ * @param[in] kp_q q-axis proportional gain.
+ * @param[in] ki_q q-axis integral gain (per sample).
+ * @param[in] shift Gains shift.
+ *
+ * @see pi_dq_coeffs_compute()
+ */
+void pi_dq_q31_coeffs_compute(struct pi_dq_coeffs_q31 *c, float kp_d,
+			      float ki_d, float kp_q, float ki_q,
+			      uint8_t shift);
+
+/**
+ * @brief Initialize d/q PI controllers (Q31).
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] v_max Output limit (vector amplitude).
+ * @param[in] shift Gains shift.
+ *
+ * @see pi_dq_init()
+ */
+void pi_dq_q31_init(pi_dq_q31_t *pi, q31_t v_max, uint8_t shift);
+
+/**
+ * @brief Set d/q PI controllers coefficients (Q31).
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] c Coefficients.
+ *
+ * @see pi_dq_set_coeffs()
+ */
+static inline void pi_dq_q31_set_coeffs(pi_dq_q31_t *pi,
+					const struct pi_dq_coeffs_q31 *c)
+{
+	pi->c = *c;
+}
+
+/**
+ * @brief Reset d/q PI controllers integrators (Q31).
+ *
+ * @param[in] pi PI controllers instance.
+ */
+static inline void pi_dq_q31_reset(pi_dq_q31_t *pi)
+{
+	pi->i_d = 0;
+	pi->i_q = 0;
+}
+
+/**
+ * @brief Back-calculation anti-windup integrator update (Q31).
+ *
+ * The excess (v - u) is limited to +/-2.0 (Q32), so that its product with the
+ * anti-windup gain does not overflow. A larger excess would push the
+ * integrator to saturation anyway.
+ *
+ * @param[in] i Integrator (including the current sample integral term).
+ * @param[in] kaw Anti-windup gain.
+ * @param[in] v Limited output.
+ * @param[in] u Unlimited output (Q31 scale, 64-bit).
+ *
+ * @return Updated integrator.
+ */
+static inline q31_t pi_q31_back_calc(q31_t i, q31_t kaw, q31_t v, q63_t u)
+{
+	q63_t exc = (q63_t)v - u;
+
+	if (exc > INT32_MAX * 2LL) {
+		exc = INT32_MAX * 2LL;
+	} else if (exc < -INT32_MAX * 2LL) {
+		exc = -INT32_MAX * 2LL;
+	}
+
+	return clip_q63_to_q31((q63_t)i + (((q63_t)kaw * exc) >> 31));
+}
+
+/**
+ * @brief Run d/q PI controllers (Q31).
+ *
+ * Unlimited outputs are kept in 64-bit, so that the back-calculation sees the
+ * actual excess even if the unlimited output exceeds the Q31 range.
+ *
+ * @param[in] pi PI controllers instance.
+ * @param[in] e_d d-axis error.
+ * @param[in] e_q q-axis error.
+ * @param[out] v_d d-axis output.
+ * @param[out] v_q q-axis output.
+ *
+ * @see pi_dq_run()
+ */
+static inline void pi_dq_q31_run(pi_dq_q31_t *pi, q31_t e_d, q31_t e_q,
+				 q31_t *v_d, q31_t *v_q)
+{
+	uint8_t rshift = 31U - pi->shift;
+	q31_t i_d, i_q, u_q_sat;
+	q63_t u_d, u_q, v_q_max_sq;
+
+	/* d-axis (priority) */
+	i_d = clip_q63_to_q31((q63_t)pi->i_d +
+			      (((q63_t)pi->c.ki_d * e_d) >> rshift));
+	u_d = (((q63_t)pi->c.kp_d * e_d) >> rshift) + i_d;
+
+	if (u_d > pi->v_max) {
+		*v_d = pi->v_max;
+	} else if (u_d < -pi->v_max) {
+		*v_d = -pi->v_max;
+	} else {
+		*v_d = (q31_t)u_d;
+	}
+
+	pi->i_d = pi_q31_back_calc(i_d, pi->c.kaw_d, *v_d, u_d);
+
+	/* q-axis (remaining amplitude, squares in Q62) */
+	i_q = clip_q63_to_q31((q63_t)pi->i_q +
+			      (((q63_t)pi->c.ki_q * e_q) >> rshift));
+	u_q = (((q63_t)pi->c.kp_q * e_q) >> rshift) + i_q;
+	u_q_sat = clip_q63_to_q31(u_q);
+
+	v_q_max_sq = (q63_t)pi->v_max * pi->v_max - (q63_t)*v_d * *v_d;
+	if ((q63_t)u_q_sat * u_q_sat > v_q_max_sq) {
+		q31_t v_q_max;
+
+		(void)arm_sqrt_q31((q31_t)(v_q_max_sq >> 31), &v_q_max);
+		*v_q = (u_q > 0) ? v_q_max : -v_q_max;
+	} else {
+		*v_q = u_q_sat;
+	}
+
+	pi->i_q = pi_q31_back_calc(i_q, pi->c.kaw_q, *v_q, u_q);
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_PI_PI_H_ */
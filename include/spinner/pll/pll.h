@@ -0,0 +1,154 @@
+/**
+ * @file
+ *
+ * Angle tracking Phase Locked Loop (PLL).
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_PLL_PLL_H_
+#define _SPINNER_LIB_PLL_PLL_H_
+
+#include <stdint.h>
+
+/**
+ * @defgroup spinner_lib_pll Angle tracking PLL API
+ *
+ * Second order (type 2) angle tracking PLL, fed with discrete position events
+ * (e.g. Hall edges or encoder index/edges) and updated periodically (e.g.
+ * every PWM period). Between events, the measured angle is extrapolated using
+ * the estimated speed, so that the estimation error is only corrected by the
+ * information provided by events. The loop is critically damped, with a
+ * natural frequency given by the configured bandwidth.
+ *
+ * If no events are received for longer than the configured timeout, the
+ * estimated speed is set to zero and the estimated angle to the last event
+ * angle. The next event re-initializes the estimation.
+ *
+ * @note Events and updates must not preempt each other, e.g. events can be
+ * collected by a driver and provided to the PLL right before the update.
+ *
+ * @{
+ */
+
+/** @brief Angle tracking PLL state. */
+typedef struct pll {
+	/** Estimated angle (degrees, [0, 360)). */
+	float theta;
+	/** Estimated speed (degrees per update). */
+	float omega;
+	/** Measured angle, extrapolated since the last event (degrees). */
+	float meas;
+	/** Proportional gain (per update). */
+	float kp;
+	/** Integral gain (per update). */
+	float ki;
+	/** Update period (s). */
+	float ts;
+	/** Timeout (updates). */
+	uint32_t timeout;
+	/** Updates since the last event. */
+	uint32_t elapsed;
+} pll_t;
+
+/**
+ * @brief Initialize PLL.
+ *
+ * Estimation starts in timeout state (zero speed), at angle zero.
+ *
+ * @param[in] pll PLL instance.
+ * @param[in] bw Bandwidth (natural frequency, Hz).
+ * @param[in] ts Update period (s).
+ * @param[in] timeout Maximum time between events (s).
+ */
+void pll_init(pll_t *pll, float bw, float ts, float timeout);
+
+/**
+ * @brief Provide a position event.
+ *
+ * @param[in] pll PLL instance.
+ * @param[in] theta Angle at which the event happened (degrees).
+ */
+void pll_event(pll_t *pll, float theta);
+
+/**
+ * @brief Update estimation (one update period).
+ *
+ * @param[in] pll PLL instance.
+ */
+void pll_update(pll_t *pll);
+
+/**
+ * @brief Obtain estimated speed.
+ *
+ * @param[in] pll PLL instance.
+ *
+ * @return Speed (revolutions per second).
+ */
+float pll_get_speed(const pll_t *pll);
+
+/**
+ * @brief Angle tracking PLL state (Q31).
+ *
+ * Fixed-point counterpart of #pll_t. Angles use the CMSIS-DSP Q31 format,
+ * that is, [-1, 1) maps to [-180, 180) degrees, so that they wrap naturally.
+ */
+typedef struct pll_q31 {
+	/** Estimated angle (Q31). */
+	int32_t theta;
+	/** Estimated speed (Q31 angle per update). */
+	int32_t omega;
+	/** Measured angle, extrapolated since the last event (Q31). */
+	int32_t meas;
+	/** Proportional gain (per update, Q31). */
+	int32_t kp;
+	/** Integral gain (per update, Q31). */
+	int32_t ki;
+	/** Update period (s). */
+	float ts;
+	/** Timeout (updates). */
+	uint32_t timeout;
+	/** Updates since the last event. */
+	uint32_t elapsed;
+} pll_q31_t;
+
+/**
+ * @brief Initialize PLL (Q31).
+ *
+ * @param[in] pll PLL instance.
+ * @param[in] bw Bandwidth (natural frequency, Hz).
+ * @param[in] ts Update period (s).
+ * @param[in] timeout Maximum time between events (s).
+ *
+ * @see pll_init()
+ */
+void pll_q31_init(pll_q31_t *pll, float bw, float ts, float timeout);
+
+/**
+ * @brief Provide a position event (Q31).
+ *
+ * @param[in] pll PLL instance.
+ * @param[in] theta Angle at which the event happened (Q31).
+ */
+void pll_q31_event(pll_q31_t *pll, int32_t theta);
+
+/**
+ * @brief Update estimation (one update period, Q31).
+ *
+ * @param[in] pll PLL instance.
+ */
+void pll_q31_update(pll_q31_t *pll);
+
+/**
+ * @brief Obtain estimated speed (Q31).
+ *
+ * @param[in] pll PLL instance.
+ *
+ * @return Speed (revolutions per second).
+ */
+float pll_q31_get_speed(const pll_q31_t *pll);
+
+/** @} */
+
+#endif /* _SPINNER_LIB_PLL_PLL_H_ */
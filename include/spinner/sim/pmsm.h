@@ -0,0 +1,138 @@
+/**
+ * @file
+ *
+ * PMSM model.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_SIM_PMSM_H_
+#define _SPINNER_LIB_SIM_PMSM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @defgroup spinner_lib_sim_pmsm PMSM model
+ * @ingroup spinner_lib_sim
+ * @{
+ */
+
+/** @brief PMSM parameters. */
+struct pmsm_params {
+	/** Number of pole pairs. */
+	uint8_t pole_pairs;
+	/** Stator resistance (Ohm). */
+	float r;
+	/** d-axis inductance (H). */
+	float l_d;
+	/** q-axis inductance (H). */
+	float l_q;
+	/** Permanent magnet flux linkage (Wb). */
+	float flux;
+	/**
+	 * Rotor inertia (kg m^2). If zero, speed is kept constant (only
+	 * modifiable using pmsm_set_speed()).
+	 */
+	float j;
+	/** Viscous friction coefficient (N m s / rad). */
+	float b;
+};
+
+/** @brief PMSM model. */
+struct pmsm {
+	/** Parameters. */
+	struct pmsm_params params;
+	/** d-axis current (A). */
+	float i_d;
+	/** q-axis current (A). */
+	float i_q;
+	/** Electromagnetic torque (N m). */
+	float t_e;
+	/** Load torque (N m). */
+	float t_l;
+	/** Mechanical speed (rad/s). */
+	float w_m;
+	/** Electrical angle (rad, [0, 2 pi)). */
+	float theta_e;
+};
+
+/**
+ * @brief Initialize PMSM model.
+ *
+ * Model starts at rest, with zero currents and zero electrical angle.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] params PMSM parameters.
+ */
+void pmsm_init(struct pmsm *pmsm, const struct pmsm_params *params);
+
+/**
+ * @brief Run the model for a given time period.
+ *
+ * Voltages are assumed to be constant during the whole period. The electrical
+ * dynamics are integrated using an exact discretization of the d/q RL
+ * circuits (with the speed dependent terms held constant on each sub-step),
+ * the mechanical dynamics using forward Euler.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] v_alpha Stator alpha voltage (V).
+ * @param[in] v_beta Stator beta voltage (V).
+ * @param[in] dt Period (s).
+ */
+void pmsm_step(struct pmsm *pmsm, float v_alpha, float v_beta, float dt);
+
+/**
+ * @brief Disconnect the stator.
+ *
+ * Stator currents are cleared, so that no electromagnetic torque is produced.
+ * Mechanical dynamics are still integrated for the given period.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] dt Period (s).
+ */
+void pmsm_step_open(struct pmsm *pmsm, float dt);
+
+/**
+ * @brief Set load torque.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] t_l Load torque (N m).
+ */
+void pmsm_set_load(struct pmsm *pmsm, float t_l);
+
+/**
+ * @brief Set mechanical speed.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] w_m Mechanical speed (rad/s).
+ */
+void pmsm_set_speed(struct pmsm *pmsm, float w_m);
+
+/**
+ * @brief Obtain phase currents.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[out] i_a Phase a current (A).
+ * @param[out] i_b Phase b current (A).
+ * @param[out] i_c Phase c current (A).
+ */
+void pmsm_get_currents(const struct pmsm *pmsm, float *i_a, float *i_b,
+		       float *i_c);
+
+/**
+ * @brief Obtain the electrical speed.
+ *
+ * @param[in] pmsm PMSM model.
+ *
+ * @return Electrical speed (rad/s).
+ */
+static inline float pmsm_get_espeed(const struct pmsm *pmsm)
+{
+	return pmsm->w_m * (float)pmsm->params.pole_pairs;
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_SIM_PMSM_H_ */
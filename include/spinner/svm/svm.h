@@ -10,6 +10,7 @@
 #ifndef _SPINNER_LIB_SVM_SVM_H_
 #define _SPINNER_LIB_SVM_SVM_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -17,6 +18,47 @@
  * @{
  */
 
+/** @brief SVM overmodulation modes. */
+enum svm_overmod {
+	/** Disabled, vector limited to the linear region (sqrt(3) / 2). */
+	SVM_OVERMOD_NONE,
+	/**
+	 * Mode I, vector limited to the hexagon preserving its angle (up to a
+	 * modulation index of ~0.952).
+	 */
+	SVM_OVERMOD_I,
+	/**
+	 * Mode II, duty cycles clamped (minimum distance to the hexagon), up to
+	 * six-step operation (modulation index 1).
+	 */
+	SVM_OVERMOD_II,
+};
+
+/**
+ * @brief SVM modes (zero-sequence).
+ *
+ * Discontinuous modes clamp one phase to the positive or negative DC bus rail
+ * during 120 degrees of each electrical period, so that switching events are
+ * reduced by a third. The voltage vector (line-to-line voltages) is not
+ * altered.
+ */
+enum svm_mode {
+	/** Continuous (centered active vectors). */
+	SVM_MODE_CONTINUOUS,
+	/** Discontinuous, lowest phase clamped to the negative rail. */
+	SVM_MODE_DPWMMIN,
+	/** Discontinuous, highest phase clamped to the positive rail. */
+	SVM_MODE_DPWMMAX,
+	/** Discontinuous, 60 degrees clamping leading the phase peaks. */
+	SVM_MODE_DPWM0,
+	/** Discontinuous, 60 degrees clamping centered on the phase peaks. */
+	SVM_MODE_DPWM1,
+	/** Discontinuous, 60 degrees clamping lagging the phase peaks. */
+	SVM_MODE_DPWM2,
+	/** Discontinuous, 2 x 30 degrees clamping around the phase peaks. */
+	SVM_MODE_DPWM3,
+};
+
 /** @brief SVM duty cycles. */
 typedef struct {
 	/** A channel duty cycle. */
@@ -37,6 +79,24 @@ typedef struct svm {
 	float d_min;
 	/** Maximum allowed duty cycle. */
 	float d_max;
+	/** Overmodulation mode. */
+	enum svm_overmod overmod;
+	/** Mode (zero-sequence). */
+	enum svm_mode mode;
+	/**
+	 * Maximum duty cycle of the sampled phases (the two lowest) in
+	 * discontinuous modes. If clamping to the positive rail would exceed
+	 * it, the lowest phase is clamped to the negative rail instead.
+	 */
+	float d_smp;
+	/** Dead time, relative to the PWM period (compensation). */
+	float d_dt;
+	/** Dead-time compensation gain (d_dt / current band). */
+	float k_dt;
+	/** Applied v_alpha (after limitation). */
+	float va;
+	/** Applied v_beta (after limitation). */
+	float vb;
 } svm_t;
 
 /**
@@ -55,6 +115,174 @@ void svm_init(svm_t *svm);
  */
 void svm_set(svm_t *svm, float va, float vb);
 
+/**
+ * @brief Obtain the modulation index of the last applied vector.
+ *
+ * The modulation index is the applied vector amplitude relative to the
+ * six-step fundamental (2 / pi of the DC bus voltage), that is, pi / 3 times
+ * the normalized amplitude. The linear region ends at pi / (2 * sqrt(3))
+ * (~0.907). In overmodulation the applied vector follows the hexagon, so the
+ * value fluctuates within an electrical period (up to pi / 3 at the hexagon
+ * vertices). It can be compared against the requested vector to detect a
+ * voltage shortfall.
+ *
+ * @param[in] svm SVM instance.
+ *
+ * @return Modulation index.
+ */
+float svm_get_mod_index(const svm_t *svm);
+
+/**
+ * @brief Obtain the sector of a space vector.
+ *
+ * The vector is classified as in svm_set() (before any overmodulation), e.g.
+ * to trace the sector of a requested vector outside of the SV-PWM device.
+ *
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ *
+ * @return Sector (1...6).
+ */
+uint8_t svm_get_sector(float va, float vb);
+
+/**
+ * @brief Set dead-time compensation parameters.
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] d_dt Dead time, relative to the PWM period (t_dead * f_pwm), zero
+ * to disable compensation.
+ * @param[in] i_band Phase current band (relative to full-scale) where the
+ * compensation is linear with the current, so that it does not chatter around
+ * the current zero crossings.
+ *
+ * @see svm_comp_dead_time()
+ */
+void svm_set_dead_time(svm_t *svm, float d_dt, float i_band);
+
+/**
+ * @brief Compensate dead time in the last computed duty cycles.
+ *
+ * During dead time, the phase voltage is set by the freewheeling diodes, so
+ * that a positive (outgoing) phase current loses d_dt of the commanded duty
+ * cycle, and a negative one gains it. Duty cycles are corrected by d_dt in the
+ * direction of the phase current (linearly within the current band), so that
+ * the average phase voltage matches the commanded one. Phases that do not
+ * switch (clamped to d_min or d_max) are not corrected. Corrected duty cycles
+ * are limited to d_min...d_max.
+ *
+ * @note Must be called after svm_set().
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] i_a Phase a current (relative to full-scale).
+ * @param[in] i_b Phase b current (relative to full-scale).
+ * @param[in] i_c Phase c current (relative to full-scale).
+ */
+void svm_comp_dead_time(svm_t *svm, float i_a, float i_b, float i_c);
+
+/** @brief SVM duty cycles (Q31). */
+typedef struct {
+	/** A channel duty cycle. */
+	int32_t a;
+	/** B channel duty cycle. */
+	int32_t b;
+	/** C channel duty cycle. */
+	int32_t c;
+} svm_duties_q31_t;
+
+/**
+ * @brief SVM state (Q31).
+ *
+ * Fixed-point counterpart of #svm_t. All values are Q31, so that a duty cycle
+ * of 1.0 is represented by INT32_MAX.
+ */
+typedef struct svm_q31 {
+	/** SVM sector. */
+	uint8_t sector;
+	/** Duty cycles. */
+	svm_duties_q31_t duties;
+	/** Minimum allowed duty cycle. */
+	int32_t d_min;
+	/** Maximum allowed duty cycle. */
+	int32_t d_max;
+	/** Overmodulation mode. */
+	enum svm_overmod overmod;
+	/** Mode (zero-sequence). */
+	enum svm_mode mode;
+	/** Maximum duty cycle of the sampled phases (see #svm_t). */
+	int32_t d_smp;
+	/** Dead time, relative to the PWM period (compensation). */
+	int32_t d_dt;
+	/** Dead-time compensation gain (Q24, d_dt / current band). */
+	int32_t k_dt;
+	/** Applied v_alpha (after limitation). */
+	int32_t va;
+	/** Applied v_beta (after limitation). */
+	int32_t vb;
+} svm_q31_t;
+
+/**
+ * @brief Initialize SVM (Q31).
+ *
+ * @param[in] svm SVM instance.
+ */
+void svm_q31_init(svm_q31_t *svm);
+
+/**
+ * @brief Set v_alpha and v_beta (Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] va v_alpha value (Q31).
+ * @param[in] vb v_beta value (Q31).
+ */
+void svm_q31_set(svm_q31_t *svm, int32_t va, int32_t vb);
+
+/**
+ * @brief Obtain the modulation index of the last applied vector (Q31).
+ *
+ * @param[in] svm SVM instance.
+ *
+ * @return Modulation index.
+ *
+ * @see svm_get_mod_index()
+ */
+float svm_q31_get_mod_index(const svm_q31_t *svm);
+
+/**
+ * @brief Obtain the sector of a space vector (Q31).
+ *
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ *
+ * @return Sector (1...6).
+ *
+ * @see svm_get_sector()
+ */
+uint8_t svm_q31_get_sector(int32_t va, int32_t vb);
+
+/**
+ * @brief Set dead-time compensation parameters (Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] d_dt Dead time, relative to the PWM period.
+ * @param[in] i_band Phase current band (relative to full-scale).
+ *
+ * @see svm_set_dead_time()
+ */
+void svm_q31_set_dead_time(svm_q31_t *svm, float d_dt, float i_band);
+
+/**
+ * @brief Compensate dead time in the last computed duty cycles (Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] i_a Phase a current (Q31).
+ * @param[in] i_b Phase b current (Q31).
+ * @param[in] i_c Phase c current (Q31).
+ *
+ * @see svm_comp_dead_time()
+ */
+void svm_q31_comp_dead_time(svm_q31_t *svm, int32_t i_a, int32_t i_b,
+			    int32_t i_c);
+
 /** @} */
 
 #endif /* _SPINNER_LIB_SVM_SVM_H_ */
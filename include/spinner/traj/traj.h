@@ -0,0 +1,195 @@
+/**
+ * @file
+ *
+ * Trajectory generator.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_TRAJ_TRAJ_H_
+#define _SPINNER_LIB_TRAJ_TRAJ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @defgroup spinner_lib_traj Trajectory generator API
+ *
+ * Point to point trajectory generator, computed incrementally (one sample per
+ * update), so that it can run in the control timebase with constant memory.
+ *
+ * A trapezoidal (acceleration limited) profile is generated online: on every
+ * update, the velocity is moved (within the acceleration limit) towards the
+ * maximum velocity that still allows to stop at the target. The target can be
+ * changed at any time, including in the middle of a move.
+ *
+ * If a jerk limit is given, the trapezoidal velocity is smoothed with a moving
+ * average filter of length 2 * a_max / j_max, which results in an S-curve
+ * (jerk limited) profile that keeps the velocity and acceleration limits and
+ * reaches the same target, at the cost of a move time longer by the filter
+ * length. The filter buffer is provided by the caller.
+ *
+ * @{
+ */
+
+/** @brief Trajectory limits. */
+struct traj_limits {
+	/** Maximum velocity (units/s). */
+	float v_max;
+	/** Maximum acceleration (units/s^2). */
+	float a_max;
+	/** Maximum jerk (units/s^3), zero for a trapezoidal profile. */
+	float j_max;
+};
+
+/** @brief Trajectory generator state. */
+typedef struct traj {
+	/** Update period (s). */
+	float ts;
+	/** Maximum velocity (units/s). */
+	float v_max;
+	/** Maximum acceleration (units/s^2). */
+	float a_max;
+	/** Target position. */
+	float target;
+	/** Trapezoidal profile position. */
+	float p;
+	/** Trapezoidal profile velocity. */
+	float v;
+	/** Output position. */
+	float p_out;
+	/** Output velocity. */
+	float v_out;
+	/** Output acceleration. */
+	float a_out;
+	/** Moving average filter buffer (trapezoidal velocities). */
+	float *buf;
+	/** Moving average filter buffer capacity. */
+	size_t buf_size;
+	/** Moving average filter length (1 for trapezoidal). */
+	size_t len;
+	/** Moving average filter next position. */
+	size_t idx;
+	/** Moving average filter sum. */
+	float sum;
+	/** Consecutive updates with the trapezoidal profile at the target. */
+	size_t rest;
+} traj_t;
+
+/**
+ * @brief Initialize trajectory generator.
+ *
+ * The generator starts at rest, at position zero. Limits are zero (no motion)
+ * until set with traj_set_limits().
+ *
+ * @param[in] traj Trajectory generator instance.
+ * @param[in] buf Moving average filter buffer (S-curve, can be NULL if only
+ * trapezoidal profiles are used).
+ * @param[in] buf_size Moving average filter buffer capacity (elements).
+ * @param[in] ts Update period (s).
+ */
+void traj_init(traj_t *traj, float *buf, size_t buf_size, float ts);
+
+/**
+ * @brief Obtain the S-curve filter length for the given limits.
+ *
+ * @param[in] limits Limits.
+ * @param[in] ts Update period (s).
+ *
+ * @return Filter length (elements), 1 for a trapezoidal profile.
+ */
+size_t traj_get_filter_len(const struct traj_limits *limits, float ts);
+
+/**
+ * @brief Set trajectory limits.
+ *
+ * Limits can be changed in the middle of a move.
+ *
+ * @param[in] traj Trajectory generator instance.
+ * @param[in] limits Limits.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL If limits are not valid or the S-curve filter does not fit
+ * the buffer (2 * a_max / (j_max * ts) exceeds the buffer capacity).
+ */
+int traj_set_limits(traj_t *traj, const struct traj_limits *limits);
+
+/**
+ * @brief Reset trajectory generator at rest at the given position.
+ *
+ * @param[in] traj Trajectory generator instance.
+ * @param[in] pos Position.
+ */
+void traj_reset(traj_t *traj, float pos);
+
+/**
+ * @brief Set target position.
+ *
+ * @param[in] traj Trajectory generator instance.
+ * @param[in] target Target position.
+ */
+static inline void traj_set_target(traj_t *traj, float target)
+{
+	traj->target = target;
+}
+
+/**
+ * @brief Update trajectory (one update period).
+ *
+ * @param[in] traj Trajectory generator instance.
+ */
+void traj_update(traj_t *traj);
+
+/**
+ * @brief Check if the trajectory has reached the target (at rest).
+ *
+ * @param[in] traj Trajectory generator instance.
+ *
+ * @return True if the target has been reached.
+ */
+static inline bool traj_done(const traj_t *traj)
+{
+	return (traj->p_out == traj->target) && (traj->v_out == 0.0f);
+}
+
+/**
+ * @brief Obtain trajectory position.
+ *
+ * @param[in] traj Trajectory generator instance.
+ *
+ * @return Position.
+ */
+static inline float traj_get_pos(const traj_t *traj)
+{
+	return traj->p_out;
+}
+
+/**
+ * @brief Obtain trajectory velocity.
+ *
+ * @param[in] traj Trajectory generator instance.
+ *
+ * @return Velocity (units/s).
+ */
+static inline float traj_get_vel(const traj_t *traj)
+{
+	return traj->v_out;
+}
+
+/**
+ * @brief Obtain trajectory acceleration.
+ *
+ * @param[in] traj Trajectory generator instance.
+ *
+ * @return Acceleration (units/s^2).
+ */
+static inline float traj_get_acc(const traj_t *traj)
+{
+	return traj->a_out;
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_TRAJ_TRAJ_H_ */
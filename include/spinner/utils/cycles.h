@@ -0,0 +1,85 @@
+/**
+ * @file
+ *
+ * Cycle counter utilities.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_UTILS_CYCLES_H_
+#define _SPINNER_LIB_UTILS_CYCLES_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/*
+ * DWT cycle counter is not emulated by QEMU, while on native_sim the kernel
+ * cycle counter only advances in simulated time, so the host time stamp
+ * counter is used instead.
+ */
+#if defined(CONFIG_CPU_CORTEX_M_HAS_DWT) && !defined(CONFIG_QEMU_TARGET)
+#define CYCLES_USE_DWT 1
+#include <cmsis_core.h>
+#elif defined(CONFIG_ARCH_POSIX) && (defined(__i386__) || defined(__x86_64__))
+#define CYCLES_USE_TSC 1
+#endif
+
+/**
+ * @defgroup spinner_utils_cycles Cycle counter utilities
+ * @ingroup spinner_lib_utils
+ * @{
+ */
+
+/**
+ * @brief Initialize the cycle counter.
+ *
+ * On Cortex-M SoCs with a DWT unit, the DWT cycle counter (CYCCNT) is enabled.
+ * On native_sim (x86 hosts), the host time stamp counter is used. Otherwise,
+ * the kernel hardware cycle counter is used. The last two need no
+ * initialization.
+ */
+static inline void cycles_init(void)
+{
+#ifdef CYCLES_USE_DWT
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0U;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+/**
+ * @brief Obtain the current cycle counter value.
+ *
+ * @return Cycle counter value.
+ */
+static inline uint32_t cycles_get(void)
+{
+#if defined(CYCLES_USE_DWT)
+	return DWT->CYCCNT;
+#elif defined(CYCLES_USE_TSC)
+	return (uint32_t)__builtin_ia32_rdtsc();
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+/**
+ * @brief Obtain the cycle counter rate.
+ *
+ * @return Cycle counter rate (Hz), zero if unknown (host time stamp counter).
+ */
+static inline uint32_t cycles_get_rate(void)
+{
+#if defined(CYCLES_USE_DWT)
+	return SystemCoreClock;
+#elif defined(CYCLES_USE_TSC)
+	return 0U;
+#else
+	return sys_clock_hw_cycles_per_sec();
+#endif
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_UTILS_CYCLES_H_ */
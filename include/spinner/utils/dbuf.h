@@ -0,0 +1,124 @@
+/**
+ * @file
+ *
+ * Double buffer utilities.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_UTILS_DBUF_H_
+#define _SPINNER_LIB_UTILS_DBUF_H_
+
+#include <string.h>
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/types.h>
+
+/**
+ * @defgroup spinner_utils_dbuf Double buffer utilities
+ * @ingroup spinner_lib_utils
+ *
+ * Wait-free exchange of a data structure between a writer (e.g. a thread) and
+ * a reader that can not be preempted by the writer (e.g. an IRQ on a single
+ * core SoC). The writer prepares the next value in the buffer not in use and
+ * publishes it by incrementing a sequence counter, whose LSB selects the
+ * published buffer. The reader only copies the published buffer when the
+ * sequence counter changes, so neither side ever needs to mask the IRQ.
+ *
+ * @note Concurrent writers must be serialized by the caller.
+ *
+ * @{
+ */
+
+/** @brief Double buffer. */
+struct dbuf {
+	/** Buffers. */
+	void *buf[2];
+	/** Buffer size. */
+	size_t size;
+	/** Sequence counter (LSB selects the published buffer). */
+	atomic_t seq;
+};
+
+/**
+ * @brief Initialize a double buffer.
+ *
+ * Buffer 0 is initially published, so it should contain a valid value.
+ *
+ * @param[in] db Double buffer.
+ * @param[in] buf0 Buffer 0.
+ * @param[in] buf1 Buffer 1.
+ * @param[in] size Size of each buffer.
+ */
+static inline void dbuf_init(struct dbuf *db, void *buf0, void *buf1,
+			     size_t size)
+{
+	db->buf[0] = buf0;
+	db->buf[1] = buf1;
+	db->size = size;
+	atomic_set(&db->seq, 0);
+}
+
+/**
+ * @brief Begin a write.
+ *
+ * The published value is copied to the buffer not in use, so that the writer
+ * can update only part of it.
+ *
+ * @param[in] db Double buffer.
+ *
+ * @return Buffer to be written.
+ *
+ * @see dbuf_write_end()
+ */
+static inline void *dbuf_write_begin(struct dbuf *db)
+{
+	atomic_val_t seq = atomic_get(&db->seq);
+	void *next = db->buf[(seq + 1) & 1];
+
+	memcpy(next, db->buf[seq & 1], db->size);
+
+	return next;
+}
+
+/**
+ * @brief End a write (publish).
+ *
+ * @param[in] db Double buffer.
+ *
+ * @see dbuf_write_begin()
+ */
+static inline void dbuf_write_end(struct dbuf *db)
+{
+	(void)atomic_inc(&db->seq);
+}
+
+/**
+ * @brief Read the published value if it has been updated.
+ *
+ * @param[in] db Double buffer.
+ * @param[out] dst Destination buffer (at least of the buffers size).
+ * @param[in, out] seq Sequence counter of the last read value (initialize to
+ * the double buffer initial sequence, 0, to skip the initial value).
+ *
+ * @retval true If a new value has been copied to @p dst.
+ * @retval false If no new value has been published.
+ */
+static inline bool dbuf_read(struct dbuf *db, void *dst, atomic_val_t *seq)
+{
+	atomic_val_t cur = atomic_get(&db->seq);
+
+	if (cur == *seq) {
+		return false;
+	}
+
+	memcpy(dst, db->buf[cur & 1], db->size);
+	*seq = cur;
+
+	return true;
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_UTILS_DBUF_H_ */
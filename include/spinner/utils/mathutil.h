@@ -0,0 +1,52 @@
+/**
+ * @file
+ *
+ * Math utilities.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_UTILS_MATHUTIL_H_
+#define _SPINNER_LIB_UTILS_MATHUTIL_H_
+
+#include <zephyr/types.h>
+
+/**
+ * @defgroup spinner_utils_mathutil Math utilities
+ * @ingroup spinner_lib_utils
+ * @{
+ */
+
+/** @brief Value 2 * pi. */
+#define TWO_PI 6.283185307179586f
+
+/**
+ * @brief Normalized voltage to DC bus voltage ratio.
+ *
+ * Normalized voltages are relative to the SV-PWM hexagon vertex, i.e.
+ * 2/3 of the DC bus voltage.
+ */
+#define V_NORM_TO_V_BUS (2.0f / 3.0f)
+
+/**
+ * @brief Convert a floating point value to Q31 (with saturation).
+ *
+ * @param[in] x Floating point value.
+ *
+ * @return Q31 value.
+ */
+static inline int32_t f32_to_q31(float x)
+{
+	if (x >= 1.0f) {
+		return INT32_MAX;
+	} else if (x <= -1.0f) {
+		return INT32_MIN;
+	}
+
+	return (int32_t)(x * 2147483648.0f);
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_UTILS_MATHUTIL_H_ */
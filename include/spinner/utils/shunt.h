@@ -0,0 +1,194 @@
+/**
+ * @file
+ *
+ * Shunt current reconstruction utilities.
+ *
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_UTILS_SHUNT_H_
+#define _SPINNER_LIB_UTILS_SHUNT_H_
+
+#include <zephyr/sys/__assert.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+
+/**
+ * @defgroup spinner_utils_shunt Shunt current reconstruction utilities
+ * @ingroup spinner_lib_utils
+ * @{
+ */
+
+/** @brief Shunt offsets (ADC counts). */
+struct shunt_offsets {
+	/** Phase a offset. */
+	uint16_t a;
+	/** Phase b offset. */
+	uint16_t b;
+	/** Phase c offset. */
+	uint16_t c;
+};
+
+/**
+ * @brief Reconstruct phase currents from two shunt samples.
+ *
+ * Only the two phases with the widest low-side conduction time are sampled on
+ * each SV-PWM sector, the third one being reconstructed from Kirchhoff's law.
+ * Sampled phases (rank 1, rank 2) are:
+ *
+ * - Sectors 1, 6: (b, c)
+ * - Sectors 2, 3: (a, c)
+ * - Sectors 4, 5: (b, a)
+ *
+ * Shunt voltage is inverted with respect to the phase current, so currents
+ * are computed as offset minus sample.
+ *
+ * Offsets are given for each rank, as ranks may be sampled by different ADCs
+ * (e.g. simultaneous sampling). Both can point to the same offsets if ranks
+ * are sampled by the same ADC.
+ *
+ * @param[in] sector SV-PWM sector.
+ * @param[in] rank1 Rank 1 sample (ADC counts).
+ * @param[in] rank2 Rank 2 sample (ADC counts).
+ * @param[in] offsets1 Phase offsets (rank 1).
+ * @param[in] offsets2 Phase offsets (rank 2).
+ * @param[out] i_a Phase a current (ADC counts).
+ * @param[out] i_b Phase b current (ADC counts).
+ * @param[out] i_c Phase c current (ADC counts).
+ */
+static inline void shunt_get_currents(uint8_t sector, uint16_t rank1,
+				      uint16_t rank2,
+				      const struct shunt_offsets *offsets1,
+				      const struct shunt_offsets *offsets2,
+				      int16_t *i_a, int16_t *i_b, int16_t *i_c)
+{
+	switch (sector) {
+	case 1U:
+	case 6U:
+		*i_b = (int16_t)(offsets1->b - rank1);
+		*i_c = (int16_t)(offsets2->c - rank2);
+		*i_a = -(*i_b + *i_c);
+		break;
+	case 2U:
+	case 3U:
+		*i_a = (int16_t)(offsets1->a - rank1);
+		*i_c = (int16_t)(offsets2->c - rank2);
+		*i_b = -(*i_a + *i_c);
+		break;
+	case 4U:
+	case 5U:
+		*i_a = (int16_t)(offsets2->a - rank2);
+		*i_b = (int16_t)(offsets1->b - rank1);
+		*i_c = -(*i_a + *i_b);
+		break;
+	default:
+		__ASSERT(NULL, "Unexpected sector");
+		*i_a = 0;
+		*i_b = 0;
+		*i_c = 0;
+		break;
+	}
+}
+
+/**
+ * @brief Reconstruct phase currents from two single (DC-link) shunt samples.
+ *
+ * The sector gives the phases order by duty cycle (max, mid, min):
+ *
+ * - Sector 1: (a, b, c)
+ * - Sector 2: (b, a, c)
+ * - Sector 3: (b, c, a)
+ * - Sector 4: (c, b, a)
+ * - Sector 5: (c, a, b)
+ * - Sector 6: (a, c, b)
+ *
+ * The first sample is taken while only the min phase is connected to the low
+ * side (DC-link current equals -i_min), and the second while only the max
+ * phase is connected to the high side (DC-link current equals i_max). The
+ * third phase is reconstructed from Kirchhoff's law.
+ *
+ * Shunt voltage increases with the DC-link current, so currents are computed
+ * as sample minus offset.
+ *
+ * @param[in] sector Phases order (SV-PWM sector).
+ * @param[in] smp1 First sample (ADC counts).
+ * @param[in] smp2 Second sample (ADC counts).
+ * @param[in] offset Shunt offset (ADC counts).
+ * @param[out] i_a Phase a current (ADC counts).
+ * @param[out] i_b Phase b current (ADC counts).
+ * @param[out] i_c Phase c current (ADC counts).
+ */
+static inline void shunt_single_get_currents(uint8_t sector, uint16_t smp1,
+					     uint16_t smp2, uint16_t offset,
+					     int16_t *i_a, int16_t *i_b,
+					     int16_t *i_c)
+{
+	int16_t i_max, i_mid, i_min;
+
+	i_min = (int16_t)(offset - smp1);
+	i_max = (int16_t)(smp2 - offset);
+	i_mid = -(i_max + i_min);
+
+	switch (sector) {
+	case 1U:
+		*i_a = i_max;
+		*i_b = i_mid;
+		*i_c = i_min;
+		break;
+	case 2U:
+		*i_a = i_mid;
+		*i_b = i_max;
+		*i_c = i_min;
+		break;
+	case 3U:
+		*i_a = i_min;
+		*i_b = i_max;
+		*i_c = i_mid;
+		break;
+	case 4U:
+		*i_a = i_min;
+		*i_b = i_mid;
+		*i_c = i_max;
+		break;
+	case 5U:
+		*i_a = i_mid;
+		*i_b = i_min;
+		*i_c = i_max;
+		break;
+	case 6U:
+		*i_a = i_max;
+		*i_b = i_min;
+		*i_c = i_mid;
+		break;
+	default:
+		__ASSERT(NULL, "Unexpected sector");
+		*i_a = 0;
+		*i_b = 0;
+		*i_c = 0;
+		break;
+	}
+}
+
+/**
+ * @brief Convert a phase current to Q31 (with saturation).
+ *
+ * Currents are relative to the ADC full-scale (2^res counts). Reconstructed
+ * currents (e.g. -(i_a + i_b)) can reach +/-2^res counts, which does not fit
+ * in Q31, so the result is saturated.
+ *
+ * @param[in] i Phase current (ADC counts).
+ * @param[in] res ADC resolution (bits).
+ *
+ * @return Phase current (Q31).
+ */
+static inline int32_t shunt_to_q31(int16_t i, uint8_t res)
+{
+	int64_t q = (int64_t)i * (int64_t)(1ULL << (31U - res));
+
+	return (int32_t)CLAMP(q, INT32_MIN, INT32_MAX);
+}
+
+/** @} */
+
+#endif /* _SPINNER_LIB_UTILS_SHUNT_H_ */
@@ -65,6 +65,32 @@ int stm32_adc_clk_get(ADC_TypeDef *adc, const struct stm32_pclken *pclken,
  */
 int stm32_adc_t_sar_get(uint8_t res_bits, float *t_sar);
 
+/**
+ * Perform a regular (software triggered) ADC read.
+ *
+ * The regular sequencer is configured to convert only the given channel.
+ *
+ * @param[in] adc ADC instance.
+ * @param[in] channel ADC channel.
+ *
+ * @return Sample value.
+ */
+uint16_t stm32_adc_read(ADC_TypeDef *adc, uint32_t channel);
+
+/**
+ * Perform an averaged regular (software triggered) ADC read.
+ *
+ * Useful to calibrate offsets, as noise is reduced by averaging.
+ *
+ * @param[in] adc ADC instance.
+ * @param[in] channel ADC channel.
+ * @param[in] samples Number of samples (at least 1).
+ *
+ * @return Average of the samples (rounded).
+ */
+uint16_t stm32_adc_read_avg(ADC_TypeDef *adc, uint32_t channel,
+			    uint32_t samples);
+
 /** @} */
 
 #endif /* _SPINNER_LIB_UTILS_STM32_ADC_H_ */
@@ -28,6 +28,36 @@
  */
 int stm32_tim_clk_get(const struct stm32_pclken *pclken, uint32_t *tim_clk);
 
+/**
+ * Obtain the dead-time generator setting for a given dead time.
+ *
+ * The dead time is rounded up to the next value that can be generated, using
+ * the lowest clock division (CKD) that allows it.
+ *
+ * @param[in] tim_clk Timer clock (Hz).
+ * @param[in] t_dead Dead time (ns).
+ * @param[out] ckd Clock division (LL_TIM_CLOCKDIVISION_*).
+ * @param[out] dtg Dead-time generator setting (BDTR DTG field).
+ *
+ * @return 0 on success, -EINVAL if the dead time is too long.
+ */
+int stm32_tim_dead_time_get(uint32_t tim_clk, uint32_t t_dead, uint32_t *ckd,
+			    uint8_t *dtg);
+
+/**
+ * Obtain the dead time generated by a given dead-time generator setting.
+ *
+ * This is the inverse of stm32_tim_dead_time_get(), and allows to obtain the
+ * actual dead time after rounding.
+ *
+ * @param[in] tim_clk Timer clock (Hz).
+ * @param[in] ckd Clock division (LL_TIM_CLOCKDIVISION_*).
+ * @param[in] dtg Dead-time generator setting (BDTR DTG field).
+ *
+ * @return Dead time (ns), rounded to the nearest value.
+ */
+uint32_t stm32_tim_dead_time_ns(uint32_t tim_clk, uint32_t ckd, uint8_t dtg);
+
 /** @} */
 
 #endif /* _SPINNER_LIB_UTILS_STM32_TIM_H_ */
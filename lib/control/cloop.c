@@ -3,112 +3,674 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+#include <math.h>
+
 #include <zephyr/device.h>
 #include <zephyr/init.h>
+#include <zephyr/kernel.h>
 
 #include <arm_math.h>
 
+#include <spinner/control/cloop.h>
 #include <spinner/drivers/currsmp.h>
 #include <spinner/drivers/feedback.h>
 #include <spinner/drivers/svpwm.h>
+#include <spinner/pi/pi.h>
+#include <spinner/utils/dbuf.h>
+#include <spinner/utils/mathutil.h>
 
-struct cloop {
-	const struct device *currsmp;
-	const struct device *feedback;
-	const struct device *svpwm;
-	arm_pid_instance_f32 pid_i_q;
-	arm_pid_instance_f32 pid_i_d;
-	float i_q_ref;
-	float i_d_ref;
-};
+#include "cloop_priv.h"
+#include "cloop_scope.h"
+#include "cloop_stats.h"
+#include "ploop_priv.h"
+#include "sloop_priv.h"
+
+/** Minimum PWM frequency to closed loop bandwidth ratio. */
+#define F_PWM_TO_BW_MIN 10.0f
 
-static struct cloop cloop;
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+cloop_t cloop_default;
+
+#if DT_HAS_COMPAT_STATUS_OKAY(teslabs_cloop)
+/** Default instance configuration node. */
+#define CLOOP_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(teslabs_cloop)
+/** Default instance motor node. */
+#define MOTOR_NODE DT_PHANDLE(CLOOP_NODE, motor)
+#endif
+#endif
 
 /**
- * @brief Current regulation callback.
+ * @brief Publish the current settings to the regulation IRQ.
+ *
+ * References are limited to i_max (amplitude). The speed loop i_q reference is
+ * limited to the amplitude left by the i_d reference. PI coefficients and Q31
+ * conversion, if required, are computed here so that the IRQ only needs to
+ * copy the new values.
+ *
+ * @note Must be called with the lock held.
+ *
+ * @param[in] cloop Current loop instance.
+ */
+static void params_publish(cloop_t *cloop)
+{
+	struct cloop_params *params;
+	float i_d_ref, i_q_ref, mod;
+
+	i_d_ref = cloop->i_d_ref;
+	i_q_ref = cloop->i_q_ref;
+
+	(void)arm_sqrt_f32(i_d_ref * i_d_ref + i_q_ref * i_q_ref, &mod);
+	if (mod > cloop->i_max) {
+		i_d_ref = i_d_ref / mod * cloop->i_max;
+		i_q_ref = i_q_ref / mod * cloop->i_max;
+	}
+
+	params = dbuf_write_begin(&cloop->params_dbuf);
+
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	params->i_d_ref = f32_to_q31(i_d_ref);
+	params->i_q_ref = f32_to_q31(i_q_ref);
+	pi_dq_q31_coeffs_compute(&params->coeffs, cloop->gains.f_kp,
+				 cloop->gains.f_ki, cloop->gains.t_kp,
+				 cloop->gains.t_ki,
+				 CONFIG_SPINNER_CLOOP_Q31_GAIN_SHIFT);
+#else
+	params->i_d_ref = i_d_ref;
+	params->i_q_ref = i_q_ref;
+	(void)arm_sqrt_f32(MAX(cloop->i_max * cloop->i_max - i_d_ref * i_d_ref,
+			       0.0f),
+			   &params->i_q_max);
+	pi_dq_coeffs_compute(&params->coeffs, cloop->gains.f_kp,
+			     cloop->gains.f_ki, cloop->gains.t_kp,
+			     cloop->gains.t_ki);
+#ifdef CONFIG_SPINNER_CLOOP_DECOUPLING
+	if (cloop->motor.v_bus > 0.0f) {
+		/* currents and voltages normalized, w = 2 * pi * speed */
+		float v_fs = cloop->motor.v_bus * V_NORM_TO_V_BUS;
+		float k = cloop->motor.i_fs / v_fs;
+
+		params->k_r = k * cloop->motor.r;
+		params->k_l_d = 2.0f * PI * k * cloop->motor.l_d;
+		params->k_l_q = 2.0f * PI * k * cloop->motor.l_q;
+		params->k_flux = 2.0f * PI * cloop->motor.flux / v_fs;
+	} else {
+		params->k_r = 0.0f;
+		params->k_l_d = 0.0f;
+		params->k_l_q = 0.0f;
+		params->k_flux = 0.0f;
+	}
+#endif
+#endif
+
+	dbuf_write_end(&cloop->params_dbuf);
+}
+
+/**
+ * @brief Obtain new parameters, if published.
+ *
+ * PI coefficients are updated only when new parameters are available, keeping
+ * the PI integrators.
+ *
+ * @warning Must be called from the regulation IRQ (or with it stopped).
+ *
+ * @param[in] cloop Current loop instance.
+ */
+static inline void params_update(cloop_t *cloop)
+{
+	if (!dbuf_read(&cloop->params_dbuf, &cloop->params,
+		       &cloop->params_seq)) {
+		return;
+	}
+
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	pi_dq_q31_set_coeffs(&cloop->pi, &cloop->params.coeffs);
+#else
+	pi_dq_set_coeffs(&cloop->pi, &cloop->params.coeffs);
+#endif
+}
+
+/**
+ * @brief Start the regulation profiling (default instance only).
+ *
+ * Statistics, scope and the speed/position loops are only attached to the
+ * default instance, other instances skip them at no cost (@p dflt is constant
+ * on each regulation callback).
+ *
+ * @param[in] dflt Default instance.
+ *
+ * @return Start timestamp.
+ */
+static ALWAYS_INLINE uint32_t stats_begin(bool dflt)
+{
+	return dflt ? cloop_stats_begin() : 0U;
+}
+
+/**
+ * @brief Record a regulation stage (default instance only).
+ *
+ * @param[in] dflt Default instance.
+ * @param[in] stage Stage.
+ * @param[in] start Stage start timestamp.
+ *
+ * @return Stage end timestamp.
+ */
+static ALWAYS_INLINE uint32_t stats_mark(bool dflt,
+					 enum cloop_stats_stage stage,
+					 uint32_t start)
+{
+	return dflt ? cloop_stats_mark(stage, start) : start;
+}
+
+/**
+ * @brief Finish the regulation profiling (default instance only).
+ *
+ * @param[in] dflt Default instance.
+ * @param[in] start Start timestamp.
+ */
+static ALWAYS_INLINE void stats_finish(bool dflt, uint32_t start)
+{
+	if (dflt) {
+		cloop_stats_finish(start);
+	}
+}
+
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+
+/**
+ * @brief Current regulation (Q31).
  *
  * This function is called after current sampling is completed.
  *
  * @warning It is called from the highest priority IRQ.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] dflt Default instance.
  */
-static void regulate(void *ctx)
+static ALWAYS_INLINE void regulate_run(cloop_t *cloop, bool dflt)
+{
+	struct currsmp_curr_q31 curr;
+	q31_t eangle, sin_eangle, cos_eangle;
+	q31_t i_alpha, i_beta;
+	q31_t i_q, i_d;
+	q31_t v_q, v_d;
+	q31_t v_alpha, v_beta;
+	uint32_t t_start, t;
+
+	t_start = stats_begin(dflt);
+
+	params_update(cloop);
+
+	currsmp_get_currents_q31(cloop->currsmp, &curr);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_CURRENTS, t_start);
+
+	feedback_update(cloop->feedback);
+	eangle = feedback_get_eangle_q31(cloop->feedback);
+	arm_sin_cos_q31(eangle, &sin_eangle, &cos_eangle);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_SIN_COS, t);
+
+	/* i_a, i_b -> i_alpha, i_beta */
+	arm_clarke_q31(curr.i_a, curr.i_b, &i_alpha, &i_beta);
+	/* i_alpha, i_beta -> i_q, i_d */
+	arm_park_q31(i_alpha, i_beta, &i_d, &i_q, sin_eangle, cos_eangle);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_PARK, t);
+
+	/* PI (i_d, i_q -> v_d, v_q), limited to v_max */
+	pi_dq_q31_run(&cloop->pi, __QSUB(cloop->params.i_d_ref, i_d),
+		      __QSUB(cloop->params.i_q_ref, i_q), &v_d, &v_q);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_PI, t);
+
+	/* v_q, v_d -> v_alpha, v_beta */
+	arm_inv_park_q31(v_d, v_q, &v_alpha, &v_beta, sin_eangle, cos_eangle);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_INV_PARK, t);
+
+	svpwm_set_phase_voltages_q31(cloop->svpwm, v_alpha, v_beta);
+	feedback_set_inputs_q31(cloop->feedback,
+				&(const struct feedback_inputs_q31){
+					.i_alpha = i_alpha,
+					.i_beta = i_beta,
+					.v_alpha = v_alpha,
+					.v_beta = v_beta,
+				});
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_SVPWM, t);
+
+	if (dflt) {
+		cloop_scope_sample(&(const struct cloop_scope_frame){
+			.i_d = i_d,
+			.i_q = i_q,
+			.v_d = v_d,
+			.v_q = v_q,
+			.v_alpha = v_alpha,
+			.v_beta = v_beta,
+			.eangle = eangle,
+		});
+	}
+	(void)stats_mark(dflt, CLOOP_STATS_STAGE_SCOPE, t);
+
+	stats_finish(dflt, t_start);
+}
+#else
+/**
+ * @brief Compute the decoupling feedforward voltages.
+ *
+ * Cross-coupling terms use the measured currents, so that the plant seen by
+ * the PI controllers is decoupled, and the resistive terms the references.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] i_d_ref i_d reference.
+ * @param[in] i_q_ref i_q reference.
+ * @param[in] i_d Measured i_d.
+ * @param[in] i_q Measured i_q.
+ * @param[out] v_d_ff d-axis feedforward.
+ * @param[out] v_q_ff q-axis feedforward.
+ */
+static inline void decoupling_get(cloop_t *cloop, float i_d_ref,
+				  float i_q_ref, float i_d, float i_q,
+				  float *v_d_ff, float *v_q_ff)
+{
+#ifdef CONFIG_SPINNER_CLOOP_DECOUPLING
+	float speed = feedback_get_speed(cloop->feedback);
+
+	*v_d_ff = cloop->params.k_r * i_d_ref -
+		  speed * cloop->params.k_l_q * i_q;
+	*v_q_ff = cloop->params.k_r * i_q_ref +
+		  speed * (cloop->params.k_l_d * i_d + cloop->params.k_flux);
+#else
+	ARG_UNUSED(cloop);
+	ARG_UNUSED(i_d_ref);
+	ARG_UNUSED(i_q_ref);
+	ARG_UNUSED(i_d);
+	ARG_UNUSED(i_q);
+
+	*v_d_ff = 0.0f;
+	*v_q_ff = 0.0f;
+#endif
+}
+
+/**
+ * @brief Current regulation.
+ *
+ * This function is called after current sampling is completed.
+ *
+ * @warning It is called from the highest priority IRQ.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] dflt Default instance.
+ */
+static ALWAYS_INLINE void regulate_run(cloop_t *cloop, bool dflt)
 {
 	struct currsmp_curr curr;
 	float eangle, sin_eangle, cos_eangle;
 	float i_alpha, i_beta;
 	float i_q, i_d;
+	float i_q_ref;
 	float v_q, v_d;
+	float v_q_ff, v_d_ff;
 	float v_alpha, v_beta;
+	uint32_t t_start, t;
+
+	t_start = stats_begin(dflt);
+
+	params_update(cloop);
 
-	ARG_UNUSED(ctx);
+	currsmp_get_currents(cloop->currsmp, &curr);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_CURRENTS, t_start);
 
-	currsmp_get_currents(cloop.currsmp, &curr);
-	eangle = feedback_get_eangle(cloop.feedback);
+	feedback_update(cloop->feedback);
+	eangle = feedback_get_eangle(cloop->feedback);
+	if (dflt) {
+		ploop_track(eangle);
+	}
 	arm_sin_cos_f32(eangle, &sin_eangle, &cos_eangle);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_SIN_COS, t);
 
 	/* i_a, i_b -> i_alpha, i_beta */
 	arm_clarke_f32(curr.i_a, curr.i_b, &i_alpha, &i_beta);
 	/* i_alpha, i_beta -> i_q, i_d */
 	arm_park_f32(i_alpha, i_beta, &i_d, &i_q, sin_eangle, cos_eangle);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_PARK, t);
 
-	/* PI (i_q, i_d -> v_q, v_d) */
-	v_q = arm_pid_f32(&cloop.pid_i_q, cloop.i_q_ref - i_q);
-	v_d = arm_pid_f32(&cloop.pid_i_d, cloop.i_d_ref - i_d);
+	/* speed loop (decimated), drives i_q_ref if running */
+	i_q_ref = cloop->params.i_q_ref;
+	if (dflt) {
+		sloop_regulate(&i_q_ref, cloop->params.i_q_max);
+	}
+
+	/* decoupling feedforward (cross-coupling and back-EMF) */
+	decoupling_get(cloop, cloop->params.i_d_ref, i_q_ref, i_d, i_q, &v_d_ff,
+		       &v_q_ff);
+
+	/* PI (i_d, i_q -> v_d, v_q) plus feedforward, limited to v_max */
+	pi_dq_run_ff(&cloop->pi, cloop->params.i_d_ref - i_d, i_q_ref - i_q,
+		     v_d_ff, v_q_ff, &v_d, &v_q);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_PI, t);
 
 	/* v_q, v_d -> v_alpha, v_beta */
 	arm_inv_park_f32(v_d, v_q, &v_alpha, &v_beta, sin_eangle, cos_eangle);
-	svpwm_set_phase_voltages(cloop.svpwm, v_alpha, v_beta);
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_INV_PARK, t);
+
+	svpwm_set_phase_voltages(cloop->svpwm, v_alpha, v_beta);
+	feedback_set_inputs(cloop->feedback, &(const struct feedback_inputs){
+						    .i_alpha = i_alpha,
+						    .i_beta = i_beta,
+						    .v_alpha = v_alpha,
+						    .v_beta = v_beta,
+					    });
+	t = stats_mark(dflt, CLOOP_STATS_STAGE_SVPWM, t);
+
+	if (dflt) {
+		cloop_scope_sample(&(const struct cloop_scope_frame){
+			.i_d = i_d,
+			.i_q = i_q,
+			.v_d = v_d,
+			.v_q = v_q,
+			.v_alpha = v_alpha,
+			.v_beta = v_beta,
+			.eangle = eangle,
+		});
+	}
+	(void)stats_mark(dflt, CLOOP_STATS_STAGE_SCOPE, t);
+
+	stats_finish(dflt, t_start);
+}
+#endif /* CONFIG_SPINNER_CLOOP_ARITH_Q31 */
+
+/**
+ * @brief Current regulation callback.
+ *
+ * @param[in] ctx Current loop instance.
+ */
+static void regulate(void *ctx)
+{
+	regulate_run(ctx, false);
 }
 
-static int cloop_init(void)
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+/**
+ * @brief Current regulation callback (default instance).
+ *
+ * @param[in] ctx Current loop instance.
+ */
+static void regulate_default(void *ctx)
 {
-	cloop.currsmp = DEVICE_DT_GET(DT_NODELABEL(currsmp));
-	cloop.svpwm = DEVICE_DT_GET(DT_NODELABEL(svpwm));
-	cloop.feedback = DEVICE_DT_GET(DT_NODELABEL(feedback));
+	regulate_run(ctx, true);
+}
+#endif /* CONFIG_SPINNER_CLOOP_DEFAULT */
 
-	cloop.i_q_ref = 0.0f;
-	cloop.i_d_ref = 0.0f;
+/**
+ * @brief Initialize a current loop instance.
+ *
+ * @param[in] cloop Current loop instance.
+ * @param[in] currsmp Current sampling device.
+ * @param[in] feedback Feedback device.
+ * @param[in] svpwm SV-PWM device.
+ *
+ * @retval 0 On success.
+ * @retval -ENODEV If any of the devices is not ready.
+ */
+static int setup(cloop_t *cloop, const struct device *currsmp,
+		 const struct device *feedback, const struct device *svpwm)
+{
+	if (!device_is_ready(currsmp) || !device_is_ready(feedback) ||
+	    !device_is_ready(svpwm)) {
+		return -ENODEV;
+	}
 
-	cloop.pid_i_q.Kp = CONFIG_SPINNER_CLOOP_T_KP / 1000.0f;
-	cloop.pid_i_q.Ki = CONFIG_SPINNER_CLOOP_T_KI / 1000.0f;
-	cloop.pid_i_q.Kd = 0.0f;
-	arm_pid_init_f32(&cloop.pid_i_q, 1);
+	cloop->currsmp = currsmp;
+	cloop->feedback = feedback;
+	cloop->svpwm = svpwm;
 
-	cloop.pid_i_d.Kp = CONFIG_SPINNER_CLOOP_F_KP / 1000.0f;
-	cloop.pid_i_d.Ki = CONFIG_SPINNER_CLOOP_F_KI / 1000.0f;
-	cloop.pid_i_d.Kd = 0.0f;
-	arm_pid_init_f32(&cloop.pid_i_d, 1);
+	k_mutex_init(&cloop->lock);
 
-	currsmp_configure(cloop.currsmp, regulate, NULL);
+	cloop->i_d_ref = 0.0f;
+	cloop->i_q_ref = 0.0f;
+	cloop->i_max = 1.0f;
+	cloop->gains.t_kp = CONFIG_SPINNER_CLOOP_T_KP / 1000.0f;
+	cloop->gains.t_ki = CONFIG_SPINNER_CLOOP_T_KI / 1000.0f;
+	cloop->gains.f_kp = CONFIG_SPINNER_CLOOP_F_KP / 1000.0f;
+	cloop->gains.f_ki = CONFIG_SPINNER_CLOOP_F_KI / 1000.0f;
+	cloop->motor = (struct cloop_motor){0};
+	cloop->bw = 0.0f;
+
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	pi_dq_q31_init(&cloop->pi,
+		       f32_to_q31(CONFIG_SPINNER_CLOOP_V_MAX / 1000.0f),
+		       CONFIG_SPINNER_CLOOP_Q31_GAIN_SHIFT);
+#else
+	pi_dq_init(&cloop->pi, CONFIG_SPINNER_CLOOP_V_MAX / 1000.0f);
+#endif
+
+	dbuf_init(&cloop->params_dbuf, &cloop->params_buf[0],
+		  &cloop->params_buf[1], sizeof(cloop->params_buf[0]));
+	cloop->params_seq = 0;
+
+	params_publish(cloop);
+	params_update(cloop);
+
+	feedback_configure(cloop->feedback, svpwm_get_freq(cloop->svpwm));
+
+	cloop_attach(cloop);
 
 	return 0;
 }
 
-SYS_INIT(cloop_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+void cloop_attach(cloop_t *cloop)
+{
+	currsmp_regulation_cb_t cb = regulate;
+
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+	if (cloop == &cloop_default) {
+		cb = regulate_default;
+	}
+#endif
+
+	currsmp_configure(cloop->currsmp, cb, cloop);
+}
+
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+static int cloop_default_init(void)
+{
+	int ret;
+
+	cloop_stats_init();
+
+	ret = setup(&cloop_default, DEVICE_DT_GET(DT_NODELABEL(currsmp)),
+		    DEVICE_DT_GET(DT_NODELABEL(feedback)),
+		    DEVICE_DT_GET(DT_NODELABEL(svpwm)));
+	if (ret < 0) {
+		return ret;
+	}
+
+#ifdef CLOOP_NODE
+	ret = cloop_set_motor(
+		&cloop_default,
+		&(const struct cloop_motor){
+			.r = DT_PROP(MOTOR_NODE, resistance_micro_ohms) * 1e-6f,
+			.l_d = DT_PROP(MOTOR_NODE, inductance_d_nano_henries) *
+			       1e-9f,
+			.l_q = DT_PROP(MOTOR_NODE, inductance_q_nano_henries) *
+			       1e-9f,
+			.flux = DT_PROP(MOTOR_NODE, flux_linkage_micro_webers) *
+				1e-6f,
+			.i_fs = DT_PROP(CLOOP_NODE, i_full_scale_milliamps) *
+				1e-3f,
+			.v_bus = DT_PROP(CLOOP_NODE, v_bus_millivolts) * 1e-3f,
+		});
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (DT_PROP(CLOOP_NODE, bandwidth) > 0) {
+		ret = cloop_set_bandwidth(
+			&cloop_default, (float)DT_PROP(CLOOP_NODE, bandwidth));
+	}
+#endif
+
+	return ret;
+}
+
+SYS_INIT(cloop_default_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif /* CONFIG_SPINNER_CLOOP_DEFAULT */
 
 /*******************************************************************************
  * Public
  ******************************************************************************/
 
-void cloop_start(void)
+int cloop_init(cloop_t *cloop, const struct device *currsmp,
+	       const struct device *feedback, const struct device *svpwm)
+{
+	return setup(cloop, currsmp, feedback, svpwm);
+}
+
+void cloop_start(cloop_t *cloop)
 {
-	arm_pid_reset_f32(&cloop.pid_i_q);
-	arm_pid_reset_f32(&cloop.pid_i_d);
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	pi_dq_q31_reset(&cloop->pi);
+#else
+	pi_dq_reset(&cloop->pi);
+#endif
+
+#if defined(CONFIG_SPINNER_CLOOP_DEFAULT) && defined(CONFIG_SPINNER_CLOOP_STATS)
+	if (cloop == &cloop_default) {
+		cloop_stats_reset();
+	}
+#endif
+
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+	if (cloop == &cloop_default) {
+		sloop_reset();
+	}
+#endif
+
+	currsmp_start(cloop->currsmp);
+	svpwm_start(cloop->svpwm);
+}
+
+void cloop_stop(cloop_t *cloop)
+{
+	svpwm_stop(cloop->svpwm);
+	currsmp_stop(cloop->currsmp);
+
+#ifdef CONFIG_SPINNER_CLOOP_DEFAULT
+	if (cloop == &cloop_default) {
+		sloop_reset();
+	}
+#endif
+}
+
+void cloop_set_ref(cloop_t *cloop, float i_d, float i_q)
+{
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+	cloop->i_d_ref = i_d;
+	cloop->i_q_ref = i_q;
+	params_publish(cloop);
+	(void)k_mutex_unlock(&cloop->lock);
+}
+
+void cloop_set_i_max(cloop_t *cloop, float i_max)
+{
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+	cloop->i_max = i_max;
+	params_publish(cloop);
+	(void)k_mutex_unlock(&cloop->lock);
+}
+
+void cloop_set_gains(cloop_t *cloop, const struct cloop_gains *gains)
+{
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+	cloop->gains = *gains;
+	cloop->bw = 0.0f;
+	params_publish(cloop);
+	(void)k_mutex_unlock(&cloop->lock);
+}
+
+void cloop_get_gains(cloop_t *cloop, struct cloop_gains *gains)
+{
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+	*gains = cloop->gains;
+	(void)k_mutex_unlock(&cloop->lock);
+}
+
+int cloop_gains_compute(struct cloop_gains *gains,
+			const struct cloop_motor *motor, float bw,
+			uint32_t f_pwm)
+{
+	float ts, k, r, w, a_d, a_q;
+
+	if ((motor->r <= 0.0f) || (motor->l_d <= 0.0f) ||
+	    (motor->l_q <= 0.0f) || (motor->i_fs <= 0.0f) ||
+	    (motor->v_bus <= 0.0f) || (bw <= 0.0f) ||
+	    (bw * F_PWM_TO_BW_MIN > (float)f_pwm)) {
+		return -EINVAL;
+	}
+
+	ts = 1.0f / (float)f_pwm;
+	k = motor->i_fs / (motor->v_bus * V_NORM_TO_V_BUS);
+	r = k * motor->r;
+
+	/* closed loop pole at exp(-w * Ts), plant poles cancelled */
+	w = 1.0f - expf(-2.0f * PI * bw * ts);
+	a_d = expf(-motor->r * ts / motor->l_d);
+	a_q = expf(-motor->r * ts / motor->l_q);
+
+	gains->t_kp = r * a_q * w / (1.0f - a_q);
+	gains->t_ki = r * w;
+	gains->f_kp = r * a_d * w / (1.0f - a_d);
+	gains->f_ki = r * w;
+
+	return 0;
+}
+
+int cloop_set_bandwidth(cloop_t *cloop, float bw)
+{
+	int ret = 0;
+
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+
+	if (bw > 0.0f) {
+		ret = cloop_gains_compute(&cloop->gains, &cloop->motor, bw,
+					  svpwm_get_freq(cloop->svpwm));
+	}
+
+	if (ret == 0) {
+		cloop->bw = bw;
+		params_publish(cloop);
+	}
+
+	(void)k_mutex_unlock(&cloop->lock);
+
+	return ret;
+}
+
+int cloop_set_motor(cloop_t *cloop, const struct cloop_motor *motor)
+{
+	int ret = 0;
+
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+
+	if (cloop->bw > 0.0f) {
+		ret = cloop_gains_compute(&cloop->gains, motor, cloop->bw,
+					  svpwm_get_freq(cloop->svpwm));
+	}
+
+	if (ret == 0) {
+		cloop->motor = *motor;
+		params_publish(cloop);
+	}
+
+	(void)k_mutex_unlock(&cloop->lock);
 
-	currsmp_start(cloop.currsmp);
-	svpwm_start(cloop.svpwm);
+	return ret;
 }
 
-void cloop_stop(void)
+void cloop_get_motor(cloop_t *cloop, struct cloop_motor *motor)
 {
-	svpwm_stop(cloop.svpwm);
-	currsmp_stop(cloop.currsmp);
+	(void)k_mutex_lock(&cloop->lock, K_FOREVER);
+	*motor = cloop->motor;
+	(void)k_mutex_unlock(&cloop->lock);
 }
 
-void cloop_set_ref(float i_d, float i_q)
+float cloop_get_mod_index(cloop_t *cloop)
 {
-	currsmp_pause(cloop.currsmp);
-	cloop.i_d_ref = i_d;
-	cloop.i_q_ref = i_q;
-	currsmp_resume(cloop.currsmp);
+	return svpwm_get_mod_index(cloop->svpwm);
 }
@@ -0,0 +1,456 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+
+#include <arm_math.h>
+
+#include <spinner/control/cloop.h>
+#include <spinner/drivers/currsmp.h>
+#include <spinner/drivers/svpwm.h>
+#include <spinner/pi/pi.h>
+
+#include "cloop_priv.h"
+
+/** Voltage limit (normalized). */
+#define V_MAX (CONFIG_SPINNER_CLOOP_V_MAX / 1000.0f)
+
+/** Resistance test voltage ramp rate (normalized, per second). */
+#define DC_V_RATE 0.2f
+
+/** Time to settle before averaging (s). */
+#define SETTLE_TIME 0.2f
+
+/** Averaging time (s). */
+#define AVG_TIME 0.1f
+
+/** Inductance test square wave half period (regulation cycles). */
+#define HF_HALF_PERIOD 4U
+
+/** Flux linkage test speed ramp time (s). */
+#define IF_RAMP_TIME 1.0f
+
+/** Flux linkage test PI bandwidth, relative to the PWM frequency. */
+#define IF_BW_RATIO 0.05f
+
+/** Maximum time per test. */
+#define TEST_TIMEOUT K_SECONDS(10)
+
+/** @brief Identification tests. */
+enum ident_test {
+	/** Ramp the alpha voltage until the current reaches i_ref, hold. */
+	IDENT_TEST_DC,
+	/** Square wave voltage on top of the DC voltage (alpha or beta). */
+	IDENT_TEST_HF,
+	/** Rotating current vector (I/f), ramped to the test speed. */
+	IDENT_TEST_IF,
+};
+
+struct ident {
+	const struct device *currsmp;
+	const struct device *svpwm;
+	struct k_sem done;
+	/* regulation period (s) */
+	float ts;
+	/* test settings (set while no test is active) */
+	enum ident_test test;
+	float i_ref;
+	bool beta;
+	float v_hf;
+	float speed;
+	pi_dq_t pi;
+	uint32_t settle;
+	uint32_t count;
+	/* regulation IRQ state */
+	atomic_t active;
+	uint32_t cnt;
+	uint32_t n;
+	bool holding;
+	float v_dc;
+	float i_prev;
+	float s_prev;
+	float speed_ramp;
+	float eangle;
+	float v_alpha;
+	float v_beta;
+	/* test results */
+	int err;
+	float sum_v_d;
+	float sum_v_q;
+	float sum_i_d;
+	float sum_i_q;
+};
+
+/**
+ * @brief Finish the active test.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] err Error (0 on success).
+ */
+static void test_finish(struct ident *id, int err)
+{
+	id->err = err;
+	atomic_set(&id->active, 0);
+	k_sem_give(&id->done);
+}
+
+/**
+ * @brief Resistance test.
+ *
+ * The voltage is ramped until the current reaches the reference, then held.
+ * Voltage and current are averaged once settled.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] i_alpha Measured i_alpha.
+ */
+static void test_dc(struct ident *id, float i_alpha)
+{
+	if (!id->holding) {
+		if (i_alpha >= id->i_ref) {
+			id->holding = true;
+		} else {
+			id->v_dc += DC_V_RATE * id->ts;
+			if (id->v_dc > V_MAX) {
+				id->v_dc = 0.0f;
+				test_finish(id, -EIO);
+			}
+		}
+	} else if (++id->cnt > id->settle) {
+		id->sum_v_d += id->v_dc;
+		id->sum_i_d += i_alpha;
+		if (++id->n == id->count) {
+			test_finish(id, 0);
+		}
+	}
+
+	id->v_alpha = id->v_dc;
+	id->v_beta = 0.0f;
+}
+
+/**
+ * @brief Inductance test.
+ *
+ * The current change on each cycle is accumulated with the sign of the voltage
+ * applied on the previous cycle, as well as the mean current (resistive drop
+ * compensation). The first cycle of each half period is skipped, so that the
+ * result does not depend on whether voltages are applied with one or two
+ * cycles of delay.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] i_alpha Measured i_alpha.
+ * @param[in] i_beta Measured i_beta.
+ */
+static void test_hf(struct ident *id, float i_alpha, float i_beta)
+{
+	float i = id->beta ? i_beta : i_alpha;
+	float s;
+
+	if ((id->cnt > id->settle) &&
+	    (((id->cnt - 1U) % HF_HALF_PERIOD) != 0U)) {
+		id->sum_i_d += id->s_prev * (i - id->i_prev);
+		id->sum_i_q += id->s_prev * 0.5f * (i + id->i_prev);
+		if (++id->n == id->count) {
+			id->v_alpha = id->v_dc;
+			id->v_beta = 0.0f;
+			test_finish(id, 0);
+			return;
+		}
+	}
+
+	s = (((id->cnt / HF_HALF_PERIOD) & 1U) != 0U) ? -1.0f : 1.0f;
+	id->cnt++;
+
+	id->i_prev = i;
+	id->s_prev = s;
+
+	if (id->beta) {
+		id->v_alpha = id->v_dc;
+		id->v_beta = s * id->v_hf;
+	} else {
+		id->v_alpha = id->v_dc + s * id->v_hf;
+		id->v_beta = 0.0f;
+	}
+}
+
+/**
+ * @brief Flux linkage test.
+ *
+ * Currents are regulated in a frame rotating at the ramped speed, aligned with
+ * the current vector. Voltages and currents in this frame are averaged once
+ * the test speed is reached and settled.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] i_alpha Measured i_alpha.
+ * @param[in] i_beta Measured i_beta.
+ */
+static void test_if(struct ident *id, float i_alpha, float i_beta)
+{
+	float sin_eangle, cos_eangle, i_d, i_q, v_d, v_q;
+
+	arm_sin_cos_f32(id->eangle, &sin_eangle, &cos_eangle);
+	arm_park_f32(i_alpha, i_beta, &i_d, &i_q, sin_eangle, cos_eangle);
+
+	pi_dq_run(&id->pi, id->i_ref - i_d, -i_q, &v_d, &v_q);
+
+	if (id->speed_ramp < id->speed) {
+		id->speed_ramp = MIN(id->speed_ramp + id->speed * id->ts /
+							      IF_RAMP_TIME,
+				     id->speed);
+	} else if (++id->cnt > id->settle) {
+		id->sum_v_d += v_d;
+		id->sum_v_q += v_q;
+		id->sum_i_d += i_d;
+		id->sum_i_q += i_q;
+		if (++id->n == id->count) {
+			test_finish(id, 0);
+		}
+	}
+
+	/* voltages are applied on the next cycle, at the next angle */
+	id->eangle += 360.0f * id->speed_ramp * id->ts;
+	if (id->eangle >= 360.0f) {
+		id->eangle -= 360.0f;
+	}
+
+	arm_sin_cos_f32(id->eangle, &sin_eangle, &cos_eangle);
+	arm_inv_park_f32(v_d, v_q, &id->v_alpha, &id->v_beta, sin_eangle,
+			 cos_eangle);
+}
+
+/**
+ * @brief Identification regulation callback.
+ *
+ * Last voltages are held while no test is active.
+ *
+ * @warning It is called from the highest priority IRQ.
+ *
+ * @param[in] ctx Identification instance.
+ */
+static void regulate(void *ctx)
+{
+	struct ident *id = ctx;
+	struct currsmp_curr curr;
+	float i_alpha, i_beta;
+
+	currsmp_get_currents(id->currsmp, &curr);
+	arm_clarke_f32(curr.i_a, curr.i_b, &i_alpha, &i_beta);
+
+	if (atomic_get(&id->active) != 0) {
+		switch (id->test) {
+		case IDENT_TEST_DC:
+			test_dc(id, i_alpha);
+			break;
+		case IDENT_TEST_HF:
+			test_hf(id, i_alpha, i_beta);
+			break;
+		case IDENT_TEST_IF:
+			test_if(id, i_alpha, i_beta);
+			break;
+		default:
+			break;
+		}
+	}
+
+	svpwm_set_phase_voltages(id->svpwm, id->v_alpha, id->v_beta);
+}
+
+/**
+ * @brief Run a test, and wait for it to finish.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] test Test.
+ *
+ * @retval 0 On success.
+ * @retval -EIO If the test failed.
+ * @retval -ETIMEDOUT If the test did not finish in time.
+ */
+static int test_run(struct ident *id, enum ident_test test)
+{
+	id->test = test;
+	id->cnt = 0U;
+	id->n = 0U;
+	id->holding = false;
+	id->err = 0;
+	id->sum_v_d = 0.0f;
+	id->sum_v_q = 0.0f;
+	id->sum_i_d = 0.0f;
+	id->sum_i_q = 0.0f;
+
+	k_sem_reset(&id->done);
+	atomic_set(&id->active, 1);
+
+	if (k_sem_take(&id->done, TEST_TIMEOUT) < 0) {
+		atomic_set(&id->active, 0);
+		return -ETIMEDOUT;
+	}
+
+	return id->err;
+}
+
+/**
+ * @brief Run all tests.
+ *
+ * Resistance and inductances are computed in normalized units (currents
+ * relative to full-scale, voltages to 2/3 of V_bus), and converted at the end.
+ *
+ * @param[in] id Identification instance.
+ * @param[in] config Identification configuration.
+ * @param[out] motor Identified motor parameters.
+ *
+ * @retval 0 On success.
+ * @retval -EIO If any test failed, or results are not valid.
+ * @retval -ETIMEDOUT If any test did not finish in time.
+ */
+static int tests_run(struct ident *id, const struct cloop_ident_config *config,
+		     struct cloop_motor *motor)
+{
+	float v_fs = config->v_bus * V_NORM_TO_V_BUS;
+	float k = v_fs / config->i_fs;
+	float v_1, i_1, v_2, i_2, r, l_d, l_q, w;
+	float v_d, v_q, i_d, i_q, e_d, e_q, e;
+	struct cloop_gains gains;
+	struct pi_dq_coeffs coeffs;
+	int ret;
+
+	/* resistance (two points, offsets cancel out) */
+	id->i_ref = 0.5f * config->i_test;
+	ret = test_run(id, IDENT_TEST_DC);
+	if (ret < 0) {
+		return ret;
+	}
+
+	v_1 = id->sum_v_d / (float)id->n;
+	i_1 = id->sum_i_d / (float)id->n;
+
+	id->i_ref = config->i_test;
+	ret = test_run(id, IDENT_TEST_DC);
+	if (ret < 0) {
+		return ret;
+	}
+
+	v_2 = id->sum_v_d / (float)id->n;
+	i_2 = id->sum_i_d / (float)id->n;
+
+	if ((i_2 <= i_1) || (v_2 <= v_1)) {
+		return -EIO;
+	}
+
+	r = (v_2 - v_1) / (i_2 - i_1);
+
+	/* inductances (L = (v - R * i) * Ts / di, DC terms cancel out) */
+	id->beta = false;
+	ret = test_run(id, IDENT_TEST_HF);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (id->sum_i_d <= 0.0f) {
+		return -EIO;
+	}
+
+	l_d = (id->v_hf * (float)id->n - r * id->sum_i_q) * id->ts /
+	      id->sum_i_d;
+
+	id->beta = true;
+	ret = test_run(id, IDENT_TEST_HF);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (id->sum_i_d <= 0.0f) {
+		return -EIO;
+	}
+
+	l_q = (id->v_hf * (float)id->n - r * id->sum_i_q) * id->ts /
+	      id->sum_i_d;
+
+	motor->r = r * k;
+	motor->l_d = l_d * k;
+	motor->l_q = l_q * k;
+	motor->i_fs = config->i_fs;
+	motor->v_bus = config->v_bus;
+
+	/* flux linkage (back-EMF at the test speed) */
+	ret = cloop_gains_compute(&gains, motor, IF_BW_RATIO / id->ts,
+				  svpwm_get_freq(id->svpwm));
+	if (ret < 0) {
+		return -EIO;
+	}
+
+	pi_dq_init(&id->pi, V_MAX);
+	pi_dq_coeffs_compute(&coeffs, gains.f_kp, gains.f_ki, gains.t_kp,
+			     gains.t_ki);
+	pi_dq_set_coeffs(&id->pi, &coeffs);
+	/* bumpless start from the DC voltage (rotor aligned) */
+	id->pi.i_d = id->v_dc;
+	id->eangle = 0.0f;
+	id->speed_ramp = 0.0f;
+
+	ret = test_run(id, IDENT_TEST_IF);
+	if (ret < 0) {
+		return ret;
+	}
+
+	v_d = id->sum_v_d / (float)id->n;
+	v_q = id->sum_v_q / (float)id->n;
+	i_d = id->sum_i_d / (float)id->n;
+	i_q = id->sum_i_q / (float)id->n;
+
+	/* back-EMF: e = v - R * i - j * w * L * i (w in rev/s, normalized) */
+	w = 2.0f * PI * id->speed;
+	e_d = v_d - r * i_d + w * l_q * i_q;
+	e_q = v_q - r * i_q - w * l_d * i_d;
+	(void)arm_sqrt_f32(e_d * e_d + e_q * e_q, &e);
+
+	motor->flux = e * v_fs / w;
+
+	return 0;
+}
+
+int cloop_ident_run(cloop_t *cloop, const struct cloop_ident_config *config,
+		    struct cloop_motor *motor)
+{
+	struct ident id = {0};
+	int ret;
+
+	if ((config->i_test <= 0.0f) || (config->i_test > 1.0f) ||
+	    (config->v_hf <= 0.0f) || (config->v_hf >= V_MAX / 2.0f) ||
+	    (config->speed <= 0.0f) || (config->i_fs <= 0.0f) ||
+	    (config->v_bus <= 0.0f)) {
+		return -EINVAL;
+	}
+
+	id.currsmp = cloop->currsmp;
+	id.svpwm = cloop->svpwm;
+	id.ts = 1.0f / (float)svpwm_get_freq(cloop->svpwm);
+	id.settle = (uint32_t)(SETTLE_TIME / id.ts);
+	id.count = (uint32_t)(AVG_TIME / id.ts);
+	id.v_hf = config->v_hf;
+	id.speed = config->speed;
+	k_sem_init(&id.done, 0, 1);
+
+	currsmp_configure(cloop->currsmp, regulate, &id);
+	currsmp_start(cloop->currsmp);
+	svpwm_start(cloop->svpwm);
+
+	ret = tests_run(&id, config, motor);
+
+	svpwm_stop(cloop->svpwm);
+	currsmp_stop(cloop->currsmp);
+	cloop_attach(cloop);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (cloop_set_motor(cloop, motor) < 0) {
+		return -EIO;
+	}
+
+	return 0;
+}
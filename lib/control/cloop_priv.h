@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_CLOOP_PRIV_H_
+#define _SPINNER_LIB_CONTROL_CLOOP_PRIV_H_
+
+#include <spinner/control/cloop.h>
+#include <spinner/utils/mathutil.h>
+
+/*
+ * Attach the current loop regulation to its current sampling device, e.g.
+ * after the regulation callback has been taken over (identification).
+ */
+void cloop_attach(cloop_t *cloop);
+
+#endif /* _SPINNER_LIB_CONTROL_CLOOP_PRIV_H_ */
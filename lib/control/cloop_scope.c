@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include <spinner/svm/svm.h>
+
+#include "cloop_scope.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Buffer size (words). */
+#define BUF_WORDS (CONFIG_SPINNER_CLOOP_SCOPE_BUF_SIZE / sizeof(int16_t))
+
+struct cloop_scope_data {
+	/** Configuration. */
+	struct cloop_scope_config config;
+	/** Sample size (words). */
+	uint32_t width;
+	/** Buffer capacity (samples). */
+	uint32_t capacity;
+	/** State. */
+	atomic_t state;
+	/** Event trigger request. */
+	atomic_t event;
+	/** Number of samples written (free-running). */
+	atomic_t head;
+	/** Number of samples read (free-running). */
+	atomic_t tail;
+	/** Write position (samples). */
+	uint32_t head_pos;
+	/** Read position (samples). */
+	uint32_t tail_pos;
+	/** Decimation counter. */
+	uint16_t dec_cnt;
+	/** Post-trigger samples pending. */
+	uint32_t pending;
+	/** Previous trigger signal value. */
+	int16_t trig_prev;
+	/** Dropped samples (streaming). */
+	uint32_t overruns;
+	/** Buffer. */
+	int16_t buf[BUF_WORDS];
+};
+
+static struct cloop_scope_data scope;
+
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+/**
+ * @brief Convert frame values to scope signals (Q31).
+ *
+ * @param[in] frame Frame.
+ * @param[out] vals Signal values.
+ */
+static inline void convert(const struct cloop_scope_frame *frame,
+			   int16_t vals[CLOOP_SCOPE_SIGNAL_COUNT])
+{
+	vals[CLOOP_SCOPE_SIGNAL_I_D] = (int16_t)(frame->i_d >> 16);
+	vals[CLOOP_SCOPE_SIGNAL_I_Q] = (int16_t)(frame->i_q >> 16);
+	vals[CLOOP_SCOPE_SIGNAL_V_D] = (int16_t)(frame->v_d >> 16);
+	vals[CLOOP_SCOPE_SIGNAL_V_Q] = (int16_t)(frame->v_q >> 16);
+	vals[CLOOP_SCOPE_SIGNAL_EANGLE] =
+		(int16_t)(uint16_t)((uint32_t)frame->eangle >> 16);
+	vals[CLOOP_SCOPE_SIGNAL_SECTOR] =
+		(int16_t)svm_q31_get_sector(frame->v_alpha, frame->v_beta);
+}
+#else
+/**
+ * @brief Convert a normalized value to Q15 (with saturation).
+ *
+ * @param[in] x Value.
+ *
+ * @return Q15 value.
+ */
+static inline int16_t f32_to_q15(float x)
+{
+	return (int16_t)CLAMP(x * 32768.0f, -32768.0f, 32767.0f);
+}
+
+/**
+ * @brief Convert frame values to scope signals.
+ *
+ * @param[in] frame Frame.
+ * @param[out] vals Signal values.
+ */
+static inline void convert(const struct cloop_scope_frame *frame,
+			   int16_t vals[CLOOP_SCOPE_SIGNAL_COUNT])
+{
+	vals[CLOOP_SCOPE_SIGNAL_I_D] = f32_to_q15(frame->i_d);
+	vals[CLOOP_SCOPE_SIGNAL_I_Q] = f32_to_q15(frame->i_q);
+	vals[CLOOP_SCOPE_SIGNAL_V_D] = f32_to_q15(frame->v_d);
+	vals[CLOOP_SCOPE_SIGNAL_V_Q] = f32_to_q15(frame->v_q);
+	vals[CLOOP_SCOPE_SIGNAL_EANGLE] =
+		(int16_t)(uint16_t)(int32_t)(frame->eangle *
+					     (65536.0f / 360.0f));
+	vals[CLOOP_SCOPE_SIGNAL_SECTOR] =
+		(int16_t)svm_get_sector(frame->v_alpha, frame->v_beta);
+}
+#endif /* CONFIG_SPINNER_CLOOP_ARITH_Q31 */
+
+/**
+ * @brief Write a sample at the current write position.
+ *
+ * @param[in] vals Signal values.
+ */
+static inline void write(const int16_t vals[CLOOP_SCOPE_SIGNAL_COUNT])
+{
+	int16_t *dst = &scope.buf[scope.head_pos * scope.width];
+	uint32_t signals = scope.config.signals;
+
+	for (size_t i = 0U; i < CLOOP_SCOPE_SIGNAL_COUNT; i++) {
+		if ((signals & BIT(i)) != 0U) {
+			*dst++ = vals[i];
+		}
+	}
+
+	if (++scope.head_pos == scope.capacity) {
+		scope.head_pos = 0U;
+	}
+
+	(void)atomic_inc(&scope.head);
+}
+
+/**
+ * @brief Check if the trigger condition is met.
+ *
+ * @param[in] vals Signal values.
+ *
+ * @return true if triggered, false otherwise.
+ */
+static inline bool triggered(const int16_t vals[CLOOP_SCOPE_SIGNAL_COUNT])
+{
+	int16_t cur = vals[scope.config.trig_signal];
+	int16_t prev = scope.trig_prev;
+	int16_t level = scope.config.trig_level;
+
+	scope.trig_prev = cur;
+
+	switch (scope.config.trig) {
+	case CLOOP_SCOPE_TRIG_RISING:
+		return (prev < level) && (cur >= level);
+	case CLOOP_SCOPE_TRIG_FALLING:
+		return (prev > level) && (cur <= level);
+	case CLOOP_SCOPE_TRIG_EVENT:
+		return atomic_cas(&scope.event, 1, 0);
+	default:
+		return false;
+	}
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+void cloop_scope_sample(const struct cloop_scope_frame *frame)
+{
+	int16_t vals[CLOOP_SCOPE_SIGNAL_COUNT];
+	atomic_val_t state;
+	bool trig;
+
+	state = atomic_get(&scope.state);
+	if ((state == CLOOP_SCOPE_STATE_IDLE) ||
+	    (state == CLOOP_SCOPE_STATE_DONE)) {
+		return;
+	}
+
+	if (++scope.dec_cnt < scope.config.decimation) {
+		return;
+	}
+
+	scope.dec_cnt = 0U;
+
+	convert(frame, vals);
+
+	if (state == CLOOP_SCOPE_STATE_STREAMING) {
+		if ((uint32_t)(atomic_get(&scope.head) -
+			       atomic_get(&scope.tail)) >= scope.capacity) {
+			scope.overruns++;
+			return;
+		}
+
+		write(vals);
+		return;
+	}
+
+	/* single capture: buffer is overwritten until the trigger */
+	write(vals);
+
+	if (state == CLOOP_SCOPE_STATE_ARMED) {
+		trig = triggered(vals);
+		/* pre-trigger samples must be available */
+		if (!trig || ((uint32_t)atomic_get(&scope.head) <=
+			      scope.config.pre)) {
+			return;
+		}
+
+		scope.pending = scope.config.post;
+		state = CLOOP_SCOPE_STATE_TRIGGERED;
+		atomic_set(&scope.state, state);
+	}
+
+	if (--scope.pending == 0U) {
+		uint32_t n = scope.config.pre + scope.config.post;
+
+		scope.tail_pos = (scope.head_pos >= n)
+					 ? (scope.head_pos - n)
+					 : (scope.head_pos + scope.capacity - n);
+		atomic_set(&scope.tail,
+			   atomic_get(&scope.head) - (atomic_val_t)n);
+		atomic_set(&scope.state, CLOOP_SCOPE_STATE_DONE);
+	}
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+int cloop_scope_start(const struct cloop_scope_config *config)
+{
+	uint32_t width;
+
+	width = (uint32_t)__builtin_popcount(config->signals &
+					     BIT_MASK(CLOOP_SCOPE_SIGNAL_COUNT));
+	if ((width == 0U) || (config->decimation == 0U)) {
+		return -EINVAL;
+	}
+
+	if (config->trig != CLOOP_SCOPE_TRIG_NONE) {
+		if ((config->post == 0U) ||
+		    ((config->pre + config->post) > (BUF_WORDS / width)) ||
+		    (config->trig_signal >= CLOOP_SCOPE_SIGNAL_COUNT)) {
+			return -EINVAL;
+		}
+	}
+
+	/* regulation IRQ ignores the scope from now on */
+	atomic_set(&scope.state, CLOOP_SCOPE_STATE_IDLE);
+
+	scope.config = *config;
+	scope.width = width;
+	scope.capacity = BUF_WORDS / width;
+	scope.head_pos = 0U;
+	scope.tail_pos = 0U;
+	scope.dec_cnt = 0U;
+	scope.pending = 0U;
+	scope.trig_prev = config->trig_level;
+	scope.overruns = 0U;
+	atomic_set(&scope.head, 0);
+	atomic_set(&scope.tail, 0);
+	atomic_set(&scope.event, 0);
+
+	if (config->trig == CLOOP_SCOPE_TRIG_NONE) {
+		atomic_set(&scope.state, CLOOP_SCOPE_STATE_STREAMING);
+	} else {
+		atomic_set(&scope.state, CLOOP_SCOPE_STATE_ARMED);
+	}
+
+	return 0;
+}
+
+void cloop_scope_stop(void)
+{
+	atomic_set(&scope.state, CLOOP_SCOPE_STATE_IDLE);
+}
+
+void cloop_scope_trigger(void)
+{
+	atomic_set(&scope.event, 1);
+}
+
+enum cloop_scope_state cloop_scope_get_state(void)
+{
+	return (enum cloop_scope_state)atomic_get(&scope.state);
+}
+
+uint32_t cloop_scope_get_overruns(void)
+{
+	return scope.overruns;
+}
+
+size_t cloop_scope_get_sample_size(void)
+{
+	return scope.width * sizeof(int16_t);
+}
+
+size_t cloop_scope_read(void *buf, size_t size)
+{
+	atomic_val_t state, head, tail;
+	uint32_t n;
+	int16_t *dst = buf;
+
+	state = atomic_get(&scope.state);
+	if ((state != CLOOP_SCOPE_STATE_STREAMING) &&
+	    (state != CLOOP_SCOPE_STATE_DONE)) {
+		return 0U;
+	}
+
+	head = atomic_get(&scope.head);
+	tail = atomic_get(&scope.tail);
+
+	n = MIN((uint32_t)(head - tail),
+		(uint32_t)(size / (scope.width * sizeof(int16_t))));
+
+	for (uint32_t i = 0U; i < n; i++) {
+		memcpy(dst, &scope.buf[scope.tail_pos * scope.width],
+		       scope.width * sizeof(int16_t));
+		dst += scope.width;
+
+		if (++scope.tail_pos == scope.capacity) {
+			scope.tail_pos = 0U;
+		}
+	}
+
+	atomic_set(&scope.tail, tail + (atomic_val_t)n);
+
+	return n * scope.width * sizeof(int16_t);
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_CLOOP_SCOPE_H_
+#define _SPINNER_LIB_CONTROL_CLOOP_SCOPE_H_
+
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+
+#include <arm_math.h>
+
+#include <spinner/control/cloop.h>
+
+/*
+ * Current loop scope hooks, to be used from the regulation callback. When
+ * CONFIG_SPINNER_CLOOP_SCOPE is disabled they are empty and get optimized out.
+ */
+
+/** @brief Regulation cycle values available to the scope. */
+struct cloop_scope_frame {
+#ifdef CONFIG_SPINNER_CLOOP_ARITH_Q31
+	q31_t i_d;
+	q31_t i_q;
+	q31_t v_d;
+	q31_t v_q;
+	q31_t v_alpha;
+	q31_t v_beta;
+	q31_t eangle;
+#else
+	float i_d;
+	float i_q;
+	float v_d;
+	float v_q;
+	float v_alpha;
+	float v_beta;
+	float eangle;
+#endif
+};
+
+#ifdef CONFIG_SPINNER_CLOOP_SCOPE
+
+void cloop_scope_sample(const struct cloop_scope_frame *frame);
+
+#else
+
+static inline void cloop_scope_sample(const struct cloop_scope_frame *frame)
+{
+	ARG_UNUSED(frame);
+}
+
+#endif /* CONFIG_SPINNER_CLOOP_SCOPE */
+
+#endif /* _SPINNER_LIB_CONTROL_CLOOP_SCOPE_H_ */
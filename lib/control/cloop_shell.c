@@ -4,8 +4,10 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/shell/shell.h>
+#include <zephyr/sys/base64.h>
 
 #include <spinner/control/cloop.h>
 
@@ -15,7 +17,7 @@ static int cmd_cloop_start(const struct shell *shell, size_t argc, char **argv)
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-	cloop_start();
+	cloop_start(&cloop_default);
 
 	return 0;
 }
@@ -26,7 +28,7 @@ static int cmd_cloop_stop(const struct shell *shell, size_t argc, char **argv)
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-	cloop_stop();
+	cloop_stop(&cloop_default);
 
 	return 0;
 }
@@ -39,11 +41,385 @@ static int cmd_cloop_set(const struct shell *shell, size_t argc, char **argv)
 	}
 
 	/* NOTE: i_d = 0, assuming PMSM */
-	cloop_set_ref(0.0f, strtof(argv[1], NULL));
+	cloop_set_ref(&cloop_default, 0.0f, strtof(argv[1], NULL));
 
 	return 0;
 }
 
+static int cmd_cloop_imax(const struct shell *shell, size_t argc, char **argv)
+{
+	if (argc != 2) {
+		shell_help(shell);
+		return -EINVAL;
+	}
+
+	cloop_set_i_max(&cloop_default, strtof(argv[1], NULL));
+
+	return 0;
+}
+
+static int cmd_cloop_gains(const struct shell *shell, size_t argc,
+			   char **argv)
+{
+	struct cloop_gains gains;
+
+	if (argc == 1) {
+		cloop_get_gains(&cloop_default, &gains);
+		shell_print(shell, "torque: Kp %f, Ki %f", (double)gains.t_kp,
+			    (double)gains.t_ki);
+		shell_print(shell, "flux: Kp %f, Ki %f", (double)gains.f_kp,
+			    (double)gains.f_ki);
+		return 0;
+	}
+
+	if (argc != 5) {
+		shell_help(shell);
+		return -EINVAL;
+	}
+
+	gains.t_kp = strtof(argv[1], NULL);
+	gains.t_ki = strtof(argv[2], NULL);
+	gains.f_kp = strtof(argv[3], NULL);
+	gains.f_ki = strtof(argv[4], NULL);
+	cloop_set_gains(&cloop_default, &gains);
+
+	return 0;
+}
+
+static int cmd_cloop_bw(const struct shell *shell, size_t argc, char **argv)
+{
+	int ret;
+
+	if (argc != 2) {
+		shell_help(shell);
+		return -EINVAL;
+	}
+
+	ret = cloop_set_bandwidth(&cloop_default, strtof(argv[1], NULL));
+	if (ret < 0) {
+		shell_error(shell, "Bandwidth could not be set (%d)", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_SPINNER_CLOOP_IDENT
+static int cmd_cloop_ident(const struct shell *shell, size_t argc, char **argv)
+{
+	struct cloop_ident_config config;
+	struct cloop_motor motor;
+	int ret;
+
+	if (argc != 6) {
+		shell_help(shell);
+		return -EINVAL;
+	}
+
+	config.i_fs = strtof(argv[1], NULL);
+	config.v_bus = strtof(argv[2], NULL);
+	config.i_test = strtof(argv[3], NULL);
+	config.v_hf = strtof(argv[4], NULL);
+	config.speed = strtof(argv[5], NULL);
+
+	ret = cloop_ident_run(&cloop_default, &config, &motor);
+	if (ret < 0) {
+		shell_error(shell, "Identification failed (%d)", ret);
+		return ret;
+	}
+
+	shell_print(shell, "R: %f Ohm", (double)motor.r);
+	shell_print(shell, "L_d: %f uH, L_q: %f uH", (double)(motor.l_d * 1e6f),
+		    (double)(motor.l_q * 1e6f));
+	shell_print(shell, "flux: %f mWb", (double)(motor.flux * 1e3f));
+
+	return 0;
+}
+#endif /* CONFIG_SPINNER_CLOOP_IDENT */
+
+#ifdef CONFIG_SPINNER_CLOOP_STATS
+static const char *const stage_names[] = {
+	[CLOOP_STATS_STAGE_CURRENTS] = "currents",
+	[CLOOP_STATS_STAGE_SIN_COS] = "sin/cos",
+	[CLOOP_STATS_STAGE_PARK] = "clarke/park",
+	[CLOOP_STATS_STAGE_PI] = "pi",
+	[CLOOP_STATS_STAGE_INV_PARK] = "inv. park",
+	[CLOOP_STATS_STAGE_SVPWM] = "svpwm",
+	[CLOOP_STATS_STAGE_SCOPE] = "scope",
+	[CLOOP_STATS_STAGE_TOTAL] = "total",
+	[CLOOP_STATS_STAGE_PERIOD] = "period",
+};
+
+static int cmd_cloop_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	struct cloop_stats stats[CLOOP_STATS_STAGE_COUNT];
+	uint32_t rate;
+	uint32_t mean;
+
+	if (argc == 2) {
+		if (strcmp(argv[1], "reset") != 0) {
+			shell_help(shell);
+			return -EINVAL;
+		}
+
+		cloop_stats_reset();
+		return 0;
+	}
+
+	for (size_t i = 0U; i < CLOOP_STATS_STAGE_COUNT; i++) {
+		cloop_stats_get(i, &stats[i]);
+	}
+
+	if (stats[CLOOP_STATS_STAGE_TOTAL].count == 0U) {
+		shell_print(shell, "No statistics available");
+		return 0;
+	}
+
+	rate = cloop_stats_get_rate();
+
+	shell_print(shell, "%-12s %8s %8s %8s %10s", "stage", "min", "mean",
+		    "max", "max (ns)");
+
+	for (size_t i = 0U; i < CLOOP_STATS_STAGE_COUNT; i++) {
+		if (stats[i].count == 0U) {
+			continue;
+		}
+
+		mean = (uint32_t)(stats[i].sum / stats[i].count);
+		if (rate == 0U) {
+			shell_print(shell, "%-12s %8u %8u %8u %10s",
+				    stage_names[i], stats[i].min, mean,
+				    stats[i].max, "-");
+			continue;
+		}
+
+		shell_print(shell, "%-12s %8u %8u %8u %10u", stage_names[i],
+			    stats[i].min, mean, stats[i].max,
+			    (uint32_t)(((uint64_t)stats[i].max * 1000000000ULL) /
+				       rate));
+	}
+
+	if (stats[CLOOP_STATS_STAGE_PERIOD].count > 0U) {
+		uint64_t total = stats[CLOOP_STATS_STAGE_TOTAL].sum /
+				 stats[CLOOP_STATS_STAGE_TOTAL].count;
+		uint64_t period = stats[CLOOP_STATS_STAGE_PERIOD].sum /
+				  stats[CLOOP_STATS_STAGE_PERIOD].count;
+
+		shell_print(shell, "\nload: %u %% (mean), %u %% (worst)",
+			    (uint32_t)((total * 100U) / period),
+			    (uint32_t)((stats[CLOOP_STATS_STAGE_TOTAL].max *
+					100ULL) /
+				       stats[CLOOP_STATS_STAGE_PERIOD].min));
+	}
+
+	shell_print(shell, "\nhistogram (bin n: [2^(n-1), 2^n) cycles)");
+	shell_fprintf(shell, SHELL_NORMAL, "%-12s", "stage");
+	for (size_t n = 0U; n < CLOOP_STATS_HIST_BINS; n++) {
+		shell_fprintf(shell, SHELL_NORMAL, " %6u", (unsigned int)n);
+	}
+	shell_fprintf(shell, SHELL_NORMAL, "\n");
+
+	for (size_t i = 0U; i < CLOOP_STATS_STAGE_COUNT; i++) {
+		shell_fprintf(shell, SHELL_NORMAL, "%-12s", stage_names[i]);
+		for (size_t n = 0U; n < CLOOP_STATS_HIST_BINS; n++) {
+			shell_fprintf(shell, SHELL_NORMAL, " %6u",
+				      (unsigned int)stats[i].hist[n]);
+		}
+		shell_fprintf(shell, SHELL_NORMAL, "\n");
+	}
+
+	return 0;
+}
+#endif /* CONFIG_SPINNER_CLOOP_STATS */
+
+#ifdef CONFIG_SPINNER_CLOOP_SCOPE
+/** Scope read chunk size (multiple of any sample size). */
+#define SCOPE_CHUNK_SIZE 120U
+
+static const char *const scope_signal_names[] = {
+	[CLOOP_SCOPE_SIGNAL_I_D] = "id",
+	[CLOOP_SCOPE_SIGNAL_I_Q] = "iq",
+	[CLOOP_SCOPE_SIGNAL_V_D] = "vd",
+	[CLOOP_SCOPE_SIGNAL_V_Q] = "vq",
+	[CLOOP_SCOPE_SIGNAL_EANGLE] = "angle",
+	[CLOOP_SCOPE_SIGNAL_SECTOR] = "sector",
+};
+
+static const char *const scope_trig_names[] = {
+	[CLOOP_SCOPE_TRIG_NONE] = "none",
+	[CLOOP_SCOPE_TRIG_RISING] = "rising",
+	[CLOOP_SCOPE_TRIG_FALLING] = "falling",
+	[CLOOP_SCOPE_TRIG_EVENT] = "event",
+};
+
+static const char *const scope_state_names[] = {
+	[CLOOP_SCOPE_STATE_IDLE] = "idle",
+	[CLOOP_SCOPE_STATE_STREAMING] = "streaming",
+	[CLOOP_SCOPE_STATE_ARMED] = "armed",
+	[CLOOP_SCOPE_STATE_TRIGGERED] = "triggered",
+	[CLOOP_SCOPE_STATE_DONE] = "done",
+};
+
+static int scope_find(const char *const *names, size_t len, const char *name)
+{
+	for (size_t i = 0U; i < len; i++) {
+		if (strcmp(names[i], name) == 0) {
+			return (int)i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int cmd_cloop_scope_start(const struct shell *shell, size_t argc,
+				 char **argv)
+{
+	struct cloop_scope_config config = {
+		.decimation = 1U,
+		.trig = CLOOP_SCOPE_TRIG_NONE,
+	};
+	char *signal, *save;
+	int ret;
+
+	for (signal = strtok_r(argv[1], ",", &save); signal != NULL;
+	     signal = strtok_r(NULL, ",", &save)) {
+		ret = scope_find(scope_signal_names,
+				 ARRAY_SIZE(scope_signal_names), signal);
+		if (ret < 0) {
+			shell_error(shell, "Unknown signal: %s", signal);
+			return -EINVAL;
+		}
+
+		config.signals |= BIT(ret);
+	}
+
+	if (argc > 2) {
+		config.decimation = (uint16_t)strtoul(argv[2], NULL, 10);
+	}
+
+	if (argc > 3) {
+		if (argc < 6) {
+			shell_help(shell);
+			return -EINVAL;
+		}
+
+		ret = scope_find(scope_trig_names, ARRAY_SIZE(scope_trig_names),
+				 argv[3]);
+		if (ret < 0) {
+			shell_error(shell, "Unknown trigger: %s", argv[3]);
+			return -EINVAL;
+		}
+
+		config.trig = (enum cloop_scope_trig)ret;
+		config.pre = strtoul(argv[4], NULL, 10);
+		config.post = strtoul(argv[5], NULL, 10);
+	}
+
+	if ((config.trig == CLOOP_SCOPE_TRIG_RISING) ||
+	    (config.trig == CLOOP_SCOPE_TRIG_FALLING)) {
+		if (argc != 8) {
+			shell_help(shell);
+			return -EINVAL;
+		}
+
+		ret = scope_find(scope_signal_names,
+				 ARRAY_SIZE(scope_signal_names), argv[6]);
+		if (ret < 0) {
+			shell_error(shell, "Unknown signal: %s", argv[6]);
+			return -EINVAL;
+		}
+
+		config.trig_signal = (enum cloop_scope_signal)ret;
+		config.trig_level = (int16_t)strtol(argv[7], NULL, 10);
+	}
+
+	ret = cloop_scope_start(&config);
+	if (ret < 0) {
+		shell_error(shell, "Invalid configuration (%d)", ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+static int cmd_cloop_scope_stop(const struct shell *shell, size_t argc,
+				char **argv)
+{
+	ARG_UNUSED(shell);
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	cloop_scope_stop();
+
+	return 0;
+}
+
+static int cmd_cloop_scope_trigger(const struct shell *shell, size_t argc,
+				   char **argv)
+{
+	ARG_UNUSED(shell);
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	cloop_scope_trigger();
+
+	return 0;
+}
+
+static int cmd_cloop_scope_status(const struct shell *shell, size_t argc,
+				  char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	shell_print(shell, "state: %s",
+		    scope_state_names[cloop_scope_get_state()]);
+	shell_print(shell, "sample size: %u",
+		    (uint32_t)cloop_scope_get_sample_size());
+	shell_print(shell, "overruns: %u", cloop_scope_get_overruns());
+
+	return 0;
+}
+
+static int cmd_cloop_scope_read(const struct shell *shell, size_t argc,
+				char **argv)
+{
+	uint8_t buf[SCOPE_CHUNK_SIZE];
+	char line[((SCOPE_CHUNK_SIZE + 2U) / 3U) * 4U + 1U];
+	size_t len, olen;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	while ((len = cloop_scope_read(buf, sizeof(buf))) > 0U) {
+		(void)base64_encode(line, sizeof(line), &olen, buf, len);
+		shell_print(shell, "%s", line);
+	}
+
+	shell_print(shell, "end");
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+	sub_cloop_scope,
+	SHELL_CMD_ARG(start, NULL,
+		      "Start capture\n"
+		      "Usage: start <signal>[,<signal>...] [<decimation> "
+		      "[<trig> <pre> <post> [<trig signal> <level>]]]\n"
+		      "Signals: id, iq, vd, vq, angle, sector\n"
+		      "Triggers: none, rising, falling, event",
+		      cmd_cloop_scope_start, 2, 6),
+	SHELL_CMD(stop, NULL, "Stop capture", cmd_cloop_scope_stop),
+	SHELL_CMD(trigger, NULL, "Trigger capture (event)",
+		  cmd_cloop_scope_trigger),
+	SHELL_CMD(status, NULL, "Show capture status", cmd_cloop_scope_status),
+	SHELL_CMD(read, NULL,
+		  "Read captured samples (base64, 16-bit native endian words)",
+		  cmd_cloop_scope_read),
+	SHELL_SUBCMD_SET_END);
+#endif /* CONFIG_SPINNER_CLOOP_SCOPE */
+
 SHELL_STATIC_SUBCMD_SET_CREATE(
 	sub_cloop,
 	SHELL_CMD(start, NULL, "Start current regulation loop",
@@ -51,6 +427,31 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 	SHELL_CMD(stop, NULL, "Stop current regulation loop", cmd_cloop_stop),
 	SHELL_CMD(set, NULL, "Set current regulation loop target",
 		  cmd_cloop_set),
+	SHELL_CMD_ARG(imax, NULL,
+		      "Set current references amplitude limit\n"
+		      "Usage: imax <i_max>",
+		      cmd_cloop_imax, 2, 0),
+	SHELL_CMD_ARG(gains, NULL,
+		      "Show or set PI controllers gains\n"
+		      "Usage: gains [<t_kp> <t_ki> <f_kp> <f_ki>]",
+		      cmd_cloop_gains, 1, 4),
+	SHELL_CMD_ARG(bw, NULL,
+		      "Compute PI controllers gains from motor parameters\n"
+		      "Usage: bw <bandwidth (Hz), 0 to keep gains>",
+		      cmd_cloop_bw, 2, 0),
+	IF_ENABLED(CONFIG_SPINNER_CLOOP_IDENT,
+		   (SHELL_CMD_ARG(ident, NULL,
+				  "Identify motor parameters (loop stopped)\n"
+				  "Usage: ident <i_fs> <v_bus> <i_test> "
+				  "<v_hf> <speed>",
+				  cmd_cloop_ident, 6, 0),))
+	IF_ENABLED(CONFIG_SPINNER_CLOOP_STATS,
+		   (SHELL_CMD_ARG(stats, NULL,
+				  "Show current loop profiling statistics\n"
+				  "Usage: stats [reset]",
+				  cmd_cloop_stats, 1, 1),))
+	IF_ENABLED(CONFIG_SPINNER_CLOOP_SCOPE,
+		   (SHELL_CMD(scope, &sub_cloop_scope, "Current loop scope"),))
 	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(cloop, &sub_cloop, "Current Loop Control", NULL);
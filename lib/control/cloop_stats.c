@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/sys/__assert.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+#include "cloop_stats.h"
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+struct cloop_stats_data {
+	/** Statistics for each stage. */
+	struct cloop_stats stats[CLOOP_STATS_STAGE_COUNT];
+	/** Sequence counter (odd while statistics are being updated). */
+	atomic_t seq;
+	/** Reset request. */
+	atomic_t reset;
+	/** Last regulation start timestamp. */
+	uint32_t last_start;
+	/** Last regulation start timestamp is valid. */
+	bool last_start_valid;
+};
+
+static struct cloop_stats_data data;
+
+static void stats_reset(void)
+{
+	for (size_t i = 0U; i < ARRAY_SIZE(data.stats); i++) {
+		memset(&data.stats[i], 0, sizeof(data.stats[i]));
+		data.stats[i].min = UINT32_MAX;
+	}
+
+	data.last_start_valid = false;
+}
+
+/*******************************************************************************
+ * Internal
+ ******************************************************************************/
+
+void cloop_stats_init(void)
+{
+	cycles_init();
+	stats_reset();
+}
+
+uint32_t cloop_stats_begin(void)
+{
+	uint32_t now = cycles_get();
+
+	atomic_inc(&data.seq);
+
+	if (atomic_cas(&data.reset, 1, 0)) {
+		stats_reset();
+	}
+
+	if (data.last_start_valid) {
+		cloop_stats_record(CLOOP_STATS_STAGE_PERIOD,
+				   now - data.last_start);
+	}
+
+	data.last_start = now;
+	data.last_start_valid = true;
+
+	return now;
+}
+
+void cloop_stats_record(enum cloop_stats_stage stage, uint32_t cycles)
+{
+	struct cloop_stats *stats = &data.stats[stage];
+	uint32_t bin;
+
+	stats->min = MIN(stats->min, cycles);
+	stats->max = MAX(stats->max, cycles);
+	stats->sum += cycles;
+	stats->count++;
+
+	bin = (cycles == 0U) ? 0U : (32U - (uint32_t)__builtin_clz(cycles));
+	stats->hist[MIN(bin, CLOOP_STATS_HIST_BINS - 1U)]++;
+}
+
+void cloop_stats_end(void)
+{
+	atomic_inc(&data.seq);
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void cloop_stats_get(enum cloop_stats_stage stage, struct cloop_stats *stats)
+{
+	atomic_val_t seq;
+
+	__ASSERT_NO_MSG(stage < CLOOP_STATS_STAGE_COUNT);
+
+	/* retry if the regulation callback updated statistics while copying */
+	do {
+		seq = atomic_get(&data.seq);
+		memcpy(stats, &data.stats[stage], sizeof(*stats));
+	} while (((seq & 1) != 0) || (seq != atomic_get(&data.seq)));
+}
+
+void cloop_stats_reset(void)
+{
+	atomic_set(&data.reset, 1);
+}
+
+uint32_t cloop_stats_get_rate(void)
+{
+	return cycles_get_rate();
+}
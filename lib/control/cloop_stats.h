@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_CLOOP_STATS_H_
+#define _SPINNER_LIB_CONTROL_CLOOP_STATS_H_
+
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+
+#include <spinner/control/cloop.h>
+#include <spinner/utils/cycles.h>
+
+/*
+ * Current loop profiling hooks, to be used from the regulation callback. When
+ * CONFIG_SPINNER_CLOOP_STATS is disabled they are empty and get optimized out.
+ */
+
+#ifdef CONFIG_SPINNER_CLOOP_STATS
+
+void cloop_stats_init(void);
+
+uint32_t cloop_stats_begin(void);
+
+void cloop_stats_record(enum cloop_stats_stage stage, uint32_t cycles);
+
+void cloop_stats_end(void);
+
+/**
+ * @brief Mark the end of a regulation stage.
+ *
+ * @param[in] stage Stage.
+ * @param[in] start Stage start timestamp.
+ *
+ * @return Stage end timestamp (start of the next stage).
+ */
+static inline uint32_t cloop_stats_mark(enum cloop_stats_stage stage,
+					uint32_t start)
+{
+	uint32_t now = cycles_get();
+
+	cloop_stats_record(stage, now - start);
+
+	return now;
+}
+
+/**
+ * @brief Mark the end of the regulation callback.
+ *
+ * @param[in] start Regulation start timestamp.
+ */
+static inline void cloop_stats_finish(uint32_t start)
+{
+	cloop_stats_record(CLOOP_STATS_STAGE_TOTAL, cycles_get() - start);
+	cloop_stats_end();
+}
+
+#else
+
+static inline void cloop_stats_init(void)
+{
+}
+
+static inline uint32_t cloop_stats_begin(void)
+{
+	return 0U;
+}
+
+static inline uint32_t cloop_stats_mark(enum cloop_stats_stage stage,
+					uint32_t start)
+{
+	ARG_UNUSED(stage);
+	ARG_UNUSED(start);
+
+	return 0U;
+}
+
+static inline void cloop_stats_finish(uint32_t start)
+{
+	ARG_UNUSED(start);
+}
+
+#endif /* CONFIG_SPINNER_CLOOP_STATS */
+
+#endif /* _SPINNER_LIB_CONTROL_CLOOP_STATS_H_ */
@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <spinner/control/ploop.h>
+#include <spinner/drivers/svpwm.h>
+#include <spinner/traj/traj.h>
+#include <spinner/utils/dbuf.h>
+
+#include "ploop_priv.h"
+
+/** Degrees to Q32 (2^32 per turn) angle conversion factor. */
+#define DEG_TO_Q32 (4294967296.0f / 360.0f)
+
+/** Q32 (2^32 per turn) position to turns conversion factor. */
+#define Q32_TO_TURNS (1.0f / 4294967296.0f)
+
+/** @brief Parameters used by the regulation IRQ. */
+struct ploop_params {
+	bool enabled;
+	/* incremented on every start */
+	uint32_t starts;
+	/* no target set since start (hold position) */
+	bool hold;
+	float target;
+	/* incremented on every new target */
+	uint32_t targets;
+	struct traj_limits limits;
+	float kp;
+	float ka;
+};
+
+struct ploop {
+	/* position regulation period (s) */
+	float ts;
+	/* current regulation IRQ state (position tracking) */
+	bool tracking;
+	uint32_t last_eangle;
+	int64_t pos;
+	atomic_t pos_seq;
+	/* speed regulation IRQ state */
+	bool running;
+	uint32_t last_starts;
+	uint32_t last_targets;
+	uint32_t cnt;
+	traj_t traj;
+	float traj_buf[CONFIG_SPINNER_PLOOP_TRAJ_BUF_SIZE];
+	float speed_ref;
+	float i_q_ff;
+	atomic_t done;
+	/* regulation IRQ parameters (copy of the last published) */
+	struct ploop_params params;
+	atomic_val_t params_seq;
+	/* parameters exchange buffers */
+	struct ploop_params params_buf[2];
+	struct dbuf params_dbuf;
+	/* thread context settings */
+	struct k_mutex lock;
+	bool enabled;
+	uint32_t starts;
+	bool hold;
+	float target;
+	uint32_t targets;
+	struct traj_limits limits;
+	struct ploop_gains gains;
+};
+
+static struct ploop ploop;
+
+/**
+ * @brief Publish the current settings to the regulation IRQ.
+ *
+ * @note Must be called with the lock held.
+ */
+static void params_publish(void)
+{
+	struct ploop_params *params;
+
+	params = dbuf_write_begin(&ploop.params_dbuf);
+
+	params->enabled = ploop.enabled;
+	params->starts = ploop.starts;
+	params->hold = ploop.hold;
+	params->target = ploop.target;
+	params->targets = ploop.targets;
+	params->limits = ploop.limits;
+	params->kp = ploop.gains.kp;
+	params->ka = ploop.gains.ka;
+
+	dbuf_write_end(&ploop.params_dbuf);
+}
+
+/**
+ * @brief Obtain the tracked position.
+ *
+ * @return Position (electrical turns).
+ */
+static inline float position_get(void)
+{
+	return (float)ploop.pos * Q32_TO_TURNS;
+}
+
+/**
+ * @brief Position tracking.
+ *
+ * The electrical angle is unwrapped, so the angle can not change by more than
+ * half a turn between calls.
+ *
+ * @warning Must be called from the current regulation IRQ.
+ *
+ * @param[in] eangle Electrical angle (degrees, [0, 360)).
+ */
+void ploop_track(float eangle)
+{
+	uint32_t eangle_q32 = (uint32_t)(uint64_t)(eangle * DEG_TO_Q32);
+
+	/* sequence counter is odd while updating (see ploop_get_position()) */
+	(void)atomic_inc(&ploop.pos_seq);
+
+	if (ploop.tracking) {
+		ploop.pos += (int32_t)(eangle_q32 - ploop.last_eangle);
+	} else {
+		ploop.tracking = true;
+	}
+
+	ploop.last_eangle = eangle_q32;
+
+	(void)atomic_inc(&ploop.pos_seq);
+}
+
+/**
+ * @brief Position regulation.
+ *
+ * Runs every CONFIG_SPINNER_PLOOP_DIV calls, the last outputs are kept in
+ * between.
+ *
+ * @warning Must be called from the speed regulation (IRQ).
+ *
+ * @param[in] restart Speed loop (re)started, the position loop restarts
+ * holding the current position (or moving to the target, if set).
+ * @param[out] speed_ref Speed reference (electrical rev/s).
+ * @param[out] i_q_ff i_q feedforward.
+ *
+ * @retval true If the position loop is running (outputs valid).
+ * @retval false If the position loop is stopped.
+ */
+bool ploop_regulate(bool restart, float *speed_ref, float *i_q_ff)
+{
+	float pos;
+
+	if (ploop.running && !restart &&
+	    (++ploop.cnt < CONFIG_SPINNER_PLOOP_DIV)) {
+		*speed_ref = ploop.speed_ref;
+		*i_q_ff = ploop.i_q_ff;
+		return true;
+	}
+
+	ploop.cnt = 0U;
+
+	if (dbuf_read(&ploop.params_dbuf, &ploop.params, &ploop.params_seq)) {
+		/* NOTE: limits are validated on the thread side */
+		(void)traj_set_limits(&ploop.traj, &ploop.params.limits);
+	}
+
+	if (!ploop.params.enabled) {
+		ploop.running = false;
+		return false;
+	}
+
+	pos = position_get();
+
+	/* bumpless start: hold the current position */
+	if (!ploop.running || restart ||
+	    (ploop.last_starts != ploop.params.starts)) {
+		ploop.running = true;
+		ploop.last_starts = ploop.params.starts;
+		ploop.last_targets = ploop.params.targets;
+		traj_reset(&ploop.traj, pos);
+		if (!ploop.params.hold) {
+			traj_set_target(&ploop.traj, ploop.params.target);
+		}
+	} else if (ploop.last_targets != ploop.params.targets) {
+		ploop.last_targets = ploop.params.targets;
+		traj_set_target(&ploop.traj, ploop.params.target);
+	}
+
+	traj_update(&ploop.traj);
+	atomic_set(&ploop.done, traj_done(&ploop.traj) ? 1 : 0);
+
+	ploop.speed_ref = traj_get_vel(&ploop.traj) +
+			  ploop.params.kp * (traj_get_pos(&ploop.traj) - pos);
+	ploop.i_q_ff = ploop.params.ka * traj_get_acc(&ploop.traj);
+
+	*speed_ref = ploop.speed_ref;
+	*i_q_ff = ploop.i_q_ff;
+
+	return true;
+}
+
+static int ploop_init(void)
+{
+	const struct device *svpwm = DEVICE_DT_GET(DT_NODELABEL(svpwm));
+
+	ploop.ts = (float)(CONFIG_SPINNER_PLOOP_DIV * CONFIG_SPINNER_SLOOP_DIV) /
+		   (float)svpwm_get_freq(svpwm);
+
+	traj_init(&ploop.traj, ploop.traj_buf, ARRAY_SIZE(ploop.traj_buf),
+		  ploop.ts);
+
+	k_mutex_init(&ploop.lock);
+
+	ploop.enabled = false;
+	ploop.hold = true;
+	ploop.limits.v_max = (float)CONFIG_SPINNER_PLOOP_V_MAX;
+	ploop.limits.a_max = (float)CONFIG_SPINNER_PLOOP_A_MAX;
+	ploop.limits.j_max = (float)CONFIG_SPINNER_PLOOP_J_MAX;
+	ploop.gains.kp = CONFIG_SPINNER_PLOOP_KP / 1000.0f;
+	ploop.gains.ka = 0.0f;
+
+	if (traj_set_limits(&ploop.traj, &ploop.limits) < 0) {
+		return -EINVAL;
+	}
+
+	dbuf_init(&ploop.params_dbuf, &ploop.params_buf[0],
+		  &ploop.params_buf[1], sizeof(ploop.params_buf[0]));
+	ploop.params_seq = 0;
+
+	params_publish();
+	(void)dbuf_read(&ploop.params_dbuf, &ploop.params, &ploop.params_seq);
+
+	atomic_set(&ploop.done, 1);
+
+	return 0;
+}
+
+SYS_INIT(ploop_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void ploop_start(void)
+{
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	ploop.enabled = true;
+	ploop.starts++;
+	ploop.hold = true;
+	params_publish();
+	(void)k_mutex_unlock(&ploop.lock);
+}
+
+void ploop_stop(void)
+{
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	ploop.enabled = false;
+	params_publish();
+	(void)k_mutex_unlock(&ploop.lock);
+}
+
+void ploop_set_target(float pos)
+{
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	ploop.target = pos;
+	ploop.targets++;
+	ploop.hold = false;
+	params_publish();
+	atomic_set(&ploop.done, 0);
+	(void)k_mutex_unlock(&ploop.lock);
+}
+
+int ploop_set_limits(const struct traj_limits *limits)
+{
+	if ((limits->v_max <= 0.0f) || (limits->a_max <= 0.0f) ||
+	    (limits->j_max < 0.0f) ||
+	    (traj_get_filter_len(limits, ploop.ts) >
+	     CONFIG_SPINNER_PLOOP_TRAJ_BUF_SIZE)) {
+		return -EINVAL;
+	}
+
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	ploop.limits = *limits;
+	params_publish();
+	(void)k_mutex_unlock(&ploop.lock);
+
+	return 0;
+}
+
+void ploop_set_gains(const struct ploop_gains *gains)
+{
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	ploop.gains = *gains;
+	params_publish();
+	(void)k_mutex_unlock(&ploop.lock);
+}
+
+void ploop_get_gains(struct ploop_gains *gains)
+{
+	(void)k_mutex_lock(&ploop.lock, K_FOREVER);
+	*gains = ploop.gains;
+	(void)k_mutex_unlock(&ploop.lock);
+}
+
+float ploop_get_position(void)
+{
+	atomic_val_t seq;
+	int64_t pos;
+
+	/* retry if the regulation IRQ updated the position while copying */
+	do {
+		seq = atomic_get(&ploop.pos_seq);
+		pos = ploop.pos;
+	} while (((seq & 1) != 0) || (seq != atomic_get(&ploop.pos_seq)));
+
+	return (float)pos * Q32_TO_TURNS;
+}
+
+bool ploop_is_done(void)
+{
+	return atomic_get(&ploop.done) != 0;
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_PLOOP_PRIV_H_
+#define _SPINNER_LIB_CONTROL_PLOOP_PRIV_H_
+
+#include <stdbool.h>
+
+#include <zephyr/sys/util.h>
+
+/*
+ * Position loop hooks, to be used from the current (ploop_track()) and speed
+ * (ploop_regulate()) regulation callbacks. When CONFIG_SPINNER_PLOOP is
+ * disabled they are empty and get optimized out.
+ */
+
+#ifdef CONFIG_SPINNER_PLOOP
+
+void ploop_track(float eangle);
+
+bool ploop_regulate(bool restart, float *speed_ref, float *i_q_ff);
+
+#else
+
+static inline void ploop_track(float eangle)
+{
+	ARG_UNUSED(eangle);
+}
+
+static inline bool ploop_regulate(bool restart, float *speed_ref,
+				  float *i_q_ff)
+{
+	ARG_UNUSED(restart);
+	ARG_UNUSED(speed_ref);
+	ARG_UNUSED(i_q_ff);
+
+	return false;
+}
+
+#endif /* CONFIG_SPINNER_PLOOP */
+
+#endif /* _SPINNER_LIB_CONTROL_PLOOP_PRIV_H_ */
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/kernel.h>
+
+#include <spinner/control/sloop.h>
+#include <spinner/drivers/feedback.h>
+#include <spinner/drivers/svpwm.h>
+#include <spinner/pi/pi.h>
+#include <spinner/utils/dbuf.h>
+
+#include "ploop_priv.h"
+#include "sloop_priv.h"
+
+/** @brief Parameters used by the regulation IRQ. */
+struct sloop_params {
+	bool enabled;
+	/* incremented on every start */
+	uint32_t starts;
+	float speed_ref;
+	/* speed ramp step (per speed regulation cycle) */
+	float step;
+	float i_max;
+	/* PI coefficients (integral gain per speed regulation cycle) */
+	struct pi_coeffs coeffs;
+};
+
+struct sloop {
+	const struct device *feedback;
+	/* speed regulation period (s) */
+	float ts;
+	/* regulation IRQ state */
+	bool running;
+	uint32_t last_starts;
+	uint32_t cnt;
+	float speed_ramp;
+	pi_t pi;
+	float i_q_ref;
+	/* regulation IRQ parameters (copy of the last published) */
+	struct sloop_params params;
+	atomic_val_t params_seq;
+	/* parameters exchange buffers */
+	struct sloop_params params_buf[2];
+	struct dbuf params_dbuf;
+	/* thread context settings */
+	struct k_mutex lock;
+	bool enabled;
+	uint32_t starts;
+	float speed_ref;
+	float accel;
+	float i_max;
+	struct sloop_gains gains;
+};
+
+static struct sloop sloop;
+
+/**
+ * @brief Publish the current settings to the regulation IRQ.
+ *
+ * Gains and acceleration are converted to per speed regulation cycle values,
+ * so that the IRQ does not need to scale them.
+ *
+ * @note Must be called with the lock held.
+ */
+static void params_publish(void)
+{
+	struct sloop_params *params;
+
+	params = dbuf_write_begin(&sloop.params_dbuf);
+
+	params->enabled = sloop.enabled;
+	params->starts = sloop.starts;
+	params->speed_ref = sloop.speed_ref;
+	params->step = sloop.accel * sloop.ts;
+	params->i_max = sloop.i_max;
+	pi_coeffs_compute(&params->coeffs, sloop.gains.kp,
+			  sloop.gains.ki * sloop.ts);
+
+	dbuf_write_end(&sloop.params_dbuf);
+}
+
+/**
+ * @brief Obtain new parameters, if published.
+ *
+ * PI coefficients are updated only when new parameters are available, keeping
+ * the PI integrator.
+ */
+static inline void params_update(void)
+{
+	if (!dbuf_read(&sloop.params_dbuf, &sloop.params, &sloop.params_seq)) {
+		return;
+	}
+
+	pi_set_coeffs(&sloop.pi, &sloop.params.coeffs);
+}
+
+/**
+ * @brief Speed regulation.
+ *
+ * Runs every CONFIG_SPINNER_SLOOP_DIV calls, the last i_q reference is kept in
+ * between.
+ *
+ * @warning Must be called from the current regulation IRQ.
+ *
+ * @param[in, out] i_q_ref i_q reference, replaced by the speed loop output
+ * while running.
+ * @param[in] i_q_max Current loop i_q limit (amplitude left by i_d), the
+ * output is limited to the lowest of this value and the speed loop i_max.
+ */
+void sloop_regulate(float *i_q_ref, float i_q_max)
+{
+	float speed, speed_ref, err;
+	float i_q_ff = 0.0f;
+	bool restart = false;
+
+	if (sloop.running && (++sloop.cnt < CONFIG_SPINNER_SLOOP_DIV)) {
+		*i_q_ref = CLAMP(sloop.i_q_ref, -i_q_max, i_q_max);
+		return;
+	}
+
+	sloop.cnt = 0U;
+
+	params_update();
+
+	if (!sloop.params.enabled) {
+		sloop.running = false;
+		return;
+	}
+
+	pi_set_limit(&sloop.pi, MIN(sloop.params.i_max, i_q_max));
+
+	speed = feedback_get_speed(sloop.feedback);
+
+	/* bumpless start: ramp from the measured speed, PI from i_q_ref */
+	if (!sloop.running || (sloop.last_starts != sloop.params.starts)) {
+		sloop.running = true;
+		sloop.last_starts = sloop.params.starts;
+		sloop.speed_ramp = speed;
+		pi_reset(&sloop.pi, *i_q_ref);
+		restart = true;
+	}
+
+	/* position loop (decimated) trajectory replaces the ramp if running */
+	if (ploop_regulate(restart, &speed_ref, &i_q_ff)) {
+		sloop.speed_ramp = speed_ref;
+	} else {
+		sloop.speed_ramp += CLAMP(sloop.params.speed_ref -
+						  sloop.speed_ramp,
+					  -sloop.params.step,
+					  sloop.params.step);
+	}
+
+	err = sloop.speed_ramp - speed;
+	/* PI (limited to i_max, including the feedforward) */
+	sloop.i_q_ref = pi_run_ff(&sloop.pi, err, i_q_ff);
+
+	*i_q_ref = sloop.i_q_ref;
+}
+
+/**
+ * @brief Reset the speed regulation state.
+ *
+ * If enabled, the speed loop restarts (bumpless) on the next regulation cycle.
+ *
+ * @warning Must be called with the current regulation IRQ stopped.
+ */
+void sloop_reset(void)
+{
+	sloop.running = false;
+	pi_reset(&sloop.pi, 0.0f);
+}
+
+static int sloop_init(void)
+{
+	const struct device *svpwm = DEVICE_DT_GET(DT_NODELABEL(svpwm));
+
+	sloop.feedback = DEVICE_DT_GET(DT_NODELABEL(feedback));
+	sloop.ts = (float)CONFIG_SPINNER_SLOOP_DIV / (float)svpwm_get_freq(svpwm);
+
+	k_mutex_init(&sloop.lock);
+
+	sloop.enabled = false;
+	sloop.speed_ref = 0.0f;
+	sloop.accel = (float)CONFIG_SPINNER_SLOOP_ACCEL;
+	sloop.i_max = 1.0f;
+	sloop.gains.kp = CONFIG_SPINNER_SLOOP_KP / 1000.0f;
+	sloop.gains.ki = CONFIG_SPINNER_SLOOP_KI / 1000.0f;
+
+	pi_init(&sloop.pi, sloop.i_max);
+
+	dbuf_init(&sloop.params_dbuf, &sloop.params_buf[0],
+		  &sloop.params_buf[1], sizeof(sloop.params_buf[0]));
+	sloop.params_seq = 0;
+
+	params_publish();
+	params_update();
+
+	return 0;
+}
+
+SYS_INIT(sloop_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void sloop_start(void)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.enabled = true;
+	sloop.starts++;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_stop(void)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.enabled = false;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_set_ref(float speed)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.speed_ref = speed;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_set_accel(float accel)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.accel = accel;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_set_i_max(float i_max)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.i_max = i_max;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_set_gains(const struct sloop_gains *gains)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	sloop.gains = *gains;
+	params_publish();
+	(void)k_mutex_unlock(&sloop.lock);
+}
+
+void sloop_get_gains(struct sloop_gains *gains)
+{
+	(void)k_mutex_lock(&sloop.lock, K_FOREVER);
+	*gains = sloop.gains;
+	(void)k_mutex_unlock(&sloop.lock);
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SPINNER_LIB_CONTROL_SLOOP_PRIV_H_
+#define _SPINNER_LIB_CONTROL_SLOOP_PRIV_H_
+
+#include <zephyr/sys/util.h>
+
+/*
+ * Speed loop hooks, to be used from the current loop (sloop_regulate() from
+ * the regulation callback, sloop_reset() on start/stop). When
+ * CONFIG_SPINNER_SLOOP is disabled they are empty and get optimized out.
+ */
+
+#ifdef CONFIG_SPINNER_SLOOP
+
+void sloop_regulate(float *i_q_ref, float i_q_max);
+
+void sloop_reset(void);
+
+#else
+
+static inline void sloop_regulate(float *i_q_ref, float i_q_max)
+{
+	ARG_UNUSED(i_q_ref);
+	ARG_UNUSED(i_q_max);
+}
+
+static inline void sloop_reset(void)
+{
+}
+
+#endif /* CONFIG_SPINNER_SLOOP */
+
+#endif /* _SPINNER_LIB_CONTROL_SLOOP_PRIV_H_ */
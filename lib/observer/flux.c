@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <spinner/observer/flux.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Radians to degrees conversion factor. */
+#define RAD_TO_DEG 57.29577951308232f
+
+/** PLL timeout (s), only reached if updates are not performed. */
+#define PLL_TIMEOUT 1.0f
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void flux_obs_init(flux_obs_t *obs, const struct flux_obs_params *params)
+{
+	obs->r = params->r;
+	obs->l = params->l;
+	obs->flux_sq = params->flux * params->flux;
+	obs->gamma_2 = 0.5f * params->gain / obs->flux_sq;
+	obs->ts = params->ts;
+
+	/* psi aligned with the alpha axis (zero angle) */
+	obs->x_alpha = params->flux;
+	obs->x_beta = 0.0f;
+	obs->theta = 0.0f;
+
+	pll_init(&obs->pll, params->pll_bw, params->ts, PLL_TIMEOUT);
+}
+
+void flux_obs_update(flux_obs_t *obs, float i_alpha, float i_beta,
+		     float v_alpha, float v_beta)
+{
+	float psi_alpha, psi_beta, err;
+
+	psi_alpha = obs->x_alpha - obs->l * i_alpha;
+	psi_beta = obs->x_beta - obs->l * i_beta;
+
+	err = obs->gamma_2 *
+	      (obs->flux_sq - (psi_alpha * psi_alpha + psi_beta * psi_beta));
+
+	obs->x_alpha +=
+		obs->ts * (v_alpha - obs->r * i_alpha + psi_alpha * err);
+	obs->x_beta += obs->ts * (v_beta - obs->r * i_beta + psi_beta * err);
+
+	/*
+	 * angle at the end of the period (next regulation cycle), current
+	 * change during the period is neglected
+	 */
+	psi_alpha = obs->x_alpha - obs->l * i_alpha;
+	psi_beta = obs->x_beta - obs->l * i_beta;
+
+	obs->theta = atan2f(psi_beta, psi_alpha) * RAD_TO_DEG;
+	if (obs->theta < 0.0f) {
+		obs->theta += 360.0f;
+	}
+
+	/* every estimate is a position event for the speed PLL */
+	pll_event(&obs->pll, obs->theta);
+	pll_update(&obs->pll);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <spinner/pi/pi.h>
+#include <spinner/utils/mathutil.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/**
+ * @brief Compute the anti-windup gain.
+ *
+ * Back-calculation tracking time is set to the integral time (kp / ki samples),
+ * limited to one sample. Pure integral controllers use a single sample.
+ *
+ * @param[in] kp Proportional gain.
+ * @param[in] ki Integral gain (per sample).
+ *
+ * @return Anti-windup gain.
+ */
+static float kaw_compute(float kp, float ki)
+{
+	if (ki <= 0.0f) {
+		return 0.0f;
+	}
+
+	if (kp <= ki) {
+		return 1.0f;
+	}
+
+	return ki / kp;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void pi_coeffs_compute(struct pi_coeffs *c, float kp, float ki)
+{
+	c->kp = kp;
+	c->ki = ki;
+	c->kaw = kaw_compute(kp, ki);
+}
+
+void pi_init(pi_t *pi, float limit)
+{
+	pi_coeffs_compute(&pi->c, 0.0f, 0.0f);
+	pi->limit = limit;
+	pi_reset(pi, 0.0f);
+}
+
+void pi_dq_coeffs_compute(struct pi_dq_coeffs *c, float kp_d, float ki_d,
+			  float kp_q, float ki_q)
+{
+	c->kp_d = kp_d;
+	c->ki_d = ki_d;
+	c->kaw_d = kaw_compute(kp_d, ki_d);
+	c->kp_q = kp_q;
+	c->ki_q = ki_q;
+	c->kaw_q = kaw_compute(kp_q, ki_q);
+}
+
+void pi_dq_init(pi_dq_t *pi, float v_max)
+{
+	pi_dq_coeffs_compute(&pi->c, 0.0f, 0.0f, 0.0f, 0.0f);
+	pi->v_max = v_max;
+	pi_dq_reset(pi);
+}
+
+void pi_dq_q31_coeffs_compute(struct pi_dq_coeffs_q31 *c, float kp_d,
+			      float ki_d, float kp_q, float ki_q, uint8_t shift)
+{
+	float scale = 1.0f / (float)(1UL << shift);
+
+	c->kp_d = f32_to_q31(kp_d * scale);
+	c->ki_d = f32_to_q31(ki_d * scale);
+	c->kaw_d = f32_to_q31(kaw_compute(kp_d, ki_d));
+	c->kp_q = f32_to_q31(kp_q * scale);
+	c->ki_q = f32_to_q31(ki_q * scale);
+	c->kaw_q = f32_to_q31(kaw_compute(kp_q, ki_q));
+}
+
+void pi_dq_q31_init(pi_dq_q31_t *pi, q31_t v_max, uint8_t shift)
+{
+	pi_dq_q31_coeffs_compute(&pi->c, 0.0f, 0.0f, 0.0f, 0.0f, shift);
+	pi->v_max = v_max;
+	pi->shift = shift;
+	pi_dq_q31_reset(pi);
+}
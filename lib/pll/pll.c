@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <arm_math.h>
+
+#include <spinner/pll/pll.h>
+#include <spinner/utils/mathutil.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Q31 angle units per turn (2^32). */
+#define Q31_TURN 4294967296.0f
+
+/**
+ * @brief Wrap an angle difference to [-180, 180) degrees.
+ *
+ * @param[in] x Angle difference (within (-540, 540) degrees).
+ *
+ * @return Wrapped angle difference.
+ */
+static inline float wrap_err(float x)
+{
+	if (x >= 180.0f) {
+		x -= 360.0f;
+	} else if (x < -180.0f) {
+		x += 360.0f;
+	}
+
+	return x;
+}
+
+/**
+ * @brief Wrap an angle to [0, 360) degrees.
+ *
+ * @param[in] x Angle (within (-360, 720) degrees).
+ *
+ * @return Wrapped angle.
+ */
+static inline float wrap(float x)
+{
+	if (x >= 360.0f) {
+		x -= 360.0f;
+	} else if (x < 0.0f) {
+		x += 360.0f;
+	}
+
+	return x;
+}
+
+/**
+ * @brief Compute critically damped loop gains (per update).
+ *
+ * @param[in] bw Bandwidth (natural frequency, Hz).
+ * @param[in] ts Update period (s).
+ * @param[out] kp Proportional gain.
+ * @param[out] ki Integral gain.
+ */
+static void gains(float bw, float ts, float *kp, float *ki)
+{
+	float wn_ts = TWO_PI * bw * ts;
+
+	*kp = 2.0f * wn_ts;
+	*ki = wn_ts * wn_ts;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void pll_init(pll_t *pll, float bw, float ts, float timeout)
+{
+	gains(bw, ts, &pll->kp, &pll->ki);
+
+	pll->ts = ts;
+	pll->timeout = (uint32_t)(timeout / ts);
+	pll->elapsed = pll->timeout;
+
+	pll->theta = 0.0f;
+	pll->omega = 0.0f;
+	pll->meas = 0.0f;
+}
+
+void pll_event(pll_t *pll, float theta)
+{
+	theta = wrap(theta);
+
+	/* re-initialize estimation after a timeout */
+	if (pll->elapsed >= pll->timeout) {
+		pll->theta = theta;
+		pll->omega = 0.0f;
+	}
+
+	pll->meas = theta;
+	pll->elapsed = 0U;
+}
+
+void pll_update(pll_t *pll)
+{
+	float err;
+
+	if (pll->elapsed >= pll->timeout) {
+		pll->theta = pll->meas;
+		pll->omega = 0.0f;
+		return;
+	}
+
+	pll->elapsed++;
+
+	err = wrap_err(pll->meas - pll->theta);
+
+	pll->omega += pll->ki * err;
+	pll->theta = wrap(pll->theta + pll->omega + pll->kp * err);
+	pll->meas = wrap(pll->meas + pll->omega);
+}
+
+float pll_get_speed(const pll_t *pll)
+{
+	return pll->omega / (360.0f * pll->ts);
+}
+
+void pll_q31_init(pll_q31_t *pll, float bw, float ts, float timeout)
+{
+	float kp, ki;
+
+	gains(bw, ts, &kp, &ki);
+
+	pll->kp = clip_q63_to_q31((q63_t)(kp * 2147483648.0f));
+	pll->ki = clip_q63_to_q31((q63_t)(ki * 2147483648.0f));
+
+	pll->ts = ts;
+	pll->timeout = (uint32_t)(timeout / ts);
+	pll->elapsed = pll->timeout;
+
+	pll->theta = 0;
+	pll->omega = 0;
+	pll->meas = 0;
+}
+
+void pll_q31_event(pll_q31_t *pll, int32_t theta)
+{
+	if (pll->elapsed >= pll->timeout) {
+		pll->theta = theta;
+		pll->omega = 0;
+	}
+
+	pll->meas = theta;
+	pll->elapsed = 0U;
+}
+
+void pll_q31_update(pll_q31_t *pll)
+{
+	q31_t err;
+
+	if (pll->elapsed >= pll->timeout) {
+		pll->theta = pll->meas;
+		pll->omega = 0;
+		return;
+	}
+
+	pll->elapsed++;
+
+	/* NOTE: angles wrap naturally (modulo 2^32) */
+	err = (q31_t)((uint32_t)pll->meas - (uint32_t)pll->theta);
+
+	pll->omega += (q31_t)(((q63_t)pll->ki * err) >> 31);
+	pll->theta = (q31_t)((uint32_t)pll->theta + (uint32_t)pll->omega +
+			     (uint32_t)(q31_t)(((q63_t)pll->kp * err) >> 31));
+	pll->meas = (q31_t)((uint32_t)pll->meas + (uint32_t)pll->omega);
+}
+
+float pll_q31_get_speed(const pll_q31_t *pll)
+{
+	return (float)pll->omega / (Q31_TURN * pll->ts);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <spinner/sim/pmsm.h>
+#include <spinner/utils/mathutil.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Value sqrt(3) / 2. */
+#define SQRT_3_2 0.8660254037844386f
+
+/** Maximum sub-step period (s). */
+#define SUBSTEP_MAX 5.0e-6f
+
+/**
+ * @brief Integrate mechanical dynamics.
+ *
+ * @param[in] pmsm PMSM model.
+ * @param[in] dt Period (s).
+ */
+static void step_mech(struct pmsm *pmsm, float dt)
+{
+	const struct pmsm_params *p = &pmsm->params;
+
+	if (p->j > 0.0f) {
+		pmsm->w_m += (pmsm->t_e - p->b * pmsm->w_m - pmsm->t_l) /
+			     p->j * dt;
+	}
+
+	pmsm->theta_e += pmsm->w_m * (float)p->pole_pairs * dt;
+	pmsm->theta_e = fmodf(pmsm->theta_e, TWO_PI);
+	if (pmsm->theta_e < 0.0f) {
+		pmsm->theta_e += TWO_PI;
+	}
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void pmsm_init(struct pmsm *pmsm, const struct pmsm_params *params)
+{
+	pmsm->params = *params;
+
+	pmsm->i_d = 0.0f;
+	pmsm->i_q = 0.0f;
+	pmsm->t_e = 0.0f;
+	pmsm->t_l = 0.0f;
+	pmsm->w_m = 0.0f;
+	pmsm->theta_e = 0.0f;
+}
+
+void pmsm_step(struct pmsm *pmsm, float v_alpha, float v_beta, float dt)
+{
+	const struct pmsm_params *p = &pmsm->params;
+	uint32_t n;
+	float h, a_d, a_q;
+
+	n = (uint32_t)ceilf(dt / SUBSTEP_MAX);
+	h = dt / (float)n;
+
+	a_d = expf(-p->r * h / p->l_d);
+	a_q = expf(-p->r * h / p->l_q);
+
+	for (uint32_t i = 0U; i < n; i++) {
+		float sin_e, cos_e, w_e, v_d, v_q, u_d, u_q;
+
+		sin_e = sinf(pmsm->theta_e);
+		cos_e = cosf(pmsm->theta_e);
+		w_e = pmsm_get_espeed(pmsm);
+
+		/* v_alpha, v_beta -> v_d, v_q */
+		v_d = v_alpha * cos_e + v_beta * sin_e;
+		v_q = -v_alpha * sin_e + v_beta * cos_e;
+
+		/* RL circuits (speed dependent terms as disturbances) */
+		u_d = v_d + w_e * p->l_q * pmsm->i_q;
+		u_q = v_q - w_e * p->l_d * pmsm->i_d - w_e * p->flux;
+
+		pmsm->i_d = a_d * pmsm->i_d + (1.0f - a_d) * u_d / p->r;
+		pmsm->i_q = a_q * pmsm->i_q + (1.0f - a_q) * u_q / p->r;
+
+		pmsm->t_e = 1.5f * (float)p->pole_pairs *
+			    (p->flux * pmsm->i_q +
+			     (p->l_d - p->l_q) * pmsm->i_d * pmsm->i_q);
+
+		step_mech(pmsm, h);
+	}
+}
+
+void pmsm_step_open(struct pmsm *pmsm, float dt)
+{
+	pmsm->i_d = 0.0f;
+	pmsm->i_q = 0.0f;
+	pmsm->t_e = 0.0f;
+
+	step_mech(pmsm, dt);
+}
+
+void pmsm_set_load(struct pmsm *pmsm, float t_l)
+{
+	pmsm->t_l = t_l;
+}
+
+void pmsm_set_speed(struct pmsm *pmsm, float w_m)
+{
+	pmsm->w_m = w_m;
+}
+
+void pmsm_get_currents(const struct pmsm *pmsm, float *i_a, float *i_b,
+		       float *i_c)
+{
+	float sin_e, cos_e, i_alpha, i_beta;
+
+	sin_e = sinf(pmsm->theta_e);
+	cos_e = cosf(pmsm->theta_e);
+
+	/* i_d, i_q -> i_alpha, i_beta */
+	i_alpha = pmsm->i_d * cos_e - pmsm->i_q * sin_e;
+	i_beta = pmsm->i_d * sin_e + pmsm->i_q * cos_e;
+
+	/* i_alpha, i_beta -> i_a, i_b, i_c */
+	*i_a = i_alpha;
+	*i_b = -0.5f * i_alpha + SQRT_3_2 * i_beta;
+	*i_c = -(*i_a + *i_b);
+}
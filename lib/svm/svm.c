@@ -3,6 +3,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <math.h>
+#include <stdlib.h>
+
 #include <zephyr/sys/util.h>
 
 #include <arm_math.h>
@@ -16,6 +19,58 @@
 /** Value sqrt(3). */
 #define SQRT_3 1.7320508075688773f
 
+/** Squared linear region limit ((sqrt(3) / 2)^2). */
+#define LIMIT_SQ 0.75f
+
+/** Value 0.5 (Q31). */
+#define HALF_Q31 ((q31_t)0x40000000)
+/** Value 1 / sqrt(3) (Q31). */
+#define INV_SQRT_3_Q31 ((q31_t)0x49E69D16)
+/** Value sqrt(3) / (2 * sqrt(2)) (Q31). */
+#define SQRT_3_2_SQRT_2_Q31 ((q31_t)0x4E623850)
+/** Value (sqrt(3) / 2)^2 / 2 (Q31). */
+#define LIMIT_SQ_HALF_Q31 ((q31_t)0x30000000)
+/** Value sqrt(3) / 2 (Q31). */
+#define SQRT_3_2_Q31 ((q31_t)0x6ED9EBA1)
+/** Value 2 / 3 (Q31). */
+#define TWO_THIRDS_Q31 ((q31_t)0x55555555)
+/** Value 1 / 3 (Q31). */
+#define ONE_THIRD_Q31 ((q31_t)0x2AAAAAAB)
+
+#if defined(CONFIG_SPINNER_SVM_OVERMOD_I)
+#define SVM_OVERMOD_DEFAULT SVM_OVERMOD_I
+#elif defined(CONFIG_SPINNER_SVM_OVERMOD_II)
+#define SVM_OVERMOD_DEFAULT SVM_OVERMOD_II
+#else
+#define SVM_OVERMOD_DEFAULT SVM_OVERMOD_NONE
+#endif
+
+#if defined(CONFIG_SPINNER_SVM_MODE_DPWMMIN)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWMMIN
+#elif defined(CONFIG_SPINNER_SVM_MODE_DPWMMAX)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWMMAX
+#elif defined(CONFIG_SPINNER_SVM_MODE_DPWM0)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWM0
+#elif defined(CONFIG_SPINNER_SVM_MODE_DPWM1)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWM1
+#elif defined(CONFIG_SPINNER_SVM_MODE_DPWM2)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWM2
+#elif defined(CONFIG_SPINNER_SVM_MODE_DPWM3)
+#define SVM_MODE_DEFAULT SVM_MODE_DPWM3
+#else
+#define SVM_MODE_DEFAULT SVM_MODE_CONTINUOUS
+#endif
+
+/**
+ * Sector lookup table, indexed by the sign bits of the a, b, c vector values
+ * (c < 0) | (a < 0) << 1 | (b < 0) << 2.
+ *
+ * @note Index 7 is not reachable (a + b + c = 0), index 0 only if a = b = c =
+ * 0.
+ */
+static const uint8_t sector_lut[8] = {5U, 1U, 3U, 2U, 5U, 6U, 4U, 5U};
+
+#ifdef CONFIG_SPINNER_SVM_KERNEL_SECTOR
 /**
  * @brief Obtain sector based on a, b, c vector values.
  *
@@ -54,6 +109,275 @@ static uint8_t get_sector(float a, float b, float c)
 	return sector;
 }
 
+/**
+ * @brief Obtain sector based on a, b, c vector values (Q31).
+ *
+ * @param[in] a a component value.
+ * @param[in] b b component value.
+ * @param[in] c c component value.
+
+ * @return Sector (1...6).
+ *
+ * @see get_sector()
+ */
+static uint8_t get_sector_q31(q31_t a, q31_t b, q31_t c)
+{
+	uint8_t sector = 0U;
+
+	if (c < 0) {
+		if (a < 0) {
+			sector = 2U;
+		} else {
+			if (b < 0) {
+				sector = 6U;
+			} else {
+				sector = 1U;
+			}
+		}
+	} else {
+		if (a < 0) {
+			if (b <= 0) {
+				sector = 4U;
+			} else {
+				sector = 3U;
+			}
+		} else {
+			sector = 5U;
+		}
+	}
+
+	return sector;
+}
+#endif /* CONFIG_SPINNER_SVM_KERNEL_SECTOR */
+
+/** @brief Saturating Q31 multiplication. */
+static inline q31_t mul_q31(q31_t x, q31_t y)
+{
+	return clip_q63_to_q31(((q63_t)x * y) >> 31);
+}
+
+/** @brief Saturating Q31 addition. */
+static inline q31_t add_q31(q31_t x, q31_t y)
+{
+	return clip_q63_to_q31((q63_t)x + y);
+}
+
+/** @brief Saturating Q31 negation. */
+static inline q31_t neg_q31(q31_t x)
+{
+	return clip_q63_to_q31(-(q63_t)x);
+}
+
+/**
+ * @brief Limit space vector amplitude to the linear region (sqrt(3) / 2).
+ *
+ * The square root is only computed if the vector exceeds the linear region.
+ *
+ * @param[in, out] va v_alpha value.
+ * @param[in, out] vb v_beta value.
+ */
+static inline void limit(float *va, float *vb)
+{
+	float mod_sq, mod;
+
+	mod_sq = *va * *va + *vb * *vb;
+	if (mod_sq > LIMIT_SQ) {
+		(void)arm_sqrt_f32(mod_sq, &mod);
+		*va = *va / mod * (SQRT_3 / 2.0f);
+		*vb = *vb / mod * (SQRT_3 / 2.0f);
+	}
+}
+
+/**
+ * @brief Limit space vector amplitude to the linear region (Q31).
+ *
+ * @param[in, out] va v_alpha value.
+ * @param[in, out] vb v_beta value.
+ *
+ * @see limit()
+ */
+static inline void limit_q31(q31_t *va, q31_t *vb)
+{
+	q31_t mod_sq, mod;
+
+	/* NOTE: module is computed halved so that it can not saturate */
+	mod_sq = (q31_t)((((q63_t)*va * *va) + ((q63_t)*vb * *vb)) >> 32);
+	if (mod_sq > LIMIT_SQ_HALF_Q31) {
+		(void)arm_sqrt_q31(mod_sq, &mod);
+		*va = (q31_t)(((q63_t)*va * SQRT_3_2_SQRT_2_Q31) / mod);
+		*vb = (q31_t)(((q63_t)*vb * SQRT_3_2_SQRT_2_Q31) / mod);
+	}
+}
+
+/**
+ * @brief Limit space vector amplitude to the hexagon (overmodulation mode I).
+ *
+ * The vector is scaled down, preserving its angle, so that the largest
+ * line-to-line reference (max(|a|, |b|, |c|), 1 on the hexagon boundary) does
+ * not exceed 1. No square root is required.
+ *
+ * @param[in, out] va v_alpha value.
+ * @param[in, out] vb v_beta value.
+ */
+static inline void limit_hex(float *va, float *vb)
+{
+	float a, b, c, span;
+
+	a = *va - 1.0f / SQRT_3 * *vb;
+	b = 2.0f / SQRT_3 * *vb;
+	c = -(a + b);
+
+	span = MAX(fabsf(a), MAX(fabsf(b), fabsf(c)));
+	if (span > 1.0f) {
+		*va = *va / span;
+		*vb = *vb / span;
+	}
+}
+
+/**
+ * @brief Limit space vector amplitude to the hexagon (Q31).
+ *
+ * @param[in, out] va v_alpha value.
+ * @param[in, out] vb v_beta value.
+ *
+ * @see limit_hex()
+ */
+static inline void limit_hex_q31(q31_t *va, q31_t *vb)
+{
+	q31_t a, b, c, span;
+
+	/* NOTE: line-to-line references are computed halved (|a| < 1) */
+	b = mul_q31(*vb, INV_SQRT_3_Q31);
+	a = (*va >> 1) - (b >> 1);
+	c = -(a + b);
+
+	span = MAX(abs(a), MAX(abs(b), abs(c)));
+	if (span > HALF_Q31) {
+		*va = (q31_t)(((q63_t)*va * HALF_Q31) / span);
+		*vb = (q31_t)(((q63_t)*vb * HALF_Q31) / span);
+	}
+}
+
+/**
+ * @brief Decide the clamping rail of a discontinuous mode.
+ *
+ * @param[in] mode Mode.
+ * @param[in] sector Sector.
+ * @param[in] mid_pos Middle phase reference is positive.
+ * @param[in] mid_neg Middle phase reference is negative.
+ * @param[out] hi Clamp to the positive rail (negative otherwise).
+ *
+ * @return true if the mode is discontinuous, false otherwise.
+ */
+static inline bool dpwm_rail(enum svm_mode mode, uint8_t sector, bool mid_pos,
+			     bool mid_neg, bool *hi)
+{
+	switch (mode) {
+	case SVM_MODE_DPWMMIN:
+		*hi = false;
+		break;
+	case SVM_MODE_DPWMMAX:
+		*hi = true;
+		break;
+	case SVM_MODE_DPWM0:
+		/* clamp segments match the sectors */
+		*hi = (sector & 1U) == 0U;
+		break;
+	case SVM_MODE_DPWM1:
+		/* clamp the phase with the largest absolute reference */
+		*hi = mid_neg;
+		break;
+	case SVM_MODE_DPWM2:
+		*hi = (sector & 1U) != 0U;
+		break;
+	case SVM_MODE_DPWM3:
+		/* clamp the phase with the smallest absolute reference */
+		*hi = mid_pos;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Apply the discontinuous modes zero-sequence.
+ *
+ * All duty cycles are shifted so that the highest (lowest) phase is clamped
+ * to 1 (0). Nothing is done if both rails are already reached
+ * (overmodulation).
+ *
+ * @param[in, out] svm SVM instance.
+ */
+static inline void dpwm(svm_t *svm)
+{
+	float d_hi, d_lo, d_mid, shift;
+	bool hi;
+
+	d_hi = MAX(svm->duties.a, MAX(svm->duties.b, svm->duties.c));
+	d_lo = MIN(svm->duties.a, MIN(svm->duties.b, svm->duties.c));
+	if ((d_hi - d_lo) >= 1.0f) {
+		return;
+	}
+
+	d_mid = MAX(MIN(svm->duties.a, svm->duties.b),
+		    MIN(MAX(svm->duties.a, svm->duties.b), svm->duties.c));
+
+	if (!dpwm_rail(svm->mode, svm->sector, d_mid > 0.5f, d_mid < 0.5f,
+		       &hi)) {
+		return;
+	}
+
+	/* keep the sampling window of the two lowest phases */
+	if (hi && ((d_mid + (1.0f - d_hi)) > svm->d_smp)) {
+		hi = false;
+	}
+
+	shift = hi ? (1.0f - d_hi) : -d_lo;
+
+	svm->duties.a += shift;
+	svm->duties.b += shift;
+	svm->duties.c += shift;
+}
+
+/**
+ * @brief Apply the discontinuous modes zero-sequence (Q31).
+ *
+ * @param[in, out] svm SVM instance.
+ *
+ * @see dpwm()
+ */
+static inline void dpwm_q31(svm_q31_t *svm)
+{
+	q31_t d_hi, d_lo, d_mid, shift;
+	bool hi;
+
+	d_hi = MAX(svm->duties.a, MAX(svm->duties.b, svm->duties.c));
+	d_lo = MIN(svm->duties.a, MIN(svm->duties.b, svm->duties.c));
+	if (((q63_t)d_hi - d_lo) >= INT32_MAX) {
+		return;
+	}
+
+	d_mid = MAX(MIN(svm->duties.a, svm->duties.b),
+		    MIN(MAX(svm->duties.a, svm->duties.b), svm->duties.c));
+
+	if (!dpwm_rail(svm->mode, svm->sector, d_mid > HALF_Q31,
+		       d_mid < HALF_Q31, &hi)) {
+		return;
+	}
+
+	if (hi && (((q63_t)d_mid + INT32_MAX - d_hi) > svm->d_smp)) {
+		hi = false;
+	}
+
+	shift = hi ? (INT32_MAX - d_hi) : -d_lo;
+
+	svm->duties.a = add_q31(svm->duties.a, shift);
+	svm->duties.b = add_q31(svm->duties.b, shift);
+	svm->duties.c = add_q31(svm->duties.c, shift);
+}
+
 /*******************************************************************************
  * Public
  ******************************************************************************/
@@ -68,20 +392,32 @@ void svm_init(svm_t *svm)
 
 	svm->d_min = 0.0f;
 	svm->d_max = 1.0f;
+
+	svm->overmod = SVM_OVERMOD_DEFAULT;
+	svm->mode = SVM_MODE_DEFAULT;
+	svm->d_smp = 1.0f;
+	svm->d_dt = 0.0f;
+	svm->k_dt = 0.0f;
+	svm->va = 0.0f;
+	svm->vb = 0.0f;
 }
 
-void svm_set(svm_t *svm, float va, float vb)
+#ifdef CONFIG_SPINNER_SVM_KERNEL_SECTOR
+/**
+ * @brief Compute sector and duty cycles (sector based kernel).
+ *
+ * Duty cycles are not limited, so they may fall outside 0...1 if the vector
+ * exceeds the hexagon.
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ */
+static inline void modulate(svm_t *svm, float va, float vb)
 {
-	float a, b, c, mod;
+	float a, b, c;
 	float x, y, z;
 
-	/* limit maximum amplitude to avoid distortions */
-	(void)arm_sqrt_f32(va * va + vb * vb, &mod);
-	if (mod > SQRT_3 / 2.0f) {
-		va = va / mod * (SQRT_3 / 2.0f);
-		vb = vb / mod * (SQRT_3 / 2.0f);
-	}
-
 	a = va - 1.0f / SQRT_3 * vb;
 	b = 2.0f / SQRT_3 * vb;
 	c = -(a + b);
@@ -152,8 +488,381 @@ void svm_set(svm_t *svm, float va, float vb)
 	default:
 		break;
 	}
+}
+#endif /* CONFIG_SPINNER_SVM_KERNEL_SECTOR */
+
+#ifdef CONFIG_SPINNER_SVM_KERNEL_MINMAX
+/**
+ * @brief Compute sector and duty cycles (min/max kernel).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ *
+ * @see modulate() (sector based kernel)
+ */
+static inline void modulate(svm_t *svm, float va, float vb)
+{
+	float q_a, q_b, q_c, q_max, q_min, q_mid;
+	uint32_t idx;
+
+	/* phase references, scaled so that the linear limit spans 0...1 */
+	q_a = 2.0f / 3.0f * va;
+	q_b = -1.0f / 3.0f * va + 1.0f / SQRT_3 * vb;
+	q_c = -(q_a + q_b);
+
+	/* sector from the sign of (a, b, c) = (q_a - q_b, q_b - q_c, q_c - q_a) */
+	idx = (uint32_t)(q_c < q_a) | ((uint32_t)(q_a < q_b) << 1U) |
+	      ((uint32_t)(q_b < q_c) << 2U);
+	svm->sector = sector_lut[idx];
+
+	/* min/max zero-sequence injection (centers the active vectors) */
+	q_max = MAX(q_a, MAX(q_b, q_c));
+	q_min = MIN(q_a, MIN(q_b, q_c));
+	q_mid = 0.5f - (q_max + q_min) * 0.5f;
+
+	svm->duties.a = q_a + q_mid;
+	svm->duties.b = q_b + q_mid;
+	svm->duties.c = q_c + q_mid;
+}
+#endif /* CONFIG_SPINNER_SVM_KERNEL_MINMAX */
+
+void svm_set(svm_t *svm, float va, float vb)
+{
+	switch (svm->overmod) {
+	case SVM_OVERMOD_I:
+		limit_hex(&va, &vb);
+		break;
+	case SVM_OVERMOD_II:
+		/* duty cycles are clamped below (minimum distance) */
+		break;
+	default:
+		/* limit maximum amplitude to avoid distortions */
+		limit(&va, &vb);
+		break;
+	}
+
+	modulate(svm, va, vb);
+
+	if (svm->mode != SVM_MODE_CONTINUOUS) {
+		dpwm(svm);
+	}
+
+	svm->duties.a = CLAMP(svm->duties.a, svm->d_min, svm->d_max);
+	svm->duties.b = CLAMP(svm->duties.b, svm->d_min, svm->d_max);
+	svm->duties.c = CLAMP(svm->duties.c, svm->d_min, svm->d_max);
+
+	/* applied (average) vector */
+	svm->va = svm->duties.a - (svm->duties.b + svm->duties.c) * 0.5f;
+	svm->vb = (svm->duties.b - svm->duties.c) * (SQRT_3 / 2.0f);
+}
+
+float svm_get_mod_index(const svm_t *svm)
+{
+	float mod;
+
+	(void)arm_sqrt_f32(svm->va * svm->va + svm->vb * svm->vb, &mod);
+
+	return mod * (PI / 3.0f);
+}
+
+uint8_t svm_get_sector(float va, float vb)
+{
+	float t = vb * (1.0f / SQRT_3);
+	uint32_t idx;
+
+	/* a < 0: va < vb / sqrt(3), c < 0: va > -vb / sqrt(3), b < 0: vb < 0 */
+	idx = (uint32_t)(va > -t) | ((uint32_t)(va < t) << 1U) |
+	      ((uint32_t)(vb < 0.0f) << 2U);
+
+	return sector_lut[idx];
+}
+
+void svm_set_dead_time(svm_t *svm, float d_dt, float i_band)
+{
+	svm->d_dt = d_dt;
+	svm->k_dt = (i_band > 0.0f) ? d_dt / i_band : 0.0f;
+}
+
+/**
+ * @brief Compensate dead time in a phase duty cycle.
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] d Duty cycle.
+ * @param[in] i Phase current.
+ *
+ * @return Compensated duty cycle.
+ */
+static inline float comp_dead_time(const svm_t *svm, float d, float i)
+{
+	if ((d <= svm->d_min) || (d >= svm->d_max)) {
+		return d;
+	}
+
+	d += CLAMP(svm->k_dt * i, -svm->d_dt, svm->d_dt);
+
+	return CLAMP(d, svm->d_min, svm->d_max);
+}
+
+void svm_comp_dead_time(svm_t *svm, float i_a, float i_b, float i_c)
+{
+	svm->duties.a = comp_dead_time(svm, svm->duties.a, i_a);
+	svm->duties.b = comp_dead_time(svm, svm->duties.b, i_b);
+	svm->duties.c = comp_dead_time(svm, svm->duties.c, i_c);
+}
+
+void svm_q31_init(svm_q31_t *svm)
+{
+	svm->sector = 0U;
+
+	svm->duties.a = 0;
+	svm->duties.b = 0;
+	svm->duties.c = 0;
+
+	svm->d_min = 0;
+	svm->d_max = INT32_MAX;
+
+	svm->overmod = SVM_OVERMOD_DEFAULT;
+	svm->mode = SVM_MODE_DEFAULT;
+	svm->d_smp = INT32_MAX;
+	svm->d_dt = 0;
+	svm->k_dt = 0;
+	svm->va = 0;
+	svm->vb = 0;
+}
+
+#ifdef CONFIG_SPINNER_SVM_KERNEL_SECTOR
+/**
+ * @brief Compute sector and duty cycles (sector based kernel, Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ *
+ * @see modulate()
+ */
+static inline void modulate_q31(svm_q31_t *svm, q31_t va, q31_t vb)
+{
+	q31_t a, b, c;
+	q31_t x, y, s, d;
+
+	a = add_q31(va, neg_q31(mul_q31(vb, INV_SQRT_3_Q31)));
+	b = add_q31(mul_q31(vb, INV_SQRT_3_Q31), mul_q31(vb, INV_SQRT_3_Q31));
+	c = neg_q31(add_q31(a, b));
+
+	svm->sector = get_sector_q31(a, b, c);
+
+	/* duties are computed as 0.5 +/- (x +/- y) / 2, equivalent to the
+	 * floating point version (z = 1 - (x + y)) but free of overflows.
+	 */
+	switch (svm->sector) {
+	case 1U:
+		x = a;
+		y = b;
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, s);
+		svm->duties.b = add_q31(HALF_Q31, -d);
+		svm->duties.c = add_q31(HALF_Q31, -s);
+
+		break;
+	case 2U:
+		x = neg_q31(c);
+		y = neg_q31(a);
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, d);
+		svm->duties.b = add_q31(HALF_Q31, s);
+		svm->duties.c = add_q31(HALF_Q31, -s);
+
+		break;
+	case 3U:
+		x = b;
+		y = c;
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, -s);
+		svm->duties.b = add_q31(HALF_Q31, s);
+		svm->duties.c = add_q31(HALF_Q31, -d);
+
+		break;
+	case 4U:
+		x = neg_q31(a);
+		y = neg_q31(b);
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, -s);
+		svm->duties.b = add_q31(HALF_Q31, d);
+		svm->duties.c = add_q31(HALF_Q31, s);
+
+		break;
+	case 5U:
+		x = c;
+		y = a;
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, -d);
+		svm->duties.b = add_q31(HALF_Q31, -s);
+		svm->duties.c = add_q31(HALF_Q31, s);
+
+		break;
+	case 6U:
+		x = neg_q31(b);
+		y = neg_q31(c);
+		s = (x >> 1) + (y >> 1);
+		d = (x >> 1) - (y >> 1);
+
+		svm->duties.a = add_q31(HALF_Q31, s);
+		svm->duties.b = add_q31(HALF_Q31, -s);
+		svm->duties.c = add_q31(HALF_Q31, d);
+
+		break;
+	default:
+		break;
+	}
+}
+#endif /* CONFIG_SPINNER_SVM_KERNEL_SECTOR */
+
+#ifdef CONFIG_SPINNER_SVM_KERNEL_MINMAX
+/**
+ * @brief Compute sector and duty cycles (min/max kernel, Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] va v_alpha value.
+ * @param[in] vb v_beta value.
+ *
+ * @see modulate()
+ */
+static inline void modulate_q31(svm_q31_t *svm, q31_t va, q31_t vb)
+{
+	q31_t q_a, q_b, q_c, q_max, q_min, q_mid;
+	uint32_t idx;
+
+	/* phase references (|q| <= 2 / 3 inside the hexagon) */
+	q_a = mul_q31(va, TWO_THIRDS_Q31);
+	q_b = mul_q31(vb, INV_SQRT_3_Q31) - mul_q31(va, ONE_THIRD_Q31);
+	q_c = -(q_a + q_b);
+
+	/* sector from the sign of (a, b, c) = (q_a - q_b, q_b - q_c, q_c - q_a) */
+	idx = (uint32_t)(q_c < q_a) | ((uint32_t)(q_a < q_b) << 1U) |
+	      ((uint32_t)(q_b < q_c) << 2U);
+	svm->sector = sector_lut[idx];
+
+	/* min/max zero-sequence injection (centers the active vectors) */
+	q_max = MAX(q_a, MAX(q_b, q_c));
+	q_min = MIN(q_a, MIN(q_b, q_c));
+	q_mid = HALF_Q31 - ((q_max >> 1) + (q_min >> 1));
+
+	svm->duties.a = add_q31(q_a, q_mid);
+	svm->duties.b = add_q31(q_b, q_mid);
+	svm->duties.c = add_q31(q_c, q_mid);
+}
+#endif /* CONFIG_SPINNER_SVM_KERNEL_MINMAX */
+
+void svm_q31_set(svm_q31_t *svm, q31_t va, q31_t vb)
+{
+	switch (svm->overmod) {
+	case SVM_OVERMOD_I:
+		limit_hex_q31(&va, &vb);
+		modulate_q31(svm, va, vb);
+		break;
+	case SVM_OVERMOD_II:
+		/* modulate the halved vector, so that the kernels can not
+		 * saturate, and scale the result back (d = 2 * d' - 0.5), the
+		 * duty cycles are clamped below (minimum distance)
+		 */
+		modulate_q31(svm, va >> 1, vb >> 1);
+		svm->duties.a = add_q31(svm->duties.a, svm->duties.a - HALF_Q31);
+		svm->duties.b = add_q31(svm->duties.b, svm->duties.b - HALF_Q31);
+		svm->duties.c = add_q31(svm->duties.c, svm->duties.c - HALF_Q31);
+		break;
+	default:
+		/* limit maximum amplitude to avoid distortions */
+		limit_q31(&va, &vb);
+		modulate_q31(svm, va, vb);
+		break;
+	}
+
+	if (svm->mode != SVM_MODE_CONTINUOUS) {
+		dpwm_q31(svm);
+	}
 
 	svm->duties.a = CLAMP(svm->duties.a, svm->d_min, svm->d_max);
 	svm->duties.b = CLAMP(svm->duties.b, svm->d_min, svm->d_max);
 	svm->duties.c = CLAMP(svm->duties.c, svm->d_min, svm->d_max);
+
+	/* applied (average) vector */
+	svm->va = svm->duties.a - (svm->duties.b >> 1) - (svm->duties.c >> 1);
+	svm->vb = mul_q31(svm->duties.b - svm->duties.c, SQRT_3_2_Q31);
+}
+
+float svm_q31_get_mod_index(const svm_q31_t *svm)
+{
+	float va = (float)svm->va / 2147483648.0f;
+	float vb = (float)svm->vb / 2147483648.0f;
+	float mod;
+
+	(void)arm_sqrt_f32(va * va + vb * vb, &mod);
+
+	return mod * (PI / 3.0f);
+}
+
+uint8_t svm_q31_get_sector(q31_t va, q31_t vb)
+{
+	q31_t t = mul_q31(vb, INV_SQRT_3_Q31);
+	uint32_t idx;
+
+	/* see svm_get_sector() */
+	idx = (uint32_t)(va > -t) | ((uint32_t)(va < t) << 1U) |
+	      ((uint32_t)(vb < 0) << 2U);
+
+	return sector_lut[idx];
+}
+
+void svm_q31_set_dead_time(svm_q31_t *svm, float d_dt, float i_band)
+{
+	float k_dt = (i_band > 0.0f) ? d_dt / i_band : 0.0f;
+
+	svm->d_dt = clip_q63_to_q31((q63_t)(d_dt * 2147483648.0f));
+	/* Q24, so that gains up to 128 can be used */
+	svm->k_dt = clip_q63_to_q31((q63_t)(k_dt * 16777216.0f));
+}
+
+/**
+ * @brief Compensate dead time in a phase duty cycle (Q31).
+ *
+ * @param[in] svm SVM instance.
+ * @param[in] d Duty cycle.
+ * @param[in] i Phase current.
+ *
+ * @return Compensated duty cycle.
+ *
+ * @see comp_dead_time()
+ */
+static inline q31_t comp_dead_time_q31(const svm_q31_t *svm, q31_t d, q31_t i)
+{
+	q63_t comp;
+
+	if ((d <= svm->d_min) || (d >= svm->d_max)) {
+		return d;
+	}
+
+	comp = ((q63_t)svm->k_dt * i) >> 24;
+	comp = CLAMP(comp, -(q63_t)svm->d_dt, (q63_t)svm->d_dt);
+
+	return (q31_t)CLAMP((q63_t)d + comp, (q63_t)svm->d_min,
+			    (q63_t)svm->d_max);
+}
+
+void svm_q31_comp_dead_time(svm_q31_t *svm, int32_t i_a, int32_t i_b,
+			    int32_t i_c)
+{
+	svm->duties.a = comp_dead_time_q31(svm, svm->duties.a, i_a);
+	svm->duties.b = comp_dead_time_q31(svm, svm->duties.b, i_b);
+	svm->duties.c = comp_dead_time_q31(svm, svm->duties.c, i_c);
 }
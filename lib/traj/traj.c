@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <spinner/traj/traj.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/**
+ * @brief Trapezoidal profile step.
+ *
+ * The velocity is moved towards the maximum velocity that allows to stop at
+ * the target decelerating at a_max. Since the position is integrated with the
+ * updated velocity, stopping from v = n * a_max * ts takes
+ * v * (v + a_max * ts) / (2 * a_max), which gives the stopping velocity for the
+ * remaining distance.
+ *
+ * @param[in] traj Trajectory generator instance.
+ */
+static void trapezoid_step(traj_t *traj)
+{
+	float e, d, dv_max, v_stop, v_des, dv;
+
+	e = traj->target - traj->p;
+	d = fabsf(e);
+	dv_max = traj->a_max * traj->ts;
+
+	/* close enough and slow enough: stop at the target */
+	if ((d <= dv_max * traj->ts) && (fabsf(traj->v) <= dv_max)) {
+		traj->p = traj->target;
+		traj->v = 0.0f;
+		return;
+	}
+
+	v_stop = sqrtf(0.25f * dv_max * dv_max + 2.0f * traj->a_max * d) -
+		 0.5f * dv_max;
+	v_des = copysignf(fminf(v_stop, traj->v_max), e);
+
+	dv = fminf(fmaxf(v_des - traj->v, -dv_max), dv_max);
+	traj->v += dv;
+	traj->p += traj->v * traj->ts;
+}
+
+/*******************************************************************************
+ * Public
+ ******************************************************************************/
+
+void traj_init(traj_t *traj, float *buf, size_t buf_size, float ts)
+{
+	traj->ts = ts;
+	traj->v_max = 0.0f;
+	traj->a_max = 0.0f;
+
+	traj->buf = buf;
+	traj->buf_size = buf_size;
+	traj->len = 1U;
+
+	traj_reset(traj, 0.0f);
+}
+
+size_t traj_get_filter_len(const struct traj_limits *limits, float ts)
+{
+	float n;
+
+	if (limits->j_max <= 0.0f) {
+		return 1U;
+	}
+
+	/*
+	 * NOTE: the trapezoidal acceleration can change by up to 2 * a_max (from
+	 * accelerating to decelerating), so the filter needs to be twice as long
+	 * as a_max / j_max to keep the jerk limit.
+	 */
+	n = ceilf(2.0f * limits->a_max / (limits->j_max * ts));
+	if (n >= (float)SIZE_MAX) {
+		return SIZE_MAX;
+	}
+
+	return (n < 1.0f) ? 1U : (size_t)n;
+}
+
+int traj_set_limits(traj_t *traj, const struct traj_limits *limits)
+{
+	size_t len;
+
+	if ((limits->v_max <= 0.0f) || (limits->a_max <= 0.0f) ||
+	    (limits->j_max < 0.0f)) {
+		return -EINVAL;
+	}
+
+	len = traj_get_filter_len(limits, traj->ts);
+	if ((len > 1U) && (len > traj->buf_size)) {
+		return -EINVAL;
+	}
+
+	traj->v_max = limits->v_max;
+	traj->a_max = limits->a_max;
+
+	/* filter length change: re-start filter at the output velocity */
+	if (len != traj->len) {
+		traj->len = len;
+		traj->idx = 0U;
+		traj->rest = 0U;
+
+		if (len > 1U) {
+			for (size_t i = 0U; i < len; i++) {
+				traj->buf[i] = traj->v_out;
+			}
+		}
+
+		traj->sum = (float)len * traj->v_out;
+	}
+
+	return 0;
+}
+
+void traj_reset(traj_t *traj, float pos)
+{
+	traj->target = pos;
+	traj->p = pos;
+	traj->v = 0.0f;
+	traj->p_out = pos;
+	traj->v_out = 0.0f;
+	traj->a_out = 0.0f;
+
+	for (size_t i = 0U; (traj->len > 1U) && (i < traj->len); i++) {
+		traj->buf[i] = 0.0f;
+	}
+
+	traj->idx = 0U;
+	traj->sum = 0.0f;
+	traj->rest = traj->len;
+}
+
+void traj_update(traj_t *traj)
+{
+	float v_out;
+
+	trapezoid_step(traj);
+
+	if ((traj->p == traj->target) && (traj->v == 0.0f)) {
+		if (traj->rest < traj->len) {
+			traj->rest++;
+		}
+	} else {
+		traj->rest = 0U;
+	}
+
+	/*
+	 * filter flushed (all zero) at the target: snap output, so that
+	 * rounding residuals are discarded
+	 */
+	if (traj->rest >= traj->len) {
+		traj->sum = 0.0f;
+		traj->p_out = traj->target;
+		traj->a_out = -traj->v_out / traj->ts;
+		traj->v_out = 0.0f;
+		return;
+	}
+
+	/* moving average (S-curve) */
+	if (traj->len > 1U) {
+		traj->sum += traj->v - traj->buf[traj->idx];
+		traj->buf[traj->idx] = traj->v;
+		traj->idx = (traj->idx + 1U) % traj->len;
+		v_out = traj->sum / (float)traj->len;
+	} else {
+		v_out = traj->v;
+	}
+
+	traj->a_out = (v_out - traj->v_out) / traj->ts;
+	traj->v_out = v_out;
+	traj->p_out += v_out * traj->ts;
+}
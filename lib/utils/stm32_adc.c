@@ -149,3 +149,31 @@ int stm32_adc_t_sar_get(uint8_t res_bits, float *t_sar)
 
 	return 0;
 }
+
+uint16_t stm32_adc_read(ADC_TypeDef *adc, uint32_t channel)
+{
+	/* configure sequencer: only one channel */
+	LL_ADC_REG_SetSequencerLength(adc, LL_ADC_REG_SEQ_SCAN_DISABLE);
+	LL_ADC_REG_SetSequencerRanks(adc, LL_ADC_REG_RANK_1, channel);
+
+	/* perform regular conversion */
+	LL_ADC_REG_StartConversion(adc);
+	while (LL_ADC_IsActiveFlag_EOS(adc) != 1U)
+		;
+
+	LL_ADC_ClearFlag_EOS(adc);
+
+	return (uint16_t)LL_ADC_REG_ReadConversionData32(adc);
+}
+
+uint16_t stm32_adc_read_avg(ADC_TypeDef *adc, uint32_t channel,
+			    uint32_t samples)
+{
+	uint32_t acc = 0U;
+
+	for (uint32_t i = 0U; i < samples; i++) {
+		acc += stm32_adc_read(adc, channel);
+	}
+
+	return (uint16_t)((acc + samples / 2U) / samples);
+}
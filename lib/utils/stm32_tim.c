@@ -3,7 +3,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
+
 #include <zephyr/device.h>
+#include <zephyr/sys/util.h>
+
+#include <stm32_ll_tim.h>
 
 #include <spinner/utils/stm32_tim.h>
 
@@ -41,3 +46,61 @@ int stm32_tim_clk_get(const struct stm32_pclken *pclken, uint32_t *tim_clk)
 
 	return 0;
 }
+
+int stm32_tim_dead_time_get(uint32_t tim_clk, uint32_t t_dead, uint32_t *ckd,
+			    uint8_t *dtg)
+{
+	static const uint32_t ckds[] = {
+		LL_TIM_CLOCKDIVISION_DIV1,
+		LL_TIM_CLOCKDIVISION_DIV2,
+		LL_TIM_CLOCKDIVISION_DIV4,
+	};
+
+	for (size_t i = 0U; i < ARRAY_SIZE(ckds); i++) {
+		uint64_t n;
+
+		/* dead time in t_DTS = 2^i / tim_clk units, rounded up */
+		n = DIV_ROUND_UP((uint64_t)t_dead * tim_clk,
+				 1000000000ULL << i);
+
+		/* DTG encoding, see reference manual (TIMx_BDTR) */
+		if (n <= 127U) {
+			*dtg = (uint8_t)n;
+		} else if (n <= 254U) {
+			*dtg = 0x80U | (uint8_t)(DIV_ROUND_UP(n, 2U) - 64U);
+		} else if (n <= 504U) {
+			*dtg = 0xC0U | (uint8_t)(DIV_ROUND_UP(n, 8U) - 32U);
+		} else if (n <= 1008U) {
+			*dtg = 0xE0U | (uint8_t)(DIV_ROUND_UP(n, 16U) - 32U);
+		} else {
+			continue;
+		}
+
+		*ckd = ckds[i];
+
+		return 0;
+	}
+
+	return -EINVAL;
+}
+
+uint32_t stm32_tim_dead_time_ns(uint32_t tim_clk, uint32_t ckd, uint8_t dtg)
+{
+	uint64_t n;
+
+	/* DTG decoding, see reference manual (TIMx_BDTR) */
+	if ((dtg & 0x80U) == 0U) {
+		n = dtg;
+	} else if ((dtg & 0xC0U) == 0x80U) {
+		n = (64U + (dtg & 0x3FU)) * 2U;
+	} else if ((dtg & 0xE0U) == 0xC0U) {
+		n = (32U + (dtg & 0x1FU)) * 8U;
+	} else {
+		n = (32U + (dtg & 0x1FU)) * 16U;
+	}
+
+	/* t_DTS = 2^CKD / tim_clk */
+	n <<= ckd >> TIM_CR1_CKD_Pos;
+
+	return (uint32_t)DIV_ROUND_CLOSEST(n * 1000000000ULL, tim_clk);
+}
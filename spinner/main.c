@@ -4,11 +4,18 @@
  */
 
 #include <spinner/control/cloop.h>
+#include <spinner/control/sloop.h>
 
 int main(void)
 {
-	cloop_start();
-	cloop_set_ref(0.0f, 0.25f);
+	cloop_start(&cloop_default);
+
+#ifdef CONFIG_SPINNER_SLOOP
+	sloop_start();
+	sloop_set_ref(50.0f);
+#else
+	cloop_set_ref(&cloop_default, 0.0f, 0.25f);
+#endif
 
 	return 0;
 }
@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Hot path benchmarks.
+ *
+ * Each kernel is timed on every call (with interrupts locked) over a sweep of
+ * inputs. Results are printed as one JSON object per line:
+ *
+ *   {"bench":"svm_f32","calls":3600,"min":..,"mean":..,"max":..,"max_ns":..}
+ *
+ * where min/mean/max are in cycles (cycle counter overhead subtracted) and
+ * max_ns is the worst case time in nanoseconds (null if the cycle counter rate
+ * is unknown, e.g. native_sim host time stamp counter). The "BENCH END" line
+ * is printed once all benchmarks are completed.
+ */
+
+#include <zephyr/kernel.h>
+
+#include <arm_math.h>
+
+#include <spinner/pi/pi.h>
+#include <spinner/svm/svm.h>
+#include <spinner/utils/cycles.h>
+#include <spinner/utils/mathutil.h>
+#include <spinner/utils/shunt.h>
+
+/*******************************************************************************
+ * Private
+ ******************************************************************************/
+
+/** Number of swept angles. */
+#define N_ANGLES 360U
+
+/** Number of swept magnitudes. */
+#define N_MAGS 10U
+
+/** Maximum swept magnitude (includes the SV-PWM non-linear region). */
+#define MAG_MAX 1.1f
+
+/** Number of PI controllers calls. */
+#define N_PI 6000U
+
+/** PI controllers output limit. */
+#define PI_V_MAX 0.866f
+
+/** PI controllers Q31 gains shift. */
+#define PI_SHIFT 4U
+
+/** Number of shunt reconstruction calls. */
+#define N_SHUNT 6000U
+
+/** Shunt ADC resolution (bits). */
+#define SHUNT_RES 12U
+
+/** @brief Benchmark results. */
+struct bench_result {
+	uint32_t calls;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+};
+
+/** Cycle counter overhead (cycles). */
+static uint32_t overhead;
+
+/** Sink for kernel outputs. */
+static volatile float sink_f32;
+static volatile q31_t sink_q31;
+static volatile int16_t sink_i16;
+
+/**
+ * @brief Time a statement.
+ *
+ * @param r Results.
+ * @param stmt Statement.
+ */
+#define BENCH(r, stmt)                                                         \
+	do {                                                                   \
+		unsigned int key;                                              \
+		uint32_t t0, t1;                                               \
+                                                                               \
+		key = irq_lock();                                              \
+		compiler_barrier();                                            \
+		t0 = cycles_get();                                             \
+		compiler_barrier();                                            \
+		stmt;                                                          \
+		compiler_barrier();                                            \
+		t1 = cycles_get();                                             \
+		compiler_barrier();                                            \
+		irq_unlock(key);                                               \
+                                                                               \
+		result_add(r, t1 - t0);                                        \
+	} while (0)
+
+static void result_init(struct bench_result *r)
+{
+	r->calls = 0U;
+	r->min = UINT32_MAX;
+	r->max = 0U;
+	r->sum = 0U;
+}
+
+static void result_add(struct bench_result *r, uint32_t cycles)
+{
+	cycles = (cycles > overhead) ? (cycles - overhead) : 0U;
+
+	r->calls++;
+	r->min = MIN(r->min, cycles);
+	r->max = MAX(r->max, cycles);
+	r->sum += cycles;
+}
+
+static void result_print(const char *name, const struct bench_result *r)
+{
+	uint32_t rate;
+
+	rate = cycles_get_rate();
+
+	printk("{\"bench\":\"%s\",\"calls\":%u,\"min\":%u,\"mean\":%u,"
+	       "\"max\":%u,\"max_ns\":",
+	       name, r->calls, r->min, (uint32_t)(r->sum / r->calls), r->max);
+
+	if (rate == 0U) {
+		printk("null}\n");
+	} else {
+		printk("%u}\n",
+		       (uint32_t)(((uint64_t)r->max * 1000000000ULL) / rate));
+	}
+}
+
+/**
+ * @brief Obtain swept space vector (alpha, beta) for a given index.
+ *
+ * @param[in] i Sweep index.
+ * @param[out] angle Angle (degrees).
+ * @param[out] mag Magnitude.
+ */
+static void sweep_get(uint32_t i, float *angle, float *mag)
+{
+	*angle = (float)(i % N_ANGLES);
+	*mag = MAG_MAX * (float)(i / N_ANGLES + 1U) / (float)N_MAGS;
+}
+
+/*******************************************************************************
+ * Kernels
+ ******************************************************************************/
+
+/** @brief CMSIS PID pair state (f32). */
+struct pid_f32 {
+	arm_pid_instance_f32 pid_i_d;
+	arm_pid_instance_f32 pid_i_q;
+};
+
+/** @brief CMSIS PID pair state (Q31). */
+struct pid_q31 {
+	arm_pid_instance_q31 pid_i_d;
+	arm_pid_instance_q31 pid_i_q;
+};
+
+/** @brief CMSIS PID pair, without output limit (f32, reference). */
+static __noinline void pid_f32_run(struct pid_f32 *pid, float e_d, float e_q,
+				   float *v_d, float *v_q)
+{
+	*v_d = arm_pid_f32(&pid->pid_i_d, e_d);
+	*v_q = arm_pid_f32(&pid->pid_i_q, e_q);
+}
+
+/** @brief CMSIS PID pair, without output limit (Q31, reference). */
+static __noinline void pid_q31_run(struct pid_q31 *pid, q31_t e_d, q31_t e_q,
+				   q31_t *v_d, q31_t *v_q)
+{
+	*v_d = clip_q63_to_q31((q63_t)arm_pid_q31(&pid->pid_i_d, e_d)
+			       << PI_SHIFT);
+	*v_q = clip_q63_to_q31((q63_t)arm_pid_q31(&pid->pid_i_q, e_q)
+			       << PI_SHIFT);
+}
+
+/** @brief d/q PI controllers, as in the current loop (f32). */
+static __noinline void pi_f32_run(pi_dq_t *pi, float e_d, float e_q,
+				  float *v_d, float *v_q)
+{
+	pi_dq_run(pi, e_d, e_q, v_d, v_q);
+}
+
+/** @brief d/q PI controllers, as in the current loop (Q31). */
+static __noinline void pi_q31_run(pi_dq_q31_t *pi, q31_t e_d, q31_t e_q,
+				  q31_t *v_d, q31_t *v_q)
+{
+	pi_dq_q31_run(pi, e_d, e_q, v_d, v_q);
+}
+
+/**
+ * @brief Current loop math chain, as in the current loop regulation
+ * callback (f32).
+ */
+static __noinline void foc_f32_run(pi_dq_t *pi, float i_a, float i_b,
+				   float eangle, float *v_alpha, float *v_beta)
+{
+	float sin_eangle, cos_eangle;
+	float i_alpha, i_beta, i_d, i_q, v_d, v_q;
+
+	arm_sin_cos_f32(eangle, &sin_eangle, &cos_eangle);
+	arm_clarke_f32(i_a, i_b, &i_alpha, &i_beta);
+	arm_park_f32(i_alpha, i_beta, &i_d, &i_q, sin_eangle, cos_eangle);
+	pi_dq_run(pi, 0.0f - i_d, 0.1f - i_q, &v_d, &v_q);
+	arm_inv_park_f32(v_d, v_q, v_alpha, v_beta, sin_eangle, cos_eangle);
+}
+
+/**
+ * @brief Current loop math chain, as in the current loop regulation
+ * callback (Q31).
+ */
+static __noinline void foc_q31_run(pi_dq_q31_t *pi, q31_t i_a, q31_t i_b,
+				   q31_t eangle, q31_t *v_alpha, q31_t *v_beta)
+{
+	q31_t sin_eangle, cos_eangle;
+	q31_t i_alpha, i_beta, i_d, i_q, v_d, v_q;
+
+	arm_sin_cos_q31(eangle, &sin_eangle, &cos_eangle);
+	arm_clarke_q31(i_a, i_b, &i_alpha, &i_beta);
+	arm_park_q31(i_alpha, i_beta, &i_d, &i_q, sin_eangle, cos_eangle);
+	pi_dq_q31_run(pi, __QSUB(0, i_d), __QSUB(0x0CCCCCCD, i_q), &v_d, &v_q);
+	arm_inv_park_q31(v_d, v_q, v_alpha, v_beta, sin_eangle, cos_eangle);
+}
+
+/** @brief Shunt reconstruction, as in the shunt current sampling driver. */
+static __noinline void shunt_run(uint8_t sector, uint16_t rank1,
+				 uint16_t rank2,
+				 const struct shunt_offsets *offsets,
+				 float *i_a, float *i_b, float *i_c)
+{
+	int16_t i_a_raw, i_b_raw, i_c_raw;
+
+	shunt_get_currents(sector, rank1, rank2, offsets, offsets, &i_a_raw,
+			   &i_b_raw, &i_c_raw);
+
+	*i_a = (float)i_a_raw / (float)BIT(SHUNT_RES);
+	*i_b = (float)i_b_raw / (float)BIT(SHUNT_RES);
+	*i_c = (float)i_c_raw / (float)BIT(SHUNT_RES);
+}
+
+/*******************************************************************************
+ * Benchmarks
+ ******************************************************************************/
+
+static void bench_overhead(void)
+{
+	struct bench_result r;
+
+	overhead = 0U;
+
+	result_init(&r);
+	for (uint32_t i = 0U; i < 1000U; i++) {
+		BENCH(&r, (void)0);
+	}
+
+	overhead = r.min;
+}
+
+static void bench_svm_f32(void)
+{
+	struct bench_result r;
+	svm_t svm;
+
+	svm_init(&svm);
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_ANGLES * N_MAGS; i++) {
+		float angle, mag, sin_angle, cos_angle, v_alpha, v_beta;
+
+		sweep_get(i, &angle, &mag);
+		arm_sin_cos_f32(angle, &sin_angle, &cos_angle);
+		v_alpha = mag * cos_angle;
+		v_beta = mag * sin_angle;
+
+		BENCH(&r, svm_set(&svm, v_alpha, v_beta));
+		sink_f32 = svm.duties.a;
+	}
+
+	result_print("svm_f32", &r);
+}
+
+static void bench_svm_q31(void)
+{
+	struct bench_result r;
+	svm_q31_t svm;
+
+	svm_q31_init(&svm);
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_ANGLES * N_MAGS; i++) {
+		float angle, mag, sin_angle, cos_angle;
+		q31_t v_alpha, v_beta;
+
+		sweep_get(i, &angle, &mag);
+		arm_sin_cos_f32(angle, &sin_angle, &cos_angle);
+		v_alpha = f32_to_q31(mag * cos_angle);
+		v_beta = f32_to_q31(mag * sin_angle);
+
+		BENCH(&r, svm_q31_set(&svm, v_alpha, v_beta));
+		sink_q31 = svm.duties.a;
+	}
+
+	result_print("svm_q31", &r);
+}
+
+static void bench_foc_f32(void)
+{
+	struct bench_result r;
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+
+	pi_dq_init(&pi, PI_V_MAX);
+	pi_dq_coeffs_compute(&c, 1.5f, 0.1f, 1.5f, 0.1f);
+	pi_dq_set_coeffs(&pi, &c);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_ANGLES * N_MAGS; i++) {
+		float angle, mag, sin_angle, cos_angle, i_a, i_b;
+		float v_alpha, v_beta;
+
+		/* i_a, i_b for a current vector at (angle + 90) degrees */
+		sweep_get(i, &angle, &mag);
+		arm_sin_cos_f32(angle, &sin_angle, &cos_angle);
+		i_a = -mag * sin_angle;
+		i_b = mag * (0.5f * sin_angle + 0.8660254f * cos_angle);
+
+		BENCH(&r, foc_f32_run(&pi, i_a, i_b, angle, &v_alpha,
+				      &v_beta));
+		sink_f32 = v_alpha + v_beta;
+	}
+
+	result_print("foc_f32", &r);
+}
+
+static void bench_foc_q31(void)
+{
+	struct bench_result r;
+	struct pi_dq_coeffs_q31 c;
+	pi_dq_q31_t pi;
+
+	pi_dq_q31_init(&pi, f32_to_q31(PI_V_MAX), PI_SHIFT);
+	pi_dq_q31_coeffs_compute(&c, 1.5f, 0.1f, 1.5f, 0.1f, PI_SHIFT);
+	pi_dq_q31_set_coeffs(&pi, &c);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_ANGLES * N_MAGS; i++) {
+		float angle, mag, sin_angle, cos_angle;
+		q31_t i_a, i_b, eangle, v_alpha, v_beta;
+
+		sweep_get(i, &angle, &mag);
+		arm_sin_cos_f32(angle, &sin_angle, &cos_angle);
+		i_a = f32_to_q31(-0.5f * mag * sin_angle);
+		i_b = f32_to_q31(0.5f * mag *
+				 (0.5f * sin_angle + 0.8660254f * cos_angle));
+		/* [0, 360) degrees -> [0, 2^32), wrapping to [-1, 1) */
+		eangle = (q31_t)(uint32_t)(angle * 11930464.711f);
+
+		BENCH(&r, foc_q31_run(&pi, i_a, i_b, eangle, &v_alpha,
+				      &v_beta));
+		sink_q31 = v_alpha + v_beta;
+	}
+
+	result_print("foc_q31", &r);
+}
+
+/**
+ * @brief Obtain the PI errors for the given call.
+ *
+ * Errors sweep a circle whose radius grows up to 1, so that outputs go from
+ * the linear region to saturation (and back, as the sign changes).
+ */
+static void pi_errors_get(uint32_t i, float *e_d, float *e_q)
+{
+	float sin_angle, cos_angle, mag;
+
+	arm_sin_cos_f32((float)(i % N_ANGLES), &sin_angle, &cos_angle);
+	mag = (float)(i % (N_PI / 10U)) / (float)(N_PI / 10U);
+
+	*e_d = 0.2f * mag * cos_angle;
+	*e_q = mag * sin_angle;
+}
+
+static void bench_pid_f32(void)
+{
+	struct bench_result r;
+	struct pid_f32 pid;
+
+	pid.pid_i_d.Kp = 1.5f;
+	pid.pid_i_d.Ki = 0.1f;
+	pid.pid_i_d.Kd = 0.0f;
+	arm_pid_init_f32(&pid.pid_i_d, 1);
+	pid.pid_i_q = pid.pid_i_d;
+	arm_pid_init_f32(&pid.pid_i_q, 1);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_PI; i++) {
+		float e_d, e_q, v_d, v_q;
+
+		pi_errors_get(i, &e_d, &e_q);
+
+		BENCH(&r, pid_f32_run(&pid, e_d, e_q, &v_d, &v_q));
+		sink_f32 = v_d + v_q;
+	}
+
+	result_print("pid_f32", &r);
+}
+
+static void bench_pi_f32(void)
+{
+	struct bench_result r;
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+
+	pi_dq_init(&pi, PI_V_MAX);
+	pi_dq_coeffs_compute(&c, 1.5f, 0.1f, 1.5f, 0.1f);
+	pi_dq_set_coeffs(&pi, &c);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_PI; i++) {
+		float e_d, e_q, v_d, v_q;
+
+		pi_errors_get(i, &e_d, &e_q);
+
+		BENCH(&r, pi_f32_run(&pi, e_d, e_q, &v_d, &v_q));
+		sink_f32 = v_d + v_q;
+	}
+
+	result_print("pi_f32", &r);
+}
+
+static void bench_pid_q31(void)
+{
+	struct bench_result r;
+	struct pid_q31 pid;
+
+	pid.pid_i_d.Kp = f32_to_q31(1.5f / BIT(PI_SHIFT));
+	pid.pid_i_d.Ki = f32_to_q31(0.1f / BIT(PI_SHIFT));
+	pid.pid_i_d.Kd = 0;
+	arm_pid_init_q31(&pid.pid_i_d, 1);
+	pid.pid_i_q = pid.pid_i_d;
+	arm_pid_init_q31(&pid.pid_i_q, 1);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_PI; i++) {
+		float e_d, e_q;
+		q31_t e_d_q31, e_q_q31, v_d, v_q;
+
+		pi_errors_get(i, &e_d, &e_q);
+		e_d_q31 = f32_to_q31(e_d);
+		e_q_q31 = f32_to_q31(e_q);
+
+		BENCH(&r, pid_q31_run(&pid, e_d_q31, e_q_q31, &v_d, &v_q));
+		sink_q31 = v_d + v_q;
+	}
+
+	result_print("pid_q31", &r);
+}
+
+static void bench_pi_q31(void)
+{
+	struct bench_result r;
+	struct pi_dq_coeffs_q31 c;
+	pi_dq_q31_t pi;
+
+	pi_dq_q31_init(&pi, f32_to_q31(PI_V_MAX), PI_SHIFT);
+	pi_dq_q31_coeffs_compute(&c, 1.5f, 0.1f, 1.5f, 0.1f, PI_SHIFT);
+	pi_dq_q31_set_coeffs(&pi, &c);
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_PI; i++) {
+		float e_d, e_q;
+		q31_t e_d_q31, e_q_q31, v_d, v_q;
+
+		pi_errors_get(i, &e_d, &e_q);
+		e_d_q31 = f32_to_q31(e_d);
+		e_q_q31 = f32_to_q31(e_q);
+
+		BENCH(&r, pi_q31_run(&pi, e_d_q31, e_q_q31, &v_d, &v_q));
+		sink_q31 = v_d + v_q;
+	}
+
+	result_print("pi_q31", &r);
+}
+
+static void bench_shunt(void)
+{
+	struct bench_result r;
+	struct shunt_offsets offsets = {
+		.a = BIT(SHUNT_RES - 1U),
+		.b = BIT(SHUNT_RES - 1U) + 3U,
+		.c = BIT(SHUNT_RES - 1U) - 5U,
+	};
+	uint32_t lcg = 1U;
+
+	result_init(&r);
+
+	for (uint32_t i = 0U; i < N_SHUNT; i++) {
+		uint16_t rank1, rank2;
+		float i_a, i_b, i_c;
+
+		lcg = lcg * 1664525U + 1013904223U;
+		rank1 = (uint16_t)((lcg >> 8U) & (BIT(SHUNT_RES) - 1U));
+		rank2 = (uint16_t)((lcg >> 20U) & (BIT(SHUNT_RES) - 1U));
+
+		BENCH(&r, shunt_run((uint8_t)(i % 6U + 1U), rank1, rank2,
+				    &offsets, &i_a, &i_b, &i_c));
+		sink_f32 = i_a + i_b + i_c;
+	}
+
+	result_print("shunt", &r);
+}
+
+int main(void)
+{
+	cycles_init();
+
+	bench_overhead();
+	printk("{\"overhead\":%u,\"rate\":%u}\n", overhead, cycles_get_rate());
+
+	bench_svm_f32();
+	bench_svm_q31();
+	bench_foc_f32();
+	bench_foc_q31();
+	bench_pid_f32();
+	bench_pi_f32();
+	bench_pid_q31();
+	bench_pi_q31();
+	bench_shunt();
+
+	printk("BENCH END\n");
+
+	return 0;
+}
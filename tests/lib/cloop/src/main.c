@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/control/cloop.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/drivers/svpwm.h>
+
+/** Plant device. */
+#define PLANT_NODE DT_PARENT(DT_NODELABEL(currsmp))
+
+/** Second plant device (see app.overlay). */
+#define PLANT2_NODE DT_PARENT(DT_NODELABEL(currsmp2))
+
+/** Motor node. */
+#define MOTOR_NODE DT_NODELABEL(motor)
+
+/** Full-scale current (A). */
+#define I_FS (DT_PROP(DT_NODELABEL(currsmp), i_full_scale_milliamps) * 1e-3f)
+
+/** Torque (q-axis) current reference (relative to full-scale). */
+#define I_Q_REF 0.1f
+
+/** Maximum allowed current tracking error (relative to full-scale). */
+#define I_MAX_ERR 0.005f
+
+static const struct device *plant = DEVICE_DT_GET(PLANT_NODE);
+static const struct device *plant2 = DEVICE_DT_GET(PLANT2_NODE);
+
+/** Second current loop instance. */
+static cloop_t cloop2;
+
+/**
+ * @brief Test that the current loop tracks the current references.
+ *
+ * The loop is run against the simulated plant, so that the motor accelerates
+ * until friction compensates the electromagnetic torque. Currents must track
+ * the references while accelerating and at steady state, where the speed must
+ * match w_m = 3/2 * p * flux * i_q / b.
+ */
+ZTEST(lib_cloop, test_tracking)
+{
+	struct pmsm pmsm;
+	float w_m;
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+
+	/* accelerating */
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+	zassert_true(pmsm.w_m > 0.0f);
+
+	/* steady state (> 5 mechanical time constants) */
+	k_sleep(K_MSEC(1500));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+
+	w_m = 1.5f * pmsm.params.pole_pairs * pmsm.params.flux * I_Q_REF *
+	      I_FS / pmsm.params.b;
+	zassert_within(pmsm.w_m, w_m, 0.02f * w_m);
+}
+
+/**
+ * @brief Test that stopping the current loop releases the motor.
+ */
+ZTEST(lib_cloop, test_stop)
+{
+	struct pmsm pmsm;
+	float w_m;
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(50));
+
+	cloop_stop(&cloop_default);
+	k_sleep(K_MSEC(1));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_equal(pmsm.i_q, 0.0f);
+	zassert_equal(pmsm.i_d, 0.0f);
+	zassert_true(pmsm.w_m > 0.0f);
+
+	/* motor coasts */
+	w_m = pmsm.w_m;
+	k_sleep(K_MSEC(10));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(pmsm.w_m < w_m);
+}
+
+/**
+ * @brief Test that current references are limited to i_max.
+ */
+ZTEST(lib_cloop, test_i_max)
+{
+	struct pmsm pmsm;
+
+	cloop_start(&cloop_default);
+	cloop_set_i_max(&cloop_default, I_Q_REF / 2.0f);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF / 2.0f) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+}
+
+/**
+ * @brief Test that references can be streamed at the regulation rate.
+ *
+ * The q-axis reference is ramped in small steps at ~10 kHz while gains are
+ * also being updated (with the same values), which must not disturb the
+ * regulation.
+ */
+ZTEST(lib_cloop, test_stream)
+{
+	struct cloop_gains gains;
+	struct pmsm pmsm;
+
+	cloop_get_gains(&cloop_default, &gains);
+	cloop_start(&cloop_default);
+
+	for (uint32_t i = 0U; i <= 200U; i++) {
+		cloop_set_ref(&cloop_default, 0.0f,
+			      I_Q_REF * (float)i / 200.0f);
+		cloop_set_gains(&cloop_default, &gains);
+		k_sleep(K_USEC(100));
+	}
+
+	k_sleep(K_MSEC(5));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+}
+
+/**
+ * @brief Test the current loop scope.
+ *
+ * A capture is triggered by i_q crossing half of its reference, so that
+ * pre-trigger samples are below the level and the capture ends at steady
+ * state. A streaming capture is also done, checking that no samples are lost
+ * when reading at a sufficient rate.
+ */
+ZTEST(lib_cloop, test_scope)
+{
+#ifdef CONFIG_SPINNER_CLOOP_SCOPE
+	struct cloop_scope_config config = {
+		.signals = BIT(CLOOP_SCOPE_SIGNAL_I_Q) |
+			   BIT(CLOOP_SCOPE_SIGNAL_SECTOR),
+		.decimation = 1U,
+		.trig = CLOOP_SCOPE_TRIG_RISING,
+		.trig_signal = CLOOP_SCOPE_SIGNAL_I_Q,
+		.trig_level = (int16_t)(I_Q_REF / 2.0f * 32768.0f),
+		.pre = 50U,
+		.post = 200U,
+	};
+	static int16_t samples[250U][2U];
+	uint32_t total;
+	size_t len;
+
+	zassert_equal(cloop_scope_get_state(), CLOOP_SCOPE_STATE_IDLE);
+
+	zassert_equal(cloop_scope_start(&config), 0);
+	zassert_equal(cloop_scope_get_sample_size(), 2U * sizeof(int16_t));
+	zassert_equal(cloop_scope_get_state(), CLOOP_SCOPE_STATE_ARMED);
+
+	cloop_start(&cloop_default);
+	k_sleep(K_MSEC(10));
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(50));
+
+	zassert_equal(cloop_scope_get_state(), CLOOP_SCOPE_STATE_DONE);
+
+	len = cloop_scope_read(samples, sizeof(samples));
+	zassert_equal(len, sizeof(samples));
+	zassert_equal(cloop_scope_read(samples, sizeof(samples)), 0U);
+
+	zassert_true(samples[config.pre - 1U][0] < config.trig_level);
+	zassert_true(samples[config.pre][0] >= config.trig_level);
+	zassert_within(samples[ARRAY_SIZE(samples) - 1U][0] / 32768.0f,
+		       I_Q_REF, I_MAX_ERR);
+
+	for (size_t i = 0U; i < ARRAY_SIZE(samples); i++) {
+		zassert_true((samples[i][1] >= 1) && (samples[i][1] <= 6));
+	}
+
+	/* streaming */
+	config.trig = CLOOP_SCOPE_TRIG_NONE;
+	zassert_equal(cloop_scope_start(&config), 0);
+	zassert_equal(cloop_scope_get_state(), CLOOP_SCOPE_STATE_STREAMING);
+
+	total = 0U;
+	for (uint32_t i = 0U; i < 20U; i++) {
+		k_sleep(K_MSEC(5));
+		total += cloop_scope_read(samples, sizeof(samples)) /
+			 cloop_scope_get_sample_size();
+	}
+
+	cloop_scope_stop();
+	zassert_equal(cloop_scope_get_state(), CLOOP_SCOPE_STATE_IDLE);
+	zassert_equal(cloop_scope_get_overruns(), 0U);
+	zassert_true(total > 0U);
+#else
+	ztest_test_skip();
+#endif
+}
+
+/**
+ * @brief Test that the decoupling feedforward removes the speed dependent
+ * terms.
+ *
+ * Integral gains are disabled, so that the steady state current error is only
+ * due to the voltages not provided by the feedforward (back-EMF, resistive and
+ * cross-coupling). Error must be much lower once motor parameters are set.
+ */
+ZTEST(lib_cloop, test_decoupling)
+{
+#ifdef CONFIG_SPINNER_CLOOP_DECOUPLING
+	struct cloop_gains gains, gains_p;
+	struct cloop_motor motor = {
+		.r = DT_PROP(MOTOR_NODE, resistance_micro_ohms) * 1e-6f,
+		.l_d = DT_PROP(MOTOR_NODE, inductance_d_nano_henries) * 1e-9f,
+		.l_q = DT_PROP(MOTOR_NODE, inductance_q_nano_henries) * 1e-9f,
+		.flux = DT_PROP(MOTOR_NODE, flux_linkage_micro_webers) * 1e-6f,
+		.i_fs = I_FS,
+		.v_bus = DT_PROP(PLANT_NODE, v_bus_millivolts) * 1e-3f,
+	};
+	struct pmsm pmsm;
+	float err, err_dec;
+
+	cloop_get_gains(&cloop_default, &gains);
+	gains_p = gains;
+	gains_p.t_ki = 0.0f;
+	gains_p.f_ki = 0.0f;
+	cloop_set_gains(&cloop_default, &gains_p);
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(1500));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	err = hypotf(pmsm.i_d / I_FS, pmsm.i_q / I_FS - I_Q_REF);
+
+	zassert_ok(cloop_set_motor(&cloop_default, &motor));
+	k_sleep(K_MSEC(1500));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	err_dec = hypotf(pmsm.i_d / I_FS, pmsm.i_q / I_FS - I_Q_REF);
+
+	zassert_true(pmsm.w_m > 0.0f);
+	zassert_true(err_dec < err / 4.0f);
+
+	zassert_ok(cloop_set_motor(&cloop_default,
+				   &(const struct cloop_motor){0}));
+	cloop_set_gains(&cloop_default, &gains);
+#else
+	ztest_test_skip();
+#endif
+}
+
+/**
+ * @brief Test that motor parameters are identified.
+ *
+ * Identified parameters must match the simulated motor, and be stored as the
+ * current loop motor parameters. The current loop must regulate again once
+ * the identification finishes.
+ */
+ZTEST(lib_cloop, test_ident)
+{
+#ifdef CONFIG_SPINNER_CLOOP_IDENT
+	const struct cloop_ident_config config = {
+		.i_test = 0.1f,
+		.v_hf = 0.05f,
+		.speed = 50.0f,
+		.i_fs = I_FS,
+		.v_bus = DT_PROP(PLANT_NODE, v_bus_millivolts) * 1e-3f,
+	};
+	float r = DT_PROP(MOTOR_NODE, resistance_micro_ohms) * 1e-6f;
+	float l_d = DT_PROP(MOTOR_NODE, inductance_d_nano_henries) * 1e-9f;
+	float l_q = DT_PROP(MOTOR_NODE, inductance_q_nano_henries) * 1e-9f;
+	float flux = DT_PROP(MOTOR_NODE, flux_linkage_micro_webers) * 1e-6f;
+	struct cloop_motor motor, stored;
+	struct pmsm pmsm;
+
+	zassert_ok(cloop_ident_run(&cloop_default, &config, &motor));
+
+	zassert_within(motor.r, r, 0.05f * r);
+	zassert_within(motor.l_d, l_d, 0.05f * l_d);
+	zassert_within(motor.l_q, l_q, 0.05f * l_q);
+	zassert_within(motor.flux, flux, 0.05f * flux);
+
+	cloop_get_motor(&cloop_default, &stored);
+	zassert_mem_equal(&stored, &motor, sizeof(motor));
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+
+	zassert_ok(cloop_set_motor(&cloop_default,
+				   &(const struct cloop_motor){0}));
+#else
+	ztest_test_skip();
+#endif
+}
+
+/**
+ * @brief Test that gains are computed from the motor parameters and bandwidth.
+ *
+ * At low bandwidths, gains must match the continuous time design
+ * (kp = w * L, ki = w * R * Ts, normalized). Gains must follow motor
+ * parameters changes until they are explicitly set, and the loop must track
+ * the references with the computed gains.
+ */
+ZTEST(lib_cloop, test_bandwidth)
+{
+	struct cloop_gains gains, gains_bw, gains_r;
+	struct cloop_motor stored;
+	struct cloop_motor motor = {
+		.r = DT_PROP(MOTOR_NODE, resistance_micro_ohms) * 1e-6f,
+		.l_d = DT_PROP(MOTOR_NODE, inductance_d_nano_henries) * 1e-9f,
+		.l_q = DT_PROP(MOTOR_NODE, inductance_q_nano_henries) * 1e-9f,
+		.flux = DT_PROP(MOTOR_NODE, flux_linkage_micro_webers) * 1e-6f,
+		.i_fs = I_FS,
+		.v_bus = DT_PROP(PLANT_NODE, v_bus_millivolts) * 1e-3f,
+	};
+	uint32_t f_pwm = svpwm_get_freq(DEVICE_DT_GET(DT_NODELABEL(svpwm)));
+	float k = motor.i_fs / (motor.v_bus * 2.0f / 3.0f);
+	float bw, w, kp_q, kp_d, ki;
+	struct pmsm pmsm;
+
+	cloop_get_gains(&cloop_default, &gains);
+
+	/* motor parameters not set */
+	zassert_equal(cloop_set_bandwidth(&cloop_default, f_pwm / 20.0f),
+		      -EINVAL);
+
+	/* low bandwidth: continuous time design */
+	bw = f_pwm / 100.0f;
+	w = 2.0f * PI * bw;
+	kp_q = w * k * motor.l_q;
+	kp_d = w * k * motor.l_d;
+	ki = w * k * motor.r / f_pwm;
+	zassert_ok(cloop_gains_compute(&gains_bw, &motor, bw, f_pwm));
+	zassert_within(gains_bw.t_kp, kp_q, 0.1f * kp_q);
+	zassert_within(gains_bw.f_kp, kp_d, 0.1f * kp_d);
+	zassert_within(gains_bw.t_ki, ki, 0.1f * ki);
+	zassert_within(gains_bw.f_ki, ki, 0.1f * ki);
+
+	/* out of range */
+	zassert_equal(cloop_gains_compute(&gains_bw, &motor, f_pwm, f_pwm),
+		      -EINVAL);
+
+	zassert_ok(cloop_set_motor(&cloop_default, &motor));
+	zassert_ok(cloop_set_bandwidth(&cloop_default, f_pwm / 20.0f));
+	cloop_get_gains(&cloop_default, &gains_bw);
+	zassert_true(gains_bw.t_kp > 0.0f);
+	zassert_true(gains_bw.t_ki > 0.0f);
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+
+	/* gains follow motor parameters (ki proportional to R) */
+	motor.r *= 2.0f;
+	zassert_ok(cloop_set_motor(&cloop_default, &motor));
+	cloop_get_gains(&cloop_default, &gains_r);
+	zassert_within(gains_r.t_ki, 2.0f * gains_bw.t_ki,
+		       1e-3f * gains_bw.t_ki);
+
+	/* parameters not allowing to compute gains are not applied */
+	zassert_equal(cloop_set_motor(&cloop_default,
+				      &(const struct cloop_motor){0}),
+		      -EINVAL);
+	cloop_get_motor(&cloop_default, &stored);
+	zassert_mem_equal(&stored, &motor, sizeof(motor));
+	cloop_get_gains(&cloop_default, &gains_bw);
+	zassert_mem_equal(&gains_bw, &gains_r, sizeof(gains_r));
+
+	/* explicitly set gains are kept */
+	cloop_set_gains(&cloop_default, &gains);
+	zassert_ok(cloop_set_motor(&cloop_default,
+				   &(const struct cloop_motor){0}));
+	cloop_get_gains(&cloop_default, &gains_r);
+	zassert_mem_equal(&gains_r, &gains, sizeof(gains));
+}
+
+/**
+ * @brief Test that two current loop instances regulate independently.
+ *
+ * Each instance drives its own plant, with opposite references, so that any
+ * shared state (devices, references or PI integrators) would show up as a
+ * tracking error on either motor.
+ */
+ZTEST(lib_cloop, test_multi_instance)
+{
+	struct pmsm pmsm;
+
+	cloop_start(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, I_Q_REF);
+	cloop_start(&cloop2);
+	cloop_set_ref(&cloop2, 0.0f, -I_Q_REF / 2.0f);
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+	zassert_true(pmsm.w_m > 0.0f);
+
+	pmsm_sim_get_state(plant2, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS + I_Q_REF / 2.0f) < I_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+	zassert_true(pmsm.w_m < 0.0f);
+
+	/* stopping one instance must not affect the other */
+	cloop_stop(&cloop2);
+	k_sleep(K_MSEC(1));
+
+	pmsm_sim_get_state(plant2, &pmsm);
+	zassert_equal(pmsm.i_q, 0.0f);
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - I_Q_REF) < I_MAX_ERR);
+}
+
+/**
+ * @brief Test that initializing an instance with devices not ready fails.
+ */
+ZTEST(lib_cloop, test_init_not_ready)
+{
+	const struct device *feedback = DEVICE_DT_GET(DT_NODELABEL(feedback2));
+	const struct device *svpwm = DEVICE_DT_GET(DT_NODELABEL(svpwm2));
+	cloop_t cloop;
+
+	zassert_equal(cloop_init(&cloop, NULL, feedback, svpwm), -ENODEV);
+}
+
+static void *lib_cloop_setup(void)
+{
+	zassert_ok(cloop_init(&cloop2, DEVICE_DT_GET(DT_NODELABEL(currsmp2)),
+			      DEVICE_DT_GET(DT_NODELABEL(feedback2)),
+			      DEVICE_DT_GET(DT_NODELABEL(svpwm2))));
+
+	return NULL;
+}
+
+static void lib_cloop_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	cloop_stop(&cloop2);
+	cloop_set_ref(&cloop2, 0.0f, 0.0f);
+
+	cloop_stop(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, 0.0f);
+	cloop_set_i_max(&cloop_default, 1.0f);
+
+	/* wait for the motor to (almost) stop */
+	k_sleep(K_SECONDS(2));
+}
+
+ZTEST_SUITE(lib_cloop, NULL, lib_cloop_setup, NULL, lib_cloop_after, NULL);
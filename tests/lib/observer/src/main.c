@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/observer/flux.h>
+#include <spinner/sim/pmsm.h>
+#include <spinner/utils/mathutil.h>
+
+/** Update period (s). */
+#define TS 1.0e-4f
+
+/** Torque (q-axis) current (A). */
+#define I_Q 1.0f
+
+/** Maximum angle error after convergence (degrees). */
+#define ANGLE_MAX_ERR 3.0f
+/** Maximum speed error after convergence (relative). */
+#define SPEED_MAX_ERR 0.02f
+
+/** Motor parameters (same as the native_sim board motor). */
+static const struct pmsm_params params = {
+	.pole_pairs = 4U,
+	.r = 0.5f,
+	.l_d = 500e-6f,
+	.l_q = 500e-6f,
+	.flux = 5e-3f,
+	/* constant speed */
+	.j = 0.0f,
+};
+
+/** Observer parameters. */
+static const struct flux_obs_params obs_params = {
+	.r = 0.5f,
+	.l = 500e-6f,
+	.flux = 5e-3f,
+	.gain = 1000.0f,
+	.ts = TS,
+	.pll_bw = 20.0f,
+};
+
+/** Angle difference, wrapped to [-180, 180). */
+static float angle_diff(float a, float b)
+{
+	float d = fmodf(a - b, 360.0f);
+
+	if (d >= 180.0f) {
+		d -= 360.0f;
+	} else if (d < -180.0f) {
+		d += 360.0f;
+	}
+
+	return d;
+}
+
+/**
+ * @brief Run the observer against the PMSM model.
+ *
+ * The motor is fed with the voltages that keep i_d = 0 and i_q = I_Q at
+ * steady state (using the true angle), so that the observer is validated
+ * independently of any control loop.
+ *
+ * @param pmsm PMSM model.
+ * @param obs Observer.
+ * @param steps Number of update periods.
+ */
+static void run(struct pmsm *pmsm, flux_obs_t *obs, uint32_t steps)
+{
+	for (uint32_t i = 0U; i < steps; i++) {
+		float i_a, i_b, i_c, i_alpha, i_beta;
+		float w_e, v_d, v_q, v_alpha, v_beta;
+
+		pmsm_get_currents(pmsm, &i_a, &i_b, &i_c);
+		i_alpha = i_a;
+		i_beta = (i_b - i_c) / sqrtf(3.0f);
+
+		w_e = pmsm_get_espeed(pmsm);
+		v_d = -w_e * params.l_q * I_Q;
+		v_q = params.r * I_Q + w_e * params.flux;
+		v_alpha = v_d * cosf(pmsm->theta_e) - v_q * sinf(pmsm->theta_e);
+		v_beta = v_d * sinf(pmsm->theta_e) + v_q * cosf(pmsm->theta_e);
+
+		flux_obs_update(obs, i_alpha, i_beta, v_alpha, v_beta);
+		pmsm_step(pmsm, v_alpha, v_beta, TS);
+	}
+}
+
+/**
+ * @brief Test that angle and speed converge, in both directions.
+ *
+ * The observer starts with a large angle error (motor spinning at an unknown
+ * angle).
+ */
+ZTEST(lib_observer, test_track)
+{
+	static const float speeds[] = {100.0f, 500.0f, -200.0f};
+
+	for (size_t i = 0U; i < ARRAY_SIZE(speeds); i++) {
+		struct pmsm pmsm;
+		flux_obs_t obs;
+		float espeed;
+
+		pmsm_init(&pmsm, &params);
+		pmsm_set_speed(&pmsm, speeds[i]);
+		pmsm.theta_e = 2.0f;
+
+		flux_obs_init(&obs, &obs_params);
+		zassert_equal(flux_obs_get_eangle(&obs), 0.0f);
+		zassert_equal(flux_obs_get_speed(&obs), 0.0f);
+
+		run(&pmsm, &obs, 5000U);
+
+		zassert_within(angle_diff(flux_obs_get_eangle(&obs),
+					  pmsm.theta_e * 360.0f / TWO_PI),
+			       0.0f, ANGLE_MAX_ERR);
+
+		espeed = pmsm_get_espeed(&pmsm) / TWO_PI;
+		zassert_within(flux_obs_get_speed(&obs), espeed,
+			       fabsf(espeed) * SPEED_MAX_ERR);
+	}
+}
+
+/**
+ * @brief Test that a resistance mismatch only causes a small angle error.
+ */
+ZTEST(lib_observer, test_mismatch)
+{
+	struct flux_obs_params mismatch = obs_params;
+	struct pmsm pmsm;
+	flux_obs_t obs;
+
+	mismatch.r *= 1.2f;
+
+	pmsm_init(&pmsm, &params);
+	pmsm_set_speed(&pmsm, 200.0f);
+
+	flux_obs_init(&obs, &mismatch);
+	run(&pmsm, &obs, 5000U);
+
+	zassert_within(angle_diff(flux_obs_get_eangle(&obs),
+				  pmsm.theta_e * 360.0f / TWO_PI),
+		       0.0f, 3.0f * ANGLE_MAX_ERR);
+}
+
+ZTEST_SUITE(lib_observer, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/pi/pi.h>
+
+/** Output limit (linear modulation limit). */
+#define V_MAX 0.866f
+/** Proportional gain. */
+#define KP 1.5f
+/** Integral gain (per sample). */
+#define KI 0.1f
+/** Q31 gains shift. */
+#define SHIFT 4U
+
+/** Maximum Q31 vs f32 output error. */
+#define Q31_MAX_ERR 1e-4f
+
+/** Float to Q31. */
+static q31_t to_q31(float x)
+{
+	return clip_q63_to_q31((q63_t)(x * 2147483648.0f));
+}
+
+/** Q31 to float. */
+static float to_f32(q31_t x)
+{
+	return (float)x / 2147483648.0f;
+}
+
+/**
+ * @brief Test that outputs match an unlimited PI while not saturated.
+ */
+ZTEST(lib_pi, test_linear)
+{
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+	float v_d, v_q, integ_d = 0.0f, integ_q = 0.0f;
+
+	pi_dq_init(&pi, V_MAX);
+	pi_dq_coeffs_compute(&c, KP, KI, 2.0f * KP, 2.0f * KI);
+	pi_dq_set_coeffs(&pi, &c);
+
+	for (int n = 0; n < 100; n++) {
+		float e_d = 0.05f * sinf(0.1f * n);
+		float e_q = 0.05f * cosf(0.1f * n);
+
+		integ_d += KI * e_d;
+		integ_q += 2.0f * KI * e_q;
+
+		pi_dq_run(&pi, e_d, e_q, &v_d, &v_q);
+
+		zassert_within(v_d, KP * e_d + integ_d, 1e-5f);
+		zassert_within(v_q, 2.0f * KP * e_q + integ_q, 1e-5f);
+	}
+}
+
+/**
+ * @brief Test the circular output limit, with d-axis priority.
+ */
+ZTEST(lib_pi, test_limit)
+{
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+	float v_d, v_q;
+
+	pi_dq_init(&pi, V_MAX);
+	pi_dq_coeffs_compute(&c, KP, 0.0f, KP, 0.0f);
+	pi_dq_set_coeffs(&pi, &c);
+
+	/* q-axis limited to the remaining amplitude */
+	pi_dq_run(&pi, 0.3f / KP, 1.0f / KP, &v_d, &v_q);
+	zassert_within(v_d, 0.3f, 1e-6f);
+	zassert_within(v_q, sqrtf(V_MAX * V_MAX - 0.3f * 0.3f), 1e-6f);
+
+	pi_dq_run(&pi, -0.3f / KP, -1.0f / KP, &v_d, &v_q);
+	zassert_within(v_d, -0.3f, 1e-6f);
+	zassert_within(v_q, -sqrtf(V_MAX * V_MAX - 0.3f * 0.3f), 1e-6f);
+
+	/* d-axis saturated: no room left for the q-axis */
+	pi_dq_run(&pi, 1.0f, 1.0f, &v_d, &v_q);
+	zassert_within(v_d, V_MAX, 1e-6f);
+	zassert_within(v_q, 0.0f, 1e-3f);
+
+	/* inside the circle: not limited */
+	pi_dq_run(&pi, 0.4f / KP, 0.4f / KP, &v_d, &v_q);
+	zassert_within(v_d, 0.4f, 1e-6f);
+	zassert_within(v_q, 0.4f, 1e-6f);
+}
+
+/**
+ * @brief Test that feedforward terms are added before the limit.
+ */
+ZTEST(lib_pi, test_ff)
+{
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+	float v_d, v_q;
+
+	pi_dq_init(&pi, V_MAX);
+	pi_dq_coeffs_compute(&c, KP, KI, KP, KI);
+	pi_dq_set_coeffs(&pi, &c);
+
+	pi_dq_run_ff(&pi, 0.0f, 0.0f, -0.2f, 0.5f, &v_d, &v_q);
+	zassert_within(v_d, -0.2f, 1e-6f);
+	zassert_within(v_q, 0.5f, 1e-6f);
+
+	/* feedforward beyond the limit: integrators must not wind up */
+	for (int n = 0; n < 1000; n++) {
+		pi_dq_run_ff(&pi, 0.0f, 0.1f, 0.0f, 1.0f, &v_d, &v_q);
+	}
+
+	zassert_within(v_q, V_MAX, 1e-6f);
+	zassert_true(pi.i_q < 0.0f);
+}
+
+/**
+ * @brief Test that integrators do not wind up while saturated.
+ *
+ * After a long saturation, the output must leave the limit as soon as the
+ * error changes sign.
+ */
+ZTEST(lib_pi, test_windup)
+{
+	struct pi_dq_coeffs c;
+	pi_dq_t pi;
+	float v_d, v_q;
+
+	pi_dq_init(&pi, V_MAX);
+	pi_dq_coeffs_compute(&c, KP, KI, KP, KI);
+	pi_dq_set_coeffs(&pi, &c);
+
+	for (int n = 0; n < 10000; n++) {
+		pi_dq_run(&pi, 0.0f, 1.0f, &v_d, &v_q);
+		zassert_true(hypotf(v_d, v_q) <= V_MAX + 1e-6f);
+	}
+
+	zassert_within(v_q, V_MAX, 1e-6f);
+	zassert_true(pi.i_q <= V_MAX);
+
+	pi_dq_run(&pi, 0.0f, -0.1f, &v_d, &v_q);
+	zassert_true(v_q < V_MAX - KP * 0.1f + 1e-3f);
+}
+
+/**
+ * @brief Test the single PI controller.
+ *
+ * Output must match an unlimited PI while not saturated, be limited to
+ * +/-limit (including the feedforward), and leave the limit as soon as the
+ * error changes sign after a long saturation.
+ */
+ZTEST(lib_pi, test_single)
+{
+	struct pi_coeffs c;
+	pi_t pi;
+	float v, integ = 0.0f;
+
+	pi_init(&pi, V_MAX);
+	pi_coeffs_compute(&c, KP, KI);
+	pi_set_coeffs(&pi, &c);
+
+	for (int n = 0; n < 100; n++) {
+		float e = 0.05f * sinf(0.1f * n);
+
+		integ += KI * e;
+		v = pi_run(&pi, e);
+		zassert_within(v, KP * e + integ, 1e-5f);
+	}
+
+	pi_reset(&pi, 0.0f);
+	zassert_within(pi_run_ff(&pi, 0.0f, 1.0f), V_MAX, 1e-6f);
+	zassert_within(pi_run_ff(&pi, 0.0f, -1.0f), -V_MAX, 1e-6f);
+
+	for (int n = 0; n < 10000; n++) {
+		v = pi_run(&pi, 1.0f);
+		zassert_true(fabsf(v) <= V_MAX + 1e-6f);
+	}
+
+	zassert_within(v, V_MAX, 1e-6f);
+	zassert_true(pi.i <= V_MAX);
+
+	v = pi_run(&pi, -0.1f);
+	zassert_true(v < V_MAX - KP * 0.1f + 1e-3f);
+}
+
+/**
+ * @brief Test that the Q31 variant matches the f32 one.
+ */
+ZTEST(lib_pi, test_q31)
+{
+	struct pi_dq_coeffs c;
+	struct pi_dq_coeffs_q31 c_q31;
+	pi_dq_t pi;
+	pi_dq_q31_t pi_q31;
+	float v_d, v_q;
+	q31_t v_d_q31, v_q_q31;
+
+	pi_dq_init(&pi, V_MAX);
+	pi_dq_coeffs_compute(&c, KP, KI, 2.0f * KP, 2.0f * KI);
+	pi_dq_set_coeffs(&pi, &c);
+
+	pi_dq_q31_init(&pi_q31, to_q31(V_MAX), SHIFT);
+	pi_dq_q31_coeffs_compute(&c_q31, KP, KI, 2.0f * KP, 2.0f * KI, SHIFT);
+	pi_dq_q31_set_coeffs(&pi_q31, &c_q31);
+
+	/* sweep through the linear and saturated regions */
+	for (int n = 0; n < 1000; n++) {
+		float e_d = 0.2f * sinf(0.01f * n);
+		float e_q = 0.5f * cosf(0.013f * n);
+
+		pi_dq_run(&pi, e_d, e_q, &v_d, &v_q);
+		pi_dq_q31_run(&pi_q31, to_q31(e_d), to_q31(e_q), &v_d_q31,
+			      &v_q_q31);
+
+		zassert_within(to_f32(v_d_q31), v_d, Q31_MAX_ERR);
+		zassert_within(to_f32(v_q_q31), v_q, Q31_MAX_ERR);
+	}
+}
+
+ZTEST_SUITE(lib_pi, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/pll/pll.h>
+
+/** Update period (s). */
+#define TS 1.0e-4f
+/** Bandwidth (Hz). */
+#define BW 20.0f
+/** Timeout (s). */
+#define TIMEOUT 0.1f
+/** Event resolution (degrees, e.g. Hall sensors). */
+#define RES 60.0f
+
+/** Maximum speed error after settling (relative). */
+#define SPEED_MAX_ERR 0.01f
+/** Maximum angle error after settling (degrees). */
+#define ANGLE_MAX_ERR 5.0f
+
+/** Degrees to Q31 angle. */
+static int32_t deg_to_q31(float deg)
+{
+	return (int32_t)(uint32_t)(uint64_t)(fmodf(deg + 360.0f, 360.0f) *
+					     (4294967296.0f / 360.0f));
+}
+
+/** Q31 angle to degrees ([0, 360)). */
+static float q31_to_deg(int32_t x)
+{
+	return (float)(uint32_t)x * (360.0f / 4294967296.0f);
+}
+
+/** Angle difference, wrapped to [-180, 180). */
+static float angle_diff(float a, float b)
+{
+	float d = fmodf(a - b, 360.0f);
+
+	if (d >= 180.0f) {
+		d -= 360.0f;
+	} else if (d < -180.0f) {
+		d += 360.0f;
+	}
+
+	return d;
+}
+
+/**
+ * @brief Simulate a rotor spinning at constant speed.
+ *
+ * An event is provided every time the rotor crosses a multiple of the event
+ * resolution. Both PLL variants are fed with the same events. The rotor angle
+ * is kept in [0, 360).
+ *
+ * @param pll PLL instance.
+ * @param pll_q31 PLL instance (Q31).
+ * @param theta Rotor angle (degrees, updated).
+ * @param speed Speed (revolutions per second).
+ * @param steps Number of update periods.
+ */
+static void spin(pll_t *pll, pll_q31_t *pll_q31, float *theta, float speed,
+		 uint32_t steps)
+{
+	for (uint32_t i = 0U; i < steps; i++) {
+		float prev = *theta;
+		float edge;
+
+		*theta += speed * 360.0f * TS;
+		if (*theta >= 360.0f) {
+			*theta -= 360.0f;
+			prev -= 360.0f;
+		} else if (*theta < 0.0f) {
+			*theta += 360.0f;
+			prev += 360.0f;
+		}
+
+		if (floorf(*theta / RES) != floorf(prev / RES)) {
+			edge = (speed > 0.0f) ? floorf(*theta / RES) * RES
+					      : floorf(prev / RES) * RES;
+			edge = fmodf(edge + 360.0f, 360.0f);
+			pll_event(pll, edge);
+			pll_q31_event(pll_q31, deg_to_q31(edge));
+		}
+
+		pll_update(pll);
+		pll_q31_update(pll_q31);
+	}
+}
+
+/**
+ * @brief Test that speed and angle are tracked (both directions).
+ */
+ZTEST(lib_pll, test_track)
+{
+	static const float speeds[] = {10.0f, 50.0f, 200.0f, -50.0f};
+
+	for (size_t i = 0U; i < ARRAY_SIZE(speeds); i++) {
+		pll_t pll;
+		pll_q31_t pll_q31;
+		float theta = 10.0f;
+
+		pll_init(&pll, BW, TS, TIMEOUT);
+		pll_q31_init(&pll_q31, BW, TS, TIMEOUT);
+
+		/* initial state */
+		zassert_equal(pll_get_speed(&pll), 0.0f);
+		zassert_equal(pll_q31_get_speed(&pll_q31), 0.0f);
+
+		spin(&pll, &pll_q31, &theta, speeds[i], 10000U);
+
+		zassert_within(pll_get_speed(&pll), speeds[i],
+			       fabsf(speeds[i]) * SPEED_MAX_ERR);
+		zassert_within(angle_diff(pll.theta, theta), 0.0f,
+			       ANGLE_MAX_ERR);
+		zassert_true((pll.theta >= 0.0f) && (pll.theta < 360.0f));
+
+		zassert_within(pll_q31_get_speed(&pll_q31), speeds[i],
+			       fabsf(speeds[i]) * SPEED_MAX_ERR);
+		zassert_within(angle_diff(q31_to_deg(pll_q31.theta), theta),
+			       0.0f, ANGLE_MAX_ERR);
+	}
+}
+
+/**
+ * @brief Test that a speed step is followed without steady state error.
+ */
+ZTEST(lib_pll, test_step)
+{
+	pll_t pll;
+	pll_q31_t pll_q31;
+	float theta = 0.0f;
+
+	pll_init(&pll, BW, TS, TIMEOUT);
+	pll_q31_init(&pll_q31, BW, TS, TIMEOUT);
+
+	spin(&pll, &pll_q31, &theta, 50.0f, 10000U);
+	spin(&pll, &pll_q31, &theta, 100.0f, 10000U);
+
+	zassert_within(pll_get_speed(&pll), 100.0f, 100.0f * SPEED_MAX_ERR);
+	zassert_within(angle_diff(pll.theta, theta), 0.0f, ANGLE_MAX_ERR);
+	zassert_within(pll_q31_get_speed(&pll_q31), 100.0f,
+		       100.0f * SPEED_MAX_ERR);
+	zassert_within(angle_diff(q31_to_deg(pll_q31.theta), theta), 0.0f,
+		       ANGLE_MAX_ERR);
+}
+
+/**
+ * @brief Test that speed goes to zero if events stop (timeout).
+ */
+ZTEST(lib_pll, test_timeout)
+{
+	pll_t pll;
+	pll_q31_t pll_q31;
+	float theta = 0.0f;
+
+	pll_init(&pll, BW, TS, TIMEOUT);
+	pll_q31_init(&pll_q31, BW, TS, TIMEOUT);
+
+	spin(&pll, &pll_q31, &theta, 50.0f, 10000U);
+	zassert_not_equal(pll_get_speed(&pll), 0.0f);
+	zassert_not_equal(pll_q31_get_speed(&pll_q31), 0.0f);
+
+	/* rotor stopped (no events) */
+	spin(&pll, &pll_q31, &theta, 0.0f, (uint32_t)(TIMEOUT / TS) + 1U);
+
+	zassert_equal(pll_get_speed(&pll), 0.0f);
+	zassert_equal(pll.theta, pll.meas);
+	zassert_equal(pll_q31_get_speed(&pll_q31), 0.0f);
+	zassert_equal(pll_q31.theta, pll_q31.meas);
+
+	/* estimation restarts at the first event */
+	pll_event(&pll, 120.0f);
+	zassert_equal(pll.theta, 120.0f);
+	zassert_equal(pll_get_speed(&pll), 0.0f);
+}
+
+ZTEST_SUITE(lib_pll, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/control/cloop.h>
+#include <spinner/control/ploop.h>
+#include <spinner/control/sloop.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/utils/mathutil.h>
+
+/** Plant device. */
+#define PLANT_NODE DT_PARENT(DT_NODELABEL(currsmp))
+
+/** Move distance (electrical turns). */
+#define MOVE 20.0f
+
+/** Maximum allowed position error at the target (electrical turns). */
+#define POS_MAX_ERR 0.01f
+
+/** Maximum allowed speed at the target (electrical rev/s). */
+#define SPEED_MAX_ERR 0.5f
+
+static const struct device *plant = DEVICE_DT_GET(PLANT_NODE);
+
+static const struct traj_limits limits = {
+	.v_max = CONFIG_SPINNER_PLOOP_V_MAX,
+	.a_max = CONFIG_SPINNER_PLOOP_A_MAX,
+	.j_max = CONFIG_SPINNER_PLOOP_J_MAX,
+};
+
+/** Start all loops. */
+static void start(void)
+{
+	cloop_start(&cloop_default);
+	sloop_start();
+	ploop_start();
+}
+
+/** Check that the motor is at rest at the given position. */
+static void check_at(float pos)
+{
+	struct pmsm pmsm;
+
+	pmsm_sim_get_state(plant, &pmsm);
+
+	zassert_true(ploop_is_done());
+	zassert_within(ploop_get_position(), pos, POS_MAX_ERR);
+	zassert_within(pmsm_get_espeed(&pmsm) / TWO_PI, 0.0f, SPEED_MAX_ERR);
+}
+
+/**
+ * @brief Test a trapezoidal move (forward and back).
+ */
+ZTEST(lib_ploop, test_trapezoid)
+{
+	float origin;
+
+	start();
+	k_sleep(K_MSEC(10));
+	origin = ploop_get_position();
+
+	ploop_set_target(origin + MOVE);
+	zassert_false(ploop_is_done());
+
+	/* mid-move: moving forward */
+	k_sleep(K_MSEC(200));
+	zassert_false(ploop_is_done());
+	zassert_true(ploop_get_position() > origin);
+
+	k_sleep(K_MSEC(1000));
+	check_at(origin + MOVE);
+
+	ploop_set_target(origin);
+	k_sleep(K_MSEC(1200));
+	check_at(origin);
+}
+
+/**
+ * @brief Test an S-curve move, with acceleration feedforward.
+ */
+ZTEST(lib_ploop, test_scurve)
+{
+	struct traj_limits scurve = limits;
+	struct ploop_gains gains;
+	float origin;
+
+	scurve.j_max = 20.0f * limits.a_max;
+	zassert_equal(ploop_set_limits(&scurve), 0);
+
+	ploop_get_gains(&gains);
+	gains.ka = 1.0e-4f;
+	ploop_set_gains(&gains);
+
+	start();
+	k_sleep(K_MSEC(10));
+	origin = ploop_get_position();
+
+	ploop_set_target(origin - MOVE);
+	k_sleep(K_MSEC(1500));
+	check_at(origin - MOVE);
+}
+
+/**
+ * @brief Test that invalid limits are rejected.
+ */
+ZTEST(lib_ploop, test_limits)
+{
+	struct traj_limits invalid = limits;
+
+	invalid.v_max = 0.0f;
+	zassert_equal(ploop_set_limits(&invalid), -EINVAL);
+
+	/* S-curve does not fit the trajectory buffer */
+	invalid = limits;
+	invalid.j_max = 1.0f;
+	zassert_equal(ploop_set_limits(&invalid), -EINVAL);
+}
+
+static void lib_ploop_after(void *fixture)
+{
+	struct ploop_gains gains;
+
+	ARG_UNUSED(fixture);
+
+	ploop_stop();
+	(void)ploop_set_limits(&limits);
+	ploop_get_gains(&gains);
+	gains.ka = 0.0f;
+	ploop_set_gains(&gains);
+
+	sloop_stop();
+	cloop_stop(&cloop_default);
+
+	/* wait for the motor to (almost) stop */
+	k_sleep(K_SECONDS(2));
+}
+
+ZTEST_SUITE(lib_ploop, NULL, NULL, NULL, lib_ploop_after, NULL);
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+#include <spinner/utils/shunt.h>
+
+/** Shunt offset (ADC counts). */
+#define OFFSET 2048U
+
+/** @brief Phase currents (ADC counts). */
+struct currents {
+	int16_t a;
+	int16_t b;
+	int16_t c;
+};
+
+/** Phases order (max, mid, min) for each single-shunt sector. */
+static const uint8_t order[6][3] = {
+	{0U, 1U, 2U}, {1U, 0U, 2U}, {1U, 2U, 0U},
+	{2U, 1U, 0U}, {2U, 0U, 1U}, {0U, 2U, 1U},
+};
+
+/**
+ * @brief Obtain phase currents with the given (max, mid, min) values ordered
+ * as in the given single-shunt sector.
+ */
+static struct currents ordered(uint8_t sector, int16_t i_max, int16_t i_mid,
+			       int16_t i_min)
+{
+	int16_t i[3];
+
+	i[order[sector - 1U][0]] = i_max;
+	i[order[sector - 1U][1]] = i_mid;
+	i[order[sector - 1U][2]] = i_min;
+
+	return (struct currents){.a = i[0], .b = i[1], .c = i[2]};
+}
+
+/**
+ * @brief Reconstruct currents from the DC-link samples of the given currents.
+ *
+ * The first sample is taken while the DC-link current equals -i_min, the
+ * second while it equals i_max.
+ */
+static struct currents single_reconstruct(uint8_t sector,
+					  const struct currents *in)
+{
+	const int16_t i[3] = {in->a, in->b, in->c};
+	int16_t i_max = i[order[sector - 1U][0]];
+	int16_t i_min = i[order[sector - 1U][2]];
+	struct currents out;
+
+	shunt_single_get_currents(sector, (uint16_t)(OFFSET - i_min),
+				  (uint16_t)(OFFSET + i_max), OFFSET, &out.a,
+				  &out.b, &out.c);
+
+	return out;
+}
+
+static void assert_currents(const struct currents *out,
+			    const struct currents *exp)
+{
+	zassert_equal(out->a, exp->a);
+	zassert_equal(out->b, exp->b);
+	zassert_equal(out->c, exp->c);
+}
+
+/**
+ * @brief Test single-shunt reconstruction on all sectors.
+ *
+ * The mid phase is not observable from the DC-link current, so it is
+ * reconstructed from the other two.
+ */
+ZTEST(lib_shunt, test_single_sectors)
+{
+	for (uint8_t sector = 1U; sector <= 6U; sector++) {
+		struct currents exp, out;
+
+		exp = ordered(sector, 500, -120, -380);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+
+		/* mid phase current with the sign of the max phase */
+		exp = ordered(sector, 300, 100, -400);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+	}
+}
+
+/**
+ * @brief Test single-shunt reconstruction at low currents and at sector
+ * boundaries.
+ *
+ * With no current both samples equal the offset. At sector boundaries the mid
+ * phase equals the max or min phase, and either order is valid.
+ */
+ZTEST(lib_shunt, test_single_limits)
+{
+	for (uint8_t sector = 1U; sector <= 6U; sector++) {
+		struct currents exp, out;
+
+		exp = ordered(sector, 0, 0, 0);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+
+		exp = ordered(sector, 1, 0, -1);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+
+		exp = ordered(sector, 200, 200, -400);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+
+		exp = ordered(sector, 400, -200, -200);
+		out = single_reconstruct(sector, &exp);
+		assert_currents(&out, &exp);
+	}
+}
+
+/**
+ * @brief Test two shunts reconstruction on all sectors.
+ */
+ZTEST(lib_shunt, test_sectors)
+{
+	/* sampled phases (rank 1, rank 2), see shunt_get_currents() */
+	static const uint8_t ranks[6][2] = {
+		{1U, 2U}, {0U, 2U}, {0U, 2U}, {1U, 0U}, {1U, 0U}, {1U, 2U},
+	};
+	const struct shunt_offsets offsets1 = {.a = 2040U, .b = 2050U,
+					       .c = 2060U};
+	const struct shunt_offsets offsets2 = {.a = 2030U, .b = 2070U,
+					       .c = 2045U};
+	const struct currents exp = {.a = 700, .b = -250, .c = -450};
+
+	for (uint8_t sector = 1U; sector <= 6U; sector++) {
+		const uint16_t off1[3] = {offsets1.a, offsets1.b, offsets1.c};
+		const uint16_t off2[3] = {offsets2.a, offsets2.b, offsets2.c};
+		const int16_t i[3] = {exp.a, exp.b, exp.c};
+		uint8_t r1 = ranks[sector - 1U][0];
+		uint8_t r2 = ranks[sector - 1U][1];
+		struct currents out;
+
+		/* shunt voltage inverted with respect to the phase current */
+		shunt_get_currents(sector, (uint16_t)(off1[r1] - i[r1]),
+				   (uint16_t)(off2[r2] - i[r2]), &offsets1,
+				   &offsets2, &out.a, &out.b, &out.c);
+		assert_currents(&out, &exp);
+	}
+}
+
+/**
+ * @brief Test Q31 conversion, including saturation at full-scale.
+ */
+ZTEST(lib_shunt, test_to_q31)
+{
+	zassert_equal(shunt_to_q31(0, 12U), 0);
+	zassert_equal(shunt_to_q31(1, 12U), 1 << 19);
+	zassert_equal(shunt_to_q31(-2048, 12U), INT32_MIN / 2);
+	zassert_equal(shunt_to_q31(4095, 12U), 4095 << 19);
+	zassert_equal(shunt_to_q31(-4095, 12U), -4095 * (1 << 19));
+	/* reconstructed currents may reach the full-scale */
+	zassert_equal(shunt_to_q31(4096, 12U), INT32_MAX);
+	zassert_equal(shunt_to_q31(-4096, 12U), INT32_MIN);
+	zassert_equal(shunt_to_q31(-8190, 12U), INT32_MIN);
+	zassert_equal(shunt_to_q31(255, 8U), 255 << 23);
+}
+
+ZTEST_SUITE(lib_shunt, NULL, NULL, NULL, NULL, NULL);
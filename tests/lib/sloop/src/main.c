@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/control/cloop.h>
+#include <spinner/control/sloop.h>
+#include <spinner/drivers/sim/pmsm_sim.h>
+#include <spinner/utils/mathutil.h>
+
+/** Plant device. */
+#define PLANT_NODE DT_PARENT(DT_NODELABEL(currsmp))
+
+/** Full-scale current (A). */
+#define I_FS (DT_PROP(DT_NODELABEL(currsmp), i_full_scale_milliamps) * 1e-3f)
+
+/** Speed reference (electrical rev/s). */
+#define SPEED_REF 100.0f
+
+/** Maximum allowed speed tracking error (relative). */
+#define SPEED_MAX_ERR 0.02f
+
+/** Maximum allowed current error (relative to full-scale). */
+#define I_MAX_ERR 0.005f
+
+static const struct device *plant = DEVICE_DT_GET(PLANT_NODE);
+
+/** Obtain plant electrical speed (rev/s). */
+static float plant_speed(const struct pmsm *pmsm)
+{
+	return pmsm_get_espeed(pmsm) / TWO_PI;
+}
+
+/**
+ * @brief Test that the speed loop tracks the speed reference.
+ */
+ZTEST(lib_sloop, test_tracking)
+{
+	struct pmsm pmsm;
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+
+	k_sleep(K_MSEC(1000));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_within(plant_speed(&pmsm), SPEED_REF,
+		       SPEED_REF * SPEED_MAX_ERR);
+	zassert_true(fabsf(pmsm.i_d / I_FS) < I_MAX_ERR);
+
+	/* reverse */
+	sloop_set_ref(-SPEED_REF);
+
+	k_sleep(K_MSEC(1000));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_within(plant_speed(&pmsm), -SPEED_REF,
+		       SPEED_REF * SPEED_MAX_ERR);
+}
+
+/**
+ * @brief Test that the speed reference is ramped.
+ *
+ * At half of the ramp time, the speed can not exceed (with some margin) the
+ * ramped reference.
+ */
+ZTEST(lib_sloop, test_ramp)
+{
+	struct pmsm pmsm;
+	float accel = SPEED_REF * 2.0f;
+
+	sloop_set_accel(accel);
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+
+	k_sleep(K_MSEC(250));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(plant_speed(&pmsm) > 0.0f);
+	zassert_true(plant_speed(&pmsm) < 0.6f * SPEED_REF);
+
+	k_sleep(K_MSEC(750));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_within(plant_speed(&pmsm), SPEED_REF,
+		       SPEED_REF * SPEED_MAX_ERR);
+}
+
+/**
+ * @brief Test that the i_q reference is limited to i_max.
+ *
+ * The speed reference can not be reached with the configured current limit,
+ * so the motor must run with i_q = i_max below the reference.
+ */
+ZTEST(lib_sloop, test_i_max)
+{
+	struct pmsm pmsm;
+
+	sloop_set_i_max(0.02f);
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+
+	k_sleep(K_MSEC(1000));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - 0.02f) < I_MAX_ERR);
+	zassert_true(plant_speed(&pmsm) < SPEED_REF);
+}
+
+/**
+ * @brief Test that the i_q reference is limited by the current loop limit.
+ *
+ * The current loop amplitude limit applies to the speed loop output too, with
+ * the i_d reference taking priority: i_q = sqrt(i_max^2 - i_d^2).
+ */
+ZTEST(lib_sloop, test_cloop_i_max)
+{
+	struct pmsm pmsm;
+
+	cloop_set_i_max(&cloop_default, 0.05f);
+	cloop_set_ref(&cloop_default, 0.03f, 0.0f);
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+
+	k_sleep(K_MSEC(1000));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS - 0.04f) < I_MAX_ERR);
+	zassert_true(plant_speed(&pmsm) < SPEED_REF);
+}
+
+/**
+ * @brief Test that restarting the current loop restarts the speed loop.
+ *
+ * The speed loop state is reset when the current loop is stopped, so that on
+ * restart the speed ramp starts again from the measured speed.
+ */
+ZTEST(lib_sloop, test_restart)
+{
+	struct pmsm pmsm;
+	float accel = SPEED_REF * 2.0f;
+
+	sloop_set_accel(accel);
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+	k_sleep(K_MSEC(1000));
+
+	cloop_stop(&cloop_default);
+	k_sleep(K_SECONDS(2));
+
+	cloop_start(&cloop_default);
+	k_sleep(K_MSEC(250));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(plant_speed(&pmsm) < 0.6f * SPEED_REF);
+
+	k_sleep(K_MSEC(750));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_within(plant_speed(&pmsm), SPEED_REF,
+		       SPEED_REF * SPEED_MAX_ERR);
+}
+
+/**
+ * @brief Test that stopping the speed loop hands over i_q to the current
+ * loop.
+ */
+ZTEST(lib_sloop, test_stop)
+{
+	struct pmsm pmsm;
+
+	cloop_start(&cloop_default);
+	sloop_start();
+	sloop_set_ref(SPEED_REF);
+	k_sleep(K_MSEC(200));
+
+	sloop_stop();
+	k_sleep(K_MSEC(20));
+
+	pmsm_sim_get_state(plant, &pmsm);
+	zassert_true(fabsf(pmsm.i_q / I_FS) < I_MAX_ERR);
+}
+
+static void lib_sloop_after(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	sloop_stop();
+	sloop_set_ref(0.0f);
+	sloop_set_accel((float)CONFIG_SPINNER_SLOOP_ACCEL);
+	sloop_set_i_max(1.0f);
+
+	cloop_stop(&cloop_default);
+	cloop_set_ref(&cloop_default, 0.0f, 0.0f);
+	cloop_set_i_max(&cloop_default, 1.0f);
+
+	/* wait for the motor to (almost) stop */
+	k_sleep(K_SECONDS(2));
+}
+
+ZTEST_SUITE(lib_sloop, NULL, NULL, NULL, lib_sloop_after, NULL);
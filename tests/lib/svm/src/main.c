@@ -7,7 +7,10 @@
 
 #include <zephyr/ztest.h>
 
+#include <arm_math.h>
+
 #include <spinner/svm/svm.h>
+#include <spinner/utils/mathutil.h>
 
 /** Value of sqrt(3). */
 #define SQRT_3 1.7320508075688773f
@@ -15,6 +18,15 @@
 /** @brief Test that two floats are almost equal (works for small numbers). */
 #define ALMOST_EQUAL(a, b) (fabs((a) - (b)) < 1.0e-5)
 
+/** @brief Maximum allowed error between Q31 and floating point paths. */
+#define Q31_MAX_ERR 1.0e-4f
+
+/** @brief Convert Q31 to float. */
+static float q31_to_f32(q31_t x)
+{
+	return (float)x / 2147483648.0f;
+}
+
 /**
  * @brief Test that SV-PWM modulator works as expected.
  *
@@ -137,4 +149,449 @@ ZTEST(svm, test_api)
 	zassert_true(ALMOST_EQUAL(svm.duties.c, 0.5f), NULL);
 }
 
+/**
+ * @brief Test that the reported sector matches the space vector angle.
+ *
+ * Space vectors are swept in steps of 1 degree (skipping sector boundaries)
+ * for modules inside and outside the linear region. Sector n (1...6) spans
+ * the angles [(n - 1) * 60, n * 60) degrees. svm_get_sector() must report the
+ * same sector.
+ */
+ZTEST(svm, test_sector)
+{
+	svm_t svm;
+	svm_q31_t svm_q31;
+
+	svm_init(&svm);
+	svm_q31_init(&svm_q31);
+
+	for (float mod = 0.1f; mod < 0.99f; mod += 0.1f) {
+		for (uint32_t angle = 0U; angle < 360U; angle++) {
+			uint8_t sector;
+			float va, vb;
+
+			if ((angle % 60U) == 0U) {
+				continue;
+			}
+
+			sector = (uint8_t)(angle / 60U + 1U);
+
+			va = mod * cosf((float)angle * PI / 180.0f);
+			vb = mod * sinf((float)angle * PI / 180.0f);
+
+			svm_set(&svm, va, vb);
+			zassert_equal(svm.sector, sector, NULL);
+			zassert_equal(svm_get_sector(va, vb), sector, NULL);
+
+			svm_q31_set(&svm_q31, f32_to_q31(va), f32_to_q31(vb));
+			zassert_equal(svm_q31.sector, sector, NULL);
+			zassert_equal(svm_q31_get_sector(f32_to_q31(va),
+							 f32_to_q31(vb)),
+				      sector, NULL);
+		}
+	}
+}
+
+/**
+ * @brief Test that the Q31 SV-PWM modulator matches the floating point one.
+ *
+ * Space vectors are swept in steps of 1 degree and modules from 0 up to the
+ * largest representable in Q31 (which includes the amplitude limitation
+ * region).
+ */
+ZTEST(svm, test_q31)
+{
+	svm_t svm;
+	svm_q31_t svm_q31;
+
+	svm_init(&svm);
+	svm_q31_init(&svm_q31);
+	zassert_equal(svm_q31.duties.a, 0, NULL);
+	zassert_equal(svm_q31.duties.b, 0, NULL);
+	zassert_equal(svm_q31.duties.c, 0, NULL);
+	zassert_equal(svm_q31.d_min, 0, NULL);
+	zassert_equal(svm_q31.d_max, INT32_MAX, NULL);
+	zassert_equal(svm_q31.sector, 0U, NULL);
+
+	for (float mod = 0.0f; mod < 0.99f; mod += 0.01f) {
+		for (float angle = 0.0f; angle < 360.0f; angle += 1.0f) {
+			float va, vb;
+
+			va = mod * cosf(angle * PI / 180.0f);
+			vb = mod * sinf(angle * PI / 180.0f);
+
+			svm_set(&svm, va, vb);
+			svm_q31_set(&svm_q31, f32_to_q31(va), f32_to_q31(vb));
+
+			zassert_within(q31_to_f32(svm_q31.duties.a),
+				       svm.duties.a, Q31_MAX_ERR, NULL);
+			zassert_within(q31_to_f32(svm_q31.duties.b),
+				       svm.duties.b, Q31_MAX_ERR, NULL);
+			zassert_within(q31_to_f32(svm_q31.duties.c),
+				       svm.duties.c, Q31_MAX_ERR, NULL);
+		}
+	}
+}
+
+/**
+ * @brief Test that the Q31 current loop pipeline matches the floating point
+ * one.
+ *
+ * The same chain used by the current loop (Clarke, Park, inverse Park and
+ * SVM) is run for a set of phase currents and electrical angles using both
+ * arithmetics. Electrical angles are given to the Q31 path in the format
+ * provided by the feedback drivers (degrees scaled by 2^32 / 360).
+ */
+ZTEST(svm, test_q31_pipeline)
+{
+	svm_t svm;
+	svm_q31_t svm_q31;
+
+	svm_init(&svm);
+	svm_q31_init(&svm_q31);
+
+	for (float amp = 0.05f; amp < 0.5f; amp += 0.05f) {
+		for (uint32_t angle = 0U; angle < 360U; angle++) {
+			float i_a, i_b, sin_e, cos_e;
+			float i_alpha, i_beta, i_d, i_q, v_alpha, v_beta;
+			q31_t eangle_q31, sin_e_q31, cos_e_q31;
+			q31_t i_alpha_q31, i_beta_q31, i_d_q31, i_q_q31;
+			q31_t v_alpha_q31, v_beta_q31;
+
+			i_a = amp * cosf((float)angle * PI / 180.0f);
+			i_b = amp * cosf(((float)angle - 120.0f) * PI / 180.0f);
+
+			/* float path */
+			arm_sin_cos_f32((float)angle, &sin_e, &cos_e);
+			arm_clarke_f32(i_a, i_b, &i_alpha, &i_beta);
+			arm_park_f32(i_alpha, i_beta, &i_d, &i_q, sin_e, cos_e);
+			/* use currents as voltages (unit gain P controller) */
+			arm_inv_park_f32(i_d, i_q, &v_alpha, &v_beta, sin_e,
+					 cos_e);
+			svm_set(&svm, v_alpha, v_beta);
+
+			/* Q31 path */
+			eangle_q31 = (q31_t)(angle * 11930465UL);
+			arm_sin_cos_q31(eangle_q31, &sin_e_q31, &cos_e_q31);
+			arm_clarke_q31(f32_to_q31(i_a), f32_to_q31(i_b),
+				       &i_alpha_q31, &i_beta_q31);
+			arm_park_q31(i_alpha_q31, i_beta_q31, &i_d_q31,
+				     &i_q_q31, sin_e_q31, cos_e_q31);
+			arm_inv_park_q31(i_d_q31, i_q_q31, &v_alpha_q31,
+					 &v_beta_q31, sin_e_q31, cos_e_q31);
+			svm_q31_set(&svm_q31, v_alpha_q31, v_beta_q31);
+
+			zassert_within(q31_to_f32(i_d_q31), i_d, Q31_MAX_ERR,
+				       NULL);
+			zassert_within(q31_to_f32(i_q_q31), i_q, Q31_MAX_ERR,
+				       NULL);
+			zassert_within(q31_to_f32(svm_q31.duties.a),
+				       svm.duties.a, Q31_MAX_ERR, NULL);
+			zassert_within(q31_to_f32(svm_q31.duties.b),
+				       svm.duties.b, Q31_MAX_ERR, NULL);
+			zassert_within(q31_to_f32(svm_q31.duties.c),
+				       svm.duties.c, Q31_MAX_ERR, NULL);
+		}
+	}
+}
+
+/**
+ * @brief Test the SVM overmodulation modes.
+ *
+ * Space vectors are swept in steps of 1 degree for modules inside and outside
+ * the linear region, checking for each mode:
+ *
+ * - None: applied vector is limited to the linear region (sqrt(3) / 2).
+ * - Mode I: applied vector keeps the requested angle and lies inside the
+ *   hexagon, on its boundary when the requested vector exceeds it.
+ * - Mode II: applied vector lies inside the hexagon, and it reaches six-step
+ *   operation (active vectors only) for large amplitudes.
+ *
+ * The Q31 modulator is also checked against the floating point one (Q31 input
+ * range only allows modules slightly above the hexagon vertices).
+ */
+ZTEST(svm, test_overmod)
+{
+	static const enum svm_overmod modes[] = {
+		SVM_OVERMOD_NONE,
+		SVM_OVERMOD_I,
+		SVM_OVERMOD_II,
+	};
+	svm_t svm;
+	svm_q31_t svm_q31;
+
+	svm_init(&svm);
+	svm_q31_init(&svm_q31);
+	zassert_equal(svm.overmod, SVM_OVERMOD_NONE, NULL);
+	zassert_equal(svm_q31.overmod, SVM_OVERMOD_NONE, NULL);
+
+	for (size_t i = 0U; i < ARRAY_SIZE(modes); i++) {
+		svm.overmod = modes[i];
+		svm_q31.overmod = modes[i];
+
+		for (float mod = 0.1f; mod < 1.6f; mod += 0.05f) {
+			for (uint32_t angle = 0U; angle < 360U; angle++) {
+				float va, vb, mod_out, span;
+
+				va = mod * cosf((float)angle * PI / 180.0f);
+				vb = mod * sinf((float)angle * PI / 180.0f);
+
+				svm_set(&svm, va, vb);
+
+				/* hexagon: max. line-to-line reference is 1 */
+				span = MAX(svm.duties.a,
+					   MAX(svm.duties.b, svm.duties.c)) -
+				       MIN(svm.duties.a,
+					   MIN(svm.duties.b, svm.duties.c));
+				zassert_true(span <= 1.0f + 1.0e-5f, NULL);
+
+				mod_out = sqrtf(svm.va * svm.va +
+						svm.vb * svm.vb);
+				zassert_true(mod_out <= mod + 1.0e-5f, NULL);
+				zassert_within(svm_get_mod_index(&svm),
+					       mod_out * PI / 3.0f, 1.0e-5f,
+					       NULL);
+
+				switch (modes[i]) {
+				case SVM_OVERMOD_NONE:
+					zassert_within(mod_out,
+						       MIN(mod, SQRT_3 / 2.0f),
+						       1.0e-5f, NULL);
+					break;
+				case SVM_OVERMOD_I:
+					/* same angle (cross product) */
+					zassert_within(va * svm.vb - vb * svm.va,
+						       0.0f, 1.0e-5f, NULL);
+					if (mod_out < mod - 1.0e-5f) {
+						zassert_within(span, 1.0f,
+							       1.0e-5f, NULL);
+					}
+					break;
+				default:
+					break;
+				}
+
+				if (mod > 0.99f) {
+					continue;
+				}
+
+				svm_q31_set(&svm_q31, f32_to_q31(va),
+					    f32_to_q31(vb));
+
+				zassert_within(q31_to_f32(svm_q31.duties.a),
+					       svm.duties.a, Q31_MAX_ERR, NULL);
+				zassert_within(q31_to_f32(svm_q31.duties.b),
+					       svm.duties.b, Q31_MAX_ERR, NULL);
+				zassert_within(q31_to_f32(svm_q31.duties.c),
+					       svm.duties.c, Q31_MAX_ERR, NULL);
+				zassert_within(svm_q31_get_mod_index(&svm_q31),
+					       svm_get_mod_index(&svm),
+					       Q31_MAX_ERR, NULL);
+			}
+		}
+	}
+
+	/* mode II: six-step for large amplitudes (20 degrees, vector 100) */
+	svm.overmod = SVM_OVERMOD_II;
+	svm_set(&svm, 100.0f * cosf(20.0f * PI / 180.0f),
+		100.0f * sinf(20.0f * PI / 180.0f));
+	zassert_equal(svm.sector, 1U, NULL);
+	zassert_equal(svm.duties.a, 1.0f, NULL);
+	zassert_equal(svm.duties.b, 0.0f, NULL);
+	zassert_equal(svm.duties.c, 0.0f, NULL);
+	zassert_within(svm_get_mod_index(&svm), PI / 3.0f, 1.0e-5f, NULL);
+}
+
+/**
+ * @brief Test the SVM discontinuous modes.
+ *
+ * Space vectors in the linear region are swept over a full electrical period
+ * in steps of 1 degree, checking for each discontinuous mode that:
+ *
+ * - The applied vector is the same as in continuous mode.
+ * - One phase is clamped to a rail, on the side expected by the mode.
+ * - Each phase is clamped for 120 degrees (switching reduced by a third).
+ * - The Q31 modulator matches the floating point one.
+ *
+ * The sampling window limitation (d_smp) is also checked.
+ */
+ZTEST(svm, test_dpwm)
+{
+	static const enum svm_mode modes[] = {
+		SVM_MODE_DPWMMIN, SVM_MODE_DPWMMAX, SVM_MODE_DPWM0,
+		SVM_MODE_DPWM1,	  SVM_MODE_DPWM2,   SVM_MODE_DPWM3,
+	};
+	svm_t svm, svm_cont;
+	svm_q31_t svm_q31;
+
+	svm_init(&svm);
+	svm_init(&svm_cont);
+	svm_q31_init(&svm_q31);
+	zassert_equal(svm.mode, SVM_MODE_CONTINUOUS, NULL);
+	zassert_equal(svm.d_smp, 1.0f, NULL);
+	zassert_equal(svm_q31.mode, SVM_MODE_CONTINUOUS, NULL);
+	zassert_equal(svm_q31.d_smp, INT32_MAX, NULL);
+
+	for (size_t i = 0U; i < ARRAY_SIZE(modes); i++) {
+		svm.mode = modes[i];
+		svm_q31.mode = modes[i];
+
+		for (float mod = 0.1f; mod < 0.85f; mod += 0.1f) {
+			uint32_t clamped[3] = {0U};
+
+			for (uint32_t angle = 0U; angle < 360U; angle++) {
+				float va, vb, d[3];
+				bool hi;
+
+				va = mod * cosf(((float)angle + 0.5f) * PI /
+						180.0f);
+				vb = mod * sinf(((float)angle + 0.5f) * PI /
+						180.0f);
+
+				svm_set(&svm_cont, va, vb);
+				svm_set(&svm, va, vb);
+
+				zassert_equal(svm.sector, svm_cont.sector, NULL);
+				zassert_within(svm.va, svm_cont.va, 1.0e-5f,
+					       NULL);
+				zassert_within(svm.vb, svm_cont.vb, 1.0e-5f,
+					       NULL);
+
+				d[0] = svm.duties.a;
+				d[1] = svm.duties.b;
+				d[2] = svm.duties.c;
+
+				hi = false;
+				for (size_t n = 0U; n < 3U; n++) {
+					if (d[n] == 1.0f) {
+						hi = true;
+						clamped[n]++;
+					} else if (d[n] == 0.0f) {
+						clamped[n]++;
+					}
+				}
+
+				switch (modes[i]) {
+				case SVM_MODE_DPWMMIN:
+					zassert_false(hi, NULL);
+					break;
+				case SVM_MODE_DPWMMAX:
+					zassert_true(hi, NULL);
+					break;
+				case SVM_MODE_DPWM0:
+					zassert_equal(hi, (svm.sector & 1U) == 0U,
+						      NULL);
+					break;
+				case SVM_MODE_DPWM2:
+					zassert_equal(hi, (svm.sector & 1U) != 0U,
+						      NULL);
+					break;
+				case SVM_MODE_DPWM1:
+					/* largest absolute reference clamped */
+					zassert_equal(
+						hi,
+						(svm_cont.duties.a +
+						 svm_cont.duties.b +
+						 svm_cont.duties.c) < 1.5f,
+						NULL);
+					break;
+				default:
+					break;
+				}
+
+				svm_q31_set(&svm_q31, f32_to_q31(va),
+					    f32_to_q31(vb));
+
+				zassert_within(q31_to_f32(svm_q31.duties.a),
+					       svm.duties.a, Q31_MAX_ERR, NULL);
+				zassert_within(q31_to_f32(svm_q31.duties.b),
+					       svm.duties.b, Q31_MAX_ERR, NULL);
+				zassert_within(q31_to_f32(svm_q31.duties.c),
+					       svm.duties.c, Q31_MAX_ERR, NULL);
+			}
+
+			for (size_t n = 0U; n < 3U; n++) {
+				zassert_equal(clamped[n], 120U, NULL);
+			}
+		}
+	}
+
+	/* sampling window: mid phase above d_smp, clamp to negative rail */
+	svm.mode = SVM_MODE_DPWMMAX;
+	svm.d_smp = 0.9f;
+
+	/* 55 degrees, phase b (mid) would be at ~0.92 */
+	svm_set(&svm, 0.8f * cosf(55.0f * PI / 180.0f),
+		0.8f * sinf(55.0f * PI / 180.0f));
+	zassert_equal(svm.duties.c, 0.0f, NULL);
+	zassert_true(svm.duties.a < 1.0f, NULL);
+
+	/* 10 degrees, phase b (mid) low enough, clamp to positive rail */
+	svm_set(&svm, 0.8f * cosf(10.0f * PI / 180.0f),
+		0.8f * sinf(10.0f * PI / 180.0f));
+	zassert_equal(svm.duties.a, 1.0f, NULL);
+	zassert_true(svm.duties.b <= 0.9f, NULL);
+}
+
+/**
+ * @brief Test dead-time compensation.
+ *
+ * Switching phases are corrected by d_dt in the direction of the phase
+ * current (linearly within the current band), clamped phases are not
+ * corrected. Q31 results must match the floating point ones.
+ */
+ZTEST(svm, test_dead_time)
+{
+	svm_t svm;
+	svm_q31_t svm_q31;
+	svm_duties_t d;
+	const float d_dt = 0.02f;
+	const float i_band = 0.05f;
+	const float i[3] = {0.2f, -0.01f, -0.19f};
+
+	svm_init(&svm);
+	svm_q31_init(&svm_q31);
+	svm_set_dead_time(&svm, d_dt, i_band);
+	svm_q31_set_dead_time(&svm_q31, d_dt, i_band);
+
+	/* continuous: all phases switch */
+	svm_set(&svm, 0.5f, 0.2f);
+	svm_q31_set(&svm_q31, f32_to_q31(0.5f), f32_to_q31(0.2f));
+	d = svm.duties;
+
+	svm_comp_dead_time(&svm, i[0], i[1], i[2]);
+	svm_q31_comp_dead_time(&svm_q31, f32_to_q31(i[0]), f32_to_q31(i[1]),
+			       f32_to_q31(i[2]));
+
+	zassert_true(ALMOST_EQUAL(svm.duties.a, d.a + d_dt));
+	zassert_true(ALMOST_EQUAL(svm.duties.b, d.b - d_dt * 0.01f / i_band));
+	zassert_true(ALMOST_EQUAL(svm.duties.c, d.c - d_dt));
+
+	zassert_within(q31_to_f32(svm_q31.duties.a), svm.duties.a, Q31_MAX_ERR);
+	zassert_within(q31_to_f32(svm_q31.duties.b), svm.duties.b, Q31_MAX_ERR);
+	zassert_within(q31_to_f32(svm_q31.duties.c), svm.duties.c, Q31_MAX_ERR);
+
+	/* discontinuous: clamped phase is not corrected */
+	svm.mode = SVM_MODE_DPWMMIN;
+	svm_set(&svm, 0.5f, 0.2f);
+	d = svm.duties;
+
+	svm_comp_dead_time(&svm, i[0], i[1], i[2]);
+
+	zassert_true(ALMOST_EQUAL(svm.duties.a, d.a + d_dt));
+	zassert_true(ALMOST_EQUAL(svm.duties.c, 0.0f));
+
+	/* disabled */
+	svm.mode = SVM_MODE_CONTINUOUS;
+	svm_set_dead_time(&svm, 0.0f, i_band);
+	svm_set(&svm, 0.5f, 0.2f);
+	d = svm.duties;
+
+	svm_comp_dead_time(&svm, i[0], i[1], i[2]);
+
+	zassert_true(ALMOST_EQUAL(svm.duties.a, d.a));
+	zassert_true(ALMOST_EQUAL(svm.duties.b, d.b));
+	zassert_true(ALMOST_EQUAL(svm.duties.c, d.c));
+}
+
 ZTEST_SUITE(svm, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2021 Teslabs Engineering S.L.
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <math.h>
+
+#include <zephyr/ztest.h>
+
+#include <spinner/traj/traj.h>
+
+/** Update period (s). */
+#define TS 1.0e-3f
+/** Maximum number of updates per move. */
+#define MAX_STEPS 100000U
+
+/** Limits tolerance (relative, rounding). */
+#define LIMIT_TOL 1.0e-3f
+/**
+ * Jerk limit tolerance (relative), larger since jerk is obtained from the
+ * second difference of the velocity.
+ */
+#define JERK_TOL 1.0e-2f
+/** Maximum overshoot. */
+#define OVERSHOOT_MAX 1.0e-4f
+
+static float buf[1000];
+
+/** @brief Trajectory maximum values. */
+struct traj_max {
+	float v;
+	float a;
+	float j;
+	uint32_t steps;
+};
+
+/**
+ * @brief Run trajectory until done, collecting maximum values.
+ *
+ * @param traj Trajectory generator instance.
+ * @param max Maximum values.
+ * @param steps Maximum number of updates.
+ */
+static void run(traj_t *traj, struct traj_max *max, uint32_t steps)
+{
+	float a_prev = traj_get_acc(traj);
+
+	for (uint32_t i = 0U; (i < steps) && !traj_done(traj); i++) {
+		traj_update(traj);
+
+		max->v = fmaxf(max->v, fabsf(traj_get_vel(traj)));
+		max->a = fmaxf(max->a, fabsf(traj_get_acc(traj)));
+		max->j = fmaxf(max->j, fabsf(traj_get_acc(traj) - a_prev) / TS);
+		max->steps++;
+
+		a_prev = traj_get_acc(traj);
+	}
+}
+
+/**
+ * @brief Test trapezoidal profiles (long and short moves, both directions).
+ */
+ZTEST(lib_traj, test_trapezoid)
+{
+	static const struct traj_limits limits = {
+		.v_max = 10.0f,
+		.a_max = 100.0f,
+	};
+	static const float targets[] = {5.0f, -7.5f, 0.3f};
+	traj_t traj;
+
+	traj_init(&traj, NULL, 0U, TS);
+	zassert_equal(traj_set_limits(&traj, &limits), 0);
+
+	for (size_t i = 0U; i < ARRAY_SIZE(targets); i++) {
+		struct traj_max max = {0};
+		float start = traj_get_pos(&traj);
+		float d = fabsf(targets[i] - start);
+		float t_min;
+
+		traj_set_target(&traj, targets[i]);
+		run(&traj, &max, MAX_STEPS);
+
+		zassert_true(traj_done(&traj));
+		zassert_equal(traj_get_pos(&traj), targets[i]);
+		zassert_equal(traj_get_vel(&traj), 0.0f);
+		zassert_true(max.v <= limits.v_max * (1.0f + LIMIT_TOL));
+		zassert_true(max.a <= limits.a_max * (1.0f + LIMIT_TOL));
+
+		/* move time close to the minimum (triangular or trapezoidal) */
+		if (d >= limits.v_max * limits.v_max / limits.a_max) {
+			t_min = d / limits.v_max + limits.v_max / limits.a_max;
+		} else {
+			t_min = 2.0f * sqrtf(d / limits.a_max);
+		}
+
+		zassert_within(max.steps * TS, t_min, 0.02f * t_min + 2.0f * TS);
+	}
+}
+
+/**
+ * @brief Test S-curve profiles (jerk limited).
+ */
+ZTEST(lib_traj, test_scurve)
+{
+	static const struct traj_limits limits = {
+		.v_max = 10.0f,
+		.a_max = 100.0f,
+		.j_max = 1000.0f,
+	};
+	static const float targets[] = {5.0f, 0.3f, -2.0f};
+	traj_t traj;
+
+	traj_init(&traj, buf, ARRAY_SIZE(buf), TS);
+	zassert_equal(traj_set_limits(&traj, &limits), 0);
+
+	for (size_t i = 0U; i < ARRAY_SIZE(targets); i++) {
+		struct traj_max max = {0};
+
+		traj_set_target(&traj, targets[i]);
+		run(&traj, &max, MAX_STEPS);
+
+		zassert_true(traj_done(&traj));
+		zassert_equal(traj_get_pos(&traj), targets[i]);
+		zassert_true(max.v <= limits.v_max * (1.0f + LIMIT_TOL));
+		zassert_true(max.a <= limits.a_max * (1.0f + LIMIT_TOL));
+		zassert_true(max.j <= limits.j_max * (1.0f + JERK_TOL));
+	}
+}
+
+/**
+ * @brief Test that the target can be changed in the middle of a move.
+ *
+ * The new target is behind the current position, so the profile needs to
+ * stop and reverse, without exceeding the limits nor overshooting the new
+ * target.
+ */
+ZTEST(lib_traj, test_retarget)
+{
+	static const struct traj_limits limits = {
+		.v_max = 10.0f,
+		.a_max = 100.0f,
+		.j_max = 2000.0f,
+	};
+	struct traj_max max = {0};
+	float p_min = 0.0f;
+	traj_t traj;
+
+	traj_init(&traj, buf, ARRAY_SIZE(buf), TS);
+	zassert_equal(traj_set_limits(&traj, &limits), 0);
+
+	traj_set_target(&traj, 10.0f);
+	run(&traj, &max, 500U);
+	zassert_false(traj_done(&traj));
+
+	traj_set_target(&traj, -1.0f);
+	for (uint32_t i = 0U; (i < MAX_STEPS) && !traj_done(&traj); i++) {
+		traj_update(&traj);
+		p_min = fminf(p_min, traj_get_pos(&traj));
+		max.v = fmaxf(max.v, fabsf(traj_get_vel(&traj)));
+		max.a = fmaxf(max.a, fabsf(traj_get_acc(&traj)));
+	}
+
+	zassert_true(traj_done(&traj));
+	zassert_equal(traj_get_pos(&traj), -1.0f);
+	zassert_true(p_min >= -1.0f - OVERSHOOT_MAX);
+	zassert_true(max.v <= limits.v_max * (1.0f + LIMIT_TOL));
+	zassert_true(max.a <= limits.a_max * (1.0f + LIMIT_TOL));
+}
+
+/**
+ * @brief Test invalid limits.
+ */
+ZTEST(lib_traj, test_limits)
+{
+	traj_t traj;
+
+	traj_init(&traj, buf, ARRAY_SIZE(buf), TS);
+
+	/* no limits: no motion */
+	traj_set_target(&traj, 1.0f);
+	traj_update(&traj);
+	zassert_equal(traj_get_pos(&traj), 0.0f);
+
+	zassert_equal(traj_set_limits(&traj,
+				      &(const struct traj_limits){
+					      .v_max = 0.0f,
+					      .a_max = 1.0f,
+				      }),
+		      -EINVAL);
+	zassert_equal(traj_set_limits(&traj,
+				      &(const struct traj_limits){
+					      .v_max = 1.0f,
+					      .a_max = -1.0f,
+				      }),
+		      -EINVAL);
+
+	/* S-curve filter does not fit the buffer */
+	zassert_equal(traj_set_limits(&traj,
+				      &(const struct traj_limits){
+					      .v_max = 1.0f,
+					      .a_max = 100.0f,
+					      .j_max = 10.0f,
+				      }),
+		      -EINVAL);
+}
+
+ZTEST_SUITE(lib_traj, NULL, NULL, NULL, NULL, NULL);